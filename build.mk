@@ -1,43 +1,107 @@
 # Vars
 CC = cc # C compiler, platform independent
+AR = ar
 SRC_DIR = src
+TOOLS_DIR = tools
+TEST_DIR = tests
 INC_DIR = inc
 OUT_DIR = out
 ARCH = $(shell uname -m) #In case it's needed for cross compiling
 BIN_DIR = $(OUT_DIR)/bin
+LIB_DIR = $(OUT_DIR)/lib
 OBJ_DIR = $(OUT_DIR)/obj
+PIC_OBJ_DIR = $(OUT_DIR)/obj/pic
 TARGET = $(BIN_DIR)/main
-CFLAGS = -I$(INC_DIR) -Wall -Wextra# Flags for C Compiler
+SIMTOP = $(BIN_DIR)/simtop
+SIMFUZZ = $(BIN_DIR)/simfuzz
+REGRESSION = $(BIN_DIR)/regression
+STATIC_LIB = $(LIB_DIR)/libriscvsim.a
+SHARED_LIB = $(LIB_DIR)/libriscvsim.so
+CFLAGS = -I$(INC_DIR) -Wall -Wextra -MMD -MP# Flags for C Compiler
+PIC_FLAGS = -fPIC -fvisibility=hidden # Only the sim_* API is exported from the shared library
+LDLIBS = -lpthread -lm -lrt
 
 ifdef DEBUG
-	CFLAGS += -g
+	CFLAGS += -g -DDEBUG
+endif
+
+# Lets the vector unit use the widest host SIMD (AVX2) the build machine has
+ifdef NATIVE
+	CFLAGS += -march=native
 endif
 
 # Find all .c files in the src directory
 SRCS = $(wildcard $(SRC_DIR)/*.c)
 
+# The command line front end, everything else goes into the library
+CLI_SRCS = $(SRC_DIR)/main.c
+LIB_SRCS = $(filter-out $(CLI_SRCS), $(SRCS))
+
 # Glob src/ for .c files, replace file names with .o
-OBJS = $(patsubst $(SRC_DIR)/%.c, $(OBJ_DIR)/%.o, $(SRCS))
+CLI_OBJS = $(patsubst $(SRC_DIR)/%.c, $(OBJ_DIR)/%.o, $(CLI_SRCS))
+LIB_OBJS = $(patsubst $(SRC_DIR)/%.c, $(OBJ_DIR)/%.o, $(LIB_SRCS))
+PIC_OBJS = $(patsubst $(SRC_DIR)/%.c, $(PIC_OBJ_DIR)/%.o, $(LIB_SRCS))
 
 # Make All
-all: $(TARGET)
+all: $(TARGET) $(SIMTOP) $(SIMFUZZ) $(STATIC_LIB) $(SHARED_LIB)
 
 # Start Chain
-# Create binary directory and compile the target
-$(TARGET): $(OBJS)
+# Create binary directory and link the front end against the static library
+$(TARGET): $(CLI_OBJS) $(STATIC_LIB)
+	@mkdir -p $(BIN_DIR)
+	$(CC) $(CFLAGS) -o $@ $(CLI_OBJS) $(STATIC_LIB) $(LDLIBS)
+
+# Statistics viewer, only needs the reader side of the stats export
+$(SIMTOP): $(OBJ_DIR)/simtop.o $(STATIC_LIB)
 	@mkdir -p $(BIN_DIR)
-	$(CC) $(CFLAGS) -o $@ $^
+	$(CC) $(CFLAGS) -o $@ $< $(STATIC_LIB) $(LDLIBS)
+
+# Fuzzing front end, AFL fork server and corpus replay on top of the sim_fuzz_* API
+$(SIMFUZZ): $(OBJ_DIR)/simfuzz.o $(STATIC_LIB)
+	@mkdir -p $(BIN_DIR)
+	$(CC) $(CFLAGS) -o $@ $< $(STATIC_LIB) $(LDLIBS)
+
+# Regression checks on the library API, make -f build.mk test runs them
+$(REGRESSION): $(OBJ_DIR)/regression.o $(STATIC_LIB)
+	@mkdir -p $(BIN_DIR)
+	$(CC) $(CFLAGS) -o $@ $< $(STATIC_LIB) $(LDLIBS)
+
+test: $(REGRESSION)
+	./$(REGRESSION)
+
+$(STATIC_LIB): $(LIB_OBJS)
+	@mkdir -p $(LIB_DIR)
+	$(AR) rcs $@ $^
+
+$(SHARED_LIB): $(PIC_OBJS)
+	@mkdir -p $(LIB_DIR)
+	$(CC) -shared -o $@ $^ $(LDLIBS)
 
 # Compile .c files to .o files
 $(OBJ_DIR)/%.o: $(SRC_DIR)/%.c | $(OBJ_DIR)
 	$(CC) $(CFLAGS) -c $< -o $@
 
-# Create object directory
+$(OBJ_DIR)/%.o: $(TOOLS_DIR)/%.c | $(OBJ_DIR)
+	$(CC) $(CFLAGS) -c $< -o $@
+
+$(OBJ_DIR)/%.o: $(TEST_DIR)/%.c | $(OBJ_DIR)
+	$(CC) $(CFLAGS) -c $< -o $@
+
+$(PIC_OBJ_DIR)/%.o: $(SRC_DIR)/%.c | $(PIC_OBJ_DIR)
+	$(CC) $(CFLAGS) $(PIC_FLAGS) -c $< -o $@
+
+# Create object directories
 $(OBJ_DIR):
 	@mkdir -p $(OBJ_DIR)
 
+$(PIC_OBJ_DIR):
+	@mkdir -p $(PIC_OBJ_DIR)
+
+# Header dependencies written by -MMD
+-include $(OBJ_DIR)/simtop.d $(OBJ_DIR)/simfuzz.d $(OBJ_DIR)/regression.d $(CLI_OBJS:.o=.d) $(LIB_OBJS:.o=.d) $(PIC_OBJS:.o=.d)
+
 # Clean up the build files
 clean:
-	rm -rf $(OBJ_DIR) $(BIN_DIR)
+	rm -rf $(OBJ_DIR) $(BIN_DIR) $(LIB_DIR)
 
-.PHONY: all clean
\ No newline at end of file
+.PHONY: all clean test
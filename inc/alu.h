@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "controlUnit.h"
+#include "riscvsim.h"
 
 /**
  * The control unit fetch state populates this 
@@ -17,9 +19,35 @@ typedef struct {
     bool sign_flag;    
     bool parity_flag;
     bool overflow_flag;
+
+    uint32_t pc;          /* Address of the instruction that produced this result */
+    uint32_t nextPc;      /* Address of the next instruction, branch/jump target if taken */
+    uint32_t memAddress;  /* Effective address for loads, stores and atomics */
+    uint32_t storeData;   /* rs2 value for stores and atomics */
+    uint8_t rs1;          /* Source registers, consumed by the timing model */
+    uint8_t rs2;
+    uint8_t length;       /* Instruction size in bytes, 2 if it was compressed */
+    uint16_t csr;         /* CSR number for the Zicsr instructions */
+    bool csrWrites;       /* False for CSRRS/CSRRC with rs1 = x0 (zimm = 0), those only read */
+    bool exception;       /* Raised by the memory access stage, cause and tval say why */
+    uint32_t cause;
+    uint32_t tval;
+    bool branchTaken;
+    bool writesRd;
+    uint8_t vd;           /* Vector destination, or the data register of a vector store */
+    uint8_t eew;          /* Element width in bits of a vector load or store */
+    bool vm;              /* Vector instruction is unmasked */
+    uint64_t fpResult;    /* Value for f[rd], or the data of a float store */
+    uint8_t fpFlags;      /* Exception flags accrued into fflags at write back */
+    bool writesFd;        /* rd names a float register */
+    uint8_t firstLength;  /* Size of the first instruction of a fused pair, 0 if not fused */
 } decoder_to_execute; 
 
-extern decoder_to_execute aluOut;
+/**
+ * @brief Execute stage: reads source registers from the register file and computes the result,
+ * next pc and effective address of df. Loads, stores and atomics are finished by memAccessStage.
+ */
+void aluExecute(sim_t *sim, const decodedFields *df, uint32_t pc, decoder_to_execute *out);
 
 // void ALU_Runner(decoder_to_execute *alu, uint8_t op, uint32_t *parameters);
 
@@ -28,45 +56,49 @@ extern decoder_to_execute aluOut;
 //==========================================Arithmetic Operations==========================================
 uint32_t alu_add(uint32_t a, uint32_t b);
 uint32_t alu_sub(uint32_t a, uint32_t b);
-// uint32_t alu_mul(uint32_t a, uint32_t b);
-// uint32_t alu_div(uint32_t a, uint32_t b);
-// int32_t alu_div_signed(int32_t a, int32_t b);
-// uint32_t alu_mod(uint32_t a, uint32_t b);
-// //=========================================================================================================
-
-
-// //==========================================Logical Operations=============================================
-// uint32_t alu_and(uint32_t a, uint32_t b);
-// uint32_t alu_or(uint32_t a, uint32_t b);
-// uint32_t alu_xor(uint32_t a, uint32_t b);
-// uint32_t alu_not(uint32_t a);
-// //=========================================================================================================
-
-
-// //==========================================Shift Operations===============================================
-// uint32_t alu_sll(uint32_t a, uint32_t b);
-// uint32_t alu_srl(uint32_t a, uint32_t b);
-// int32_t alu_sra(int32_t a, uint32_t b);
-// //=========================================================================================================
-
-// //==========================================Compariuson Operations=========================================
-// uint32_t alu_slt(int32_t a, int32_t b);
-// uint32_t alu_sltu(uint32_t a, uint32_t b);
-// uint32_t alu_eq(uint32_t a, uint32_t b);
-// uint32_t alu_ne(uint32_t a, uint32_t b);
-// //=========================================================================================================
-
-
-// //==========================================Immediate Operations===========================================
-// uint32_t alu_addi(uint32_t a, uint32_t imm);
-// uint32_t alu_andi(uint32_t a, uint32_t imm);
-// uint32_t alu_ori(uint32_t a, uint32_t imm);
-// uint32_t alu_xori(uint32_t a, uint32_t imm);
-// //=========================================================================================================
-
-// //==========================================Overflow Detection=============================================
-// uint32_t alu_add_overflow(uint32_t a, uint32_t b);
-// uint32_t alu_sub_overflow(uint32_t a, uint32_t b);
-// //=========================================================================================================
+uint32_t alu_mul(uint32_t a, uint32_t b);
+uint32_t alu_mulh(int32_t a, int32_t b);
+uint32_t alu_mulhsu(int32_t a, uint32_t b);
+uint32_t alu_mulhu(uint32_t a, uint32_t b);
+uint32_t alu_div(uint32_t a, uint32_t b);
+int32_t alu_div_signed(int32_t a, int32_t b);
+uint32_t alu_mod(uint32_t a, uint32_t b);
+int32_t alu_mod_signed(int32_t a, int32_t b);
+//=========================================================================================================
+
+
+//==========================================Logical Operations=============================================
+uint32_t alu_and(uint32_t a, uint32_t b);
+uint32_t alu_or(uint32_t a, uint32_t b);
+uint32_t alu_xor(uint32_t a, uint32_t b);
+uint32_t alu_not(uint32_t a);
+//=========================================================================================================
+
+
+//==========================================Shift Operations===============================================
+uint32_t alu_sll(uint32_t a, uint32_t b);
+uint32_t alu_srl(uint32_t a, uint32_t b);
+int32_t alu_sra(int32_t a, uint32_t b);
+//=========================================================================================================
+
+//==========================================Compariuson Operations=========================================
+uint32_t alu_slt(int32_t a, int32_t b);
+uint32_t alu_sltu(uint32_t a, uint32_t b);
+uint32_t alu_eq(uint32_t a, uint32_t b);
+uint32_t alu_ne(uint32_t a, uint32_t b);
+//=========================================================================================================
+
+
+//==========================================Immediate Operations===========================================
+uint32_t alu_addi(uint32_t a, uint32_t imm);
+uint32_t alu_andi(uint32_t a, uint32_t imm);
+uint32_t alu_ori(uint32_t a, uint32_t imm);
+uint32_t alu_xori(uint32_t a, uint32_t imm);
+//=========================================================================================================
+
+//==========================================Overflow Detection=============================================
+uint32_t alu_add_overflow(uint32_t a, uint32_t b);
+uint32_t alu_sub_overflow(uint32_t a, uint32_t b);
+//=========================================================================================================
 
 #endif
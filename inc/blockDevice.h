@@ -0,0 +1,52 @@
+/**
+ * Block device backed by a host image file that is mmap'd into the simulator. The guest programs
+ * a sector, a buffer address in ram and a sector count, then writes a command; the transfer is a
+ * single memcpy between the mapping and guest ram.
+ */
+#ifndef BLOCK_DEVICE_H
+#define BLOCK_DEVICE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "bus.h"
+
+#define BLOCK_DEVICE_SIZE 0x100
+#define BLOCK_SECTOR_SIZE 512
+
+/* Register offsets */
+#define BLOCK_REG_SECTOR 0x00
+#define BLOCK_REG_BUFFER 0x04
+#define BLOCK_REG_COUNT 0x08
+#define BLOCK_REG_COMMAND 0x0C
+#define BLOCK_REG_STATUS 0x10
+#define BLOCK_REG_CAPACITY 0x14 /* In sectors, read only */
+
+#define BLOCK_CMD_READ 1
+#define BLOCK_CMD_WRITE 2
+
+#define BLOCK_STATUS_OK 0
+#define BLOCK_STATUS_ERROR 1
+
+typedef struct {
+    uint8_t *image;      /* NULL when no image is attached */
+    size_t imageSize;
+    ram_t *ram;          /* Transfers go straight to guest memory */
+    uint32_t sector;
+    uint32_t buffer;
+    uint32_t count;
+    uint32_t status;
+} blockDevice;
+
+/**
+ * @brief Maps imagePath read/write and places the device registers at base
+ * @return false if the image cannot be opened or mapped
+ */
+bool blockDeviceInit(blockDevice *disk, busMap *bus, uint32_t base, const char *imagePath);
+
+/**
+ * @brief Syncs and unmaps the image
+ */
+void blockDeviceCleanup(blockDevice *disk);
+
+#endif //BLOCK_DEVICE_H
@@ -0,0 +1,69 @@
+/**
+ * Physical address map. Loads and stores are dispatched to the region containing the address:
+ * ram goes straight to guest memory through a last-hit region check, everything else is a memory
+ * mapped device serviced by its read/write callbacks.
+ */
+#ifndef BUS_H
+#define BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ram.h"
+
+#define BUS_MAX_REGIONS 8
+
+/* Device map, all MMIO lives above ram */
+#define UART_BASE 0xF0000000u
+#define BLOCK_DEVICE_BASE 0xF1000000u
+#define CLINT_BASE 0xF2000000u
+
+typedef uint32_t (*mmioRead)(void *device, uint32_t offset, uint8_t bytes);
+typedef void (*mmioWrite)(void *device, uint32_t offset, uint8_t bytes, uint32_t value);
+
+typedef struct {
+    const char *name;
+    uint32_t base;
+    uint32_t size;
+    bool isRam;
+    void *device;      /* Passed back to the callbacks */
+    mmioRead read;
+    mmioWrite write;
+} busRegion;
+
+typedef struct {
+    busRegion regions[BUS_MAX_REGIONS];
+    int regionCount;
+    const busRegion *ramHit;   /* Last ram region that was hit, always valid after busInit */
+    ram_t *ram;
+} busMap;
+
+/**
+ * @brief Resets the address map to a single ram region covering ram
+ */
+void busInit(busMap *bus, ram_t *ram);
+
+/**
+ * @brief Adds a region to the address map
+ * @return false if it overlaps an existing region or the map is full
+ */
+bool busAddRegion(busMap *bus, const busRegion *region);
+
+/* Region lookup and device dispatch, only reached when the last-hit check fails */
+bool busLoadSlow(busMap *bus, uint32_t address, uint8_t bytes, bool isSigned, uint32_t *value);
+bool busStoreSlow(busMap *bus, uint32_t address, uint8_t bytes, uint32_t value);
+
+static inline bool busLoad(busMap *bus, uint32_t address, uint8_t bytes, bool isSigned, uint32_t *value) {
+    if (__builtin_expect(address - bus->ramHit->base <= bus->ramHit->size - bytes, 1)) {
+        return loadMemory(bus->ram, address, bytes, isSigned, value);
+    }
+    return busLoadSlow(bus, address, bytes, isSigned, value);
+}
+
+static inline bool busStore(busMap *bus, uint32_t address, uint8_t bytes, uint32_t value) {
+    if (__builtin_expect(address - bus->ramHit->base <= bus->ramHit->size - bytes, 1)) {
+        return storeMemory(bus->ram, address, bytes, value);
+    }
+    return busStoreSlow(bus, address, bytes, value);
+}
+
+#endif //BUS_H
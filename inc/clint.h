@@ -0,0 +1,30 @@
+/**
+ * Core local interruptor: software interrupt pending bit and the machine timer registers, using
+ * the SiFive register layout.
+ */
+#ifndef CLINT_H
+#define CLINT_H
+
+#include <stdint.h>
+#include "eventQueue.h"
+#include "riscvsim.h"
+
+#define CLINT_SIZE 0x10000
+#define CLINT_MSIP 0x0000
+#define CLINT_MTIMECMP 0x4000
+#define CLINT_MTIME 0xBFF8
+
+typedef struct {
+    uint32_t msip;
+    uint64_t mtimecmp;
+    simEvent timerEvent;   /* Fires when mtime reaches mtimecmp */
+} clintDevice;
+
+void clintInit(sim_t *sim, uint32_t base);
+
+/**
+ * @brief Current value of mtime, the simulated clock
+ */
+uint64_t clintMtime(const sim_t *sim);
+
+#endif //CLINT_H
@@ -1,12 +1,31 @@
 /**
  * Will have a thread that will send a signal (represents rising edge)
+ *
+ * Also keeps the simulated time of an instance: one tick per retired instruction, which is what
+ * mtime counts. Each tick is a single compare against the earliest pending event.
  */
 #ifndef CLOCK_H
 #define CLOCK_H
 
+#include <stdint.h>
+#include "sim.h"
+
+/**
+ * @brief Starts the next instruction by handing the pipeline to the thread that runs fetch
+ */
+void sendRisingEdge(sim_t *sim);
+
+void clockInit(sim_t *sim);
+
+static inline void clockTick(sim_t *sim) {
+    if (++sim->clockNow >= sim->events.nextDue) {
+        eventRunDue(&sim->events, sim->clockNow);
+    }
+}
+
 /**
- * @brief This fucntion will send a signal to fetch, decode, execute, memaccess, and writeback threads causing them to run
+ * @brief Jumps the clock forward to when, firing the events in between
  */
-void sendRisingEdge();
+void clockSkipTo(sim_t *sim, uint64_t when);
 
-#endif //CLOCK_H
\ No newline at end of file
+#endif //CLOCK_H
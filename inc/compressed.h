@@ -0,0 +1,20 @@
+/**
+ * RVC (C extension) support. Compressed parcels are expanded to their 32 bit equivalent so the
+ * rest of the machine only ever decodes normal instructions.
+ */
+#ifndef COMPRESSED_H
+#define COMPRESSED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The two low bits are 11 for every 32 bit instruction */
+#define IS_COMPRESSED(parcel) (((parcel) & 0b11) != 0b11)
+
+/**
+ * @brief Expands a 16 bit instruction through the quadrant/funct3 expander table
+ * @return The 32 bit equivalent, or 0 (an illegal instruction) if parcel is not a valid RV32C encoding
+ */
+uint32_t expandCompressed(uint16_t parcel);
+
+#endif //COMPRESSED_H
@@ -13,44 +13,116 @@
 #include <fcntl.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "riscvsim.h"
 
 
-/* Handles for each pipeline thread */
-extern pthread_t fetchThreadHandle;
-extern pthread_t decodeThreadHandle;
-extern pthread_t executeThreadHandle;
-extern pthread_t memAccessThreadHandle;
-extern pthread_t regWriteThreadHandle;
+typedef enum {
+    FETCH,
+    DECODE,
+    EXECUTE,
+    MEM_ACCESS,
+    REG_WRITE_BACK,
+    STAGE_COUNT
+} currentStage;
 
-/* Pipes that transfer data from one thread to the next */
-extern int pipe_fetch_to_decode[2];
-extern int pipe_decode_to_execute[2];
-extern int pipe_execute_to_memAccess[2];
-extern int pipe_memAccess_to_regWrite[2];
+/* Latches carried over the pipes between stages, the fetch queue holds fetchLatches as well */
+typedef struct {
+    uint32_t pc;
+    uint32_t instruction;  /* Already expanded if it was compressed */
+    uint8_t length;
+    uint32_t next;         /* Instruction after a fusion candidate, nextLength is 0 if there is none */
+    uint8_t nextLength;
+} fetchLatch;
 
-/* Signal that threads will wait on */
-extern sigset_t set;
+#define FETCH_QUEUE_MAX 64
 
-/* Function prototypes for all threads */
-void *fetchThread(void *arg);
-void *decodeThread(void *arg);
-void *executeThread(void *arg);
-void *memAccessThread(void *arg);
-void *regWriteThread(void *arg);
+/* Host thread that runs the consecutive stages first..last of a pipeline */
+typedef struct {
+    sim_t *sim;
+    pthread_t handle;
+    currentStage first;
+    currentStage last;
+    int cpu;               /* Host CPU it is pinned to, -1 leaves it to the scheduler */
+} stageThread;
+
+/* Pipeline threads of one simulator, created the first time it runs in detail */
+typedef struct {
+    bool started;
+
+    /* Threads of the configured layout and the index of the one that runs each stage */
+    sim_pipeline_layout layout;
+    stageThread threads[STAGE_COUNT];
+    uint32_t threadCount;
+    uint8_t owner[STAGE_COUNT];
+    int cpus[STAGE_COUNT];   /* Pinning list, thread i gets cpus[i % cpuCount] */
+    uint32_t cpuCount;       /* 0 pins nothing */
+    pthread_barrier_t startBarrier;
+
+    /* Output latch of every stage but write back. Each one is mapped and first touched by the
+       thread that writes it, after it was pinned, so its page sits on that thread's NUMA node */
+    void *latches[STAGE_COUNT];
+
+    /* Signal that threads will wait on */
+    sigset_t set;
+
+    /* Holds the current state of the system */
+    currentStage currStage;
+
+    /* Decoupled fetch: each cycle the fetch thread adds a block along the predicted path while the
+       queue has room for it, and hands decode the oldest entry */
+    fetchLatch fetchQueue[FETCH_QUEUE_MAX];
+    uint32_t fetchHead;
+    uint32_t fetchCount;
+    uint32_t fetchPc;        /* Start of the next block */
+    bool fetchPeeked;        /* The last latch carried the queue's next entry as a fusion partner */
+    bool fetchFlush;         /* Set at write back by serializing instructions */
+
+    /* Instructions left in the current pipelineRun, the caller sleeps on retireCond until it drains */
+    uint64_t pipelineBudget;
+    bool pipelineIdle;
+    pthread_mutex_t retireLock;
+    pthread_cond_t retireCond;
+} pipelineState;
+
+/* Body of every pipeline thread, arg is its stageThread */
+void *stageThreadMain(void *arg);
 
 /* Function prototypes for initialization and cleanup */
-void flush_pipe(int pipe_fd);
-void cleanup();
-int initialPipes();
-int initializeSignal();
-int initializeThreads();
+void pipelineInit(sim_t *sim);
+void cleanup(sim_t *sim);
+int initializeSignal(sim_t *sim);
+int initializeThreads(sim_t *sim);
+
+/**
+ * @brief Picks how the stages are spread over host threads and which CPUs those are pinned to
+ * @param cpus Comma separated host CPU numbers handed to the threads in order, NULL for no pinning
+ * @return false if cpus does not parse
+ */
+bool pipelineConfigure(sim_t *sim, sim_pipeline_layout layout, const char *cpus);
+
+/**
+ * @brief Hands the pipeline to the thread that runs stage
+ */
+void pipelineHandOff(sim_t *sim, currentStage stage);
+
+/**
+ * @brief Runs up to n instructions through the five pipeline threads and blocks until they retire.
+ * The threads are started on the first call
+ * @return Number of instructions retired (less than n if the program halted)
+ */
+uint64_t pipelineRun(sim_t *sim, uint64_t n);
+
 typedef enum {
     R_TYPE,
     I_TYPE,
     S_TYPE,
     B_TYPE,
     U_TYPE,
-    J_TYPE
+    J_TYPE,
+    V_TYPE,
+    F_TYPE,
+    FUSED_TYPE,
+    ILLEGAL_TYPE
 }INSTR_TYPE;
 
 
@@ -112,6 +184,16 @@ enum microOp {
      // System instructions
      OP_ECALL,    // Environment call
      OP_EBREAK,   // Environment break
+     OP_FENCE,    // Memory ordering fence (no-op on a single hart)
+     OP_CSRRW,    // Atomic read/write CSR
+     OP_CSRRS,    // Atomic read and set bits in CSR
+     OP_CSRRC,    // Atomic read and clear bits in CSR
+     OP_CSRRWI,   // CSRRW with a 5 bit immediate
+     OP_CSRRSI,   // CSRRS with a 5 bit immediate
+     OP_CSRRCI,   // CSRRC with a 5 bit immediate
+     OP_SFENCE_VMA, // Flush address translations
+     OP_MRET,     // Return from machine mode trap
+     OP_WFI,      // Wait for interrupt
 
     // Multiply extension (RV32M)
      OP_MUL,      // Multiply (low 32 bits)
@@ -132,7 +214,123 @@ enum microOp {
     OP_AMOORW,    // Atomic OR word
     OP_AMOXORW,   // Atomic XOR word
     OP_AMOMAXW,   // Atomic maximum word (signed)
-    OP_AMOMINW    // Atomic minimum word (signed)
+    OP_AMOMINW,   // Atomic minimum word (signed)
+    OP_AMOMAXUW,  // Atomic maximum word (unsigned)
+    OP_AMOMINUW,  // Atomic minimum word (unsigned)
+
+    // Vector extension (RVV subset, SEW up to 32)
+    OP_VSETVLI,   // Set vl and vtype, AVL from rs1
+    OP_VSETIVLI,  // Set vl and vtype, AVL immediate
+    OP_VSETVL,    // Set vl and vtype, vtype from rs2
+    OP_VLE,       // Unit-stride load
+    OP_VLSE,      // Strided load
+    OP_VLM,       // Mask load
+    OP_VSE,       // Unit-stride store
+    OP_VSSE,      // Strided store
+    OP_VSM,       // Mask store
+    OP_VADD,      // Vector add
+    OP_VSUB,      // Vector subtract
+    OP_VRSUB,     // Reverse subtract (scalar - vector)
+    OP_VAND,      // Vector bitwise AND
+    OP_VOR,       // Vector bitwise OR
+    OP_VXOR,      // Vector bitwise XOR
+    OP_VSLL,      // Vector shift left logical
+    OP_VSRL,      // Vector shift right logical
+    OP_VSRA,      // Vector shift right arithmetic
+    OP_VMUL,      // Vector multiply (low SEW bits)
+    OP_VMERGE,    // Merge under v0, vmv.v.* when unmasked
+    OP_VMSEQ,     // Set mask if equal
+    OP_VMSNE,     // Set mask if not equal
+    OP_VMSLTU,    // Set mask if less than (unsigned)
+    OP_VMSLT,     // Set mask if less than (signed)
+    OP_VMSLEU,    // Set mask if less or equal (unsigned)
+    OP_VMSLE,     // Set mask if less or equal (signed)
+    OP_VMSGTU,    // Set mask if greater than (unsigned)
+    OP_VMSGT,     // Set mask if greater than (signed)
+    OP_VREDSUM,   // Sum reduction
+    OP_VREDAND,   // AND reduction
+    OP_VREDOR,    // OR reduction
+    OP_VREDXOR,   // XOR reduction
+    OP_VREDMINU,  // Minimum reduction (unsigned)
+    OP_VREDMIN,   // Minimum reduction (signed)
+    OP_VREDMAXU,  // Maximum reduction (unsigned)
+    OP_VREDMAX,   // Maximum reduction (signed)
+    OP_VMANDN,    // Mask vs2 AND NOT vs1
+    OP_VMAND,     // Mask AND
+    OP_VMOR,      // Mask OR
+    OP_VMXOR,     // Mask XOR
+    OP_VMORN,     // Mask vs2 OR NOT vs1
+    OP_VMNAND,    // Mask NAND
+    OP_VMNOR,     // Mask NOR
+    OP_VMXNOR,    // Mask XNOR
+    OP_VMV_X_S,   // Element 0 to a scalar register
+    OP_VMV_S_X,   // Scalar register to element 0
+    OP_VCPOP,     // Count active mask bits
+    OP_VFIRST,    // Index of the first active set mask bit, -1 if none
+
+    // Floating point (RV32F, RV32D), the double block repeats the single one in the same order
+    OP_FLW,       // Load single
+    OP_FLD,       // Load double
+    OP_FSW,       // Store single
+    OP_FSD,       // Store double
+    OP_FMADD_S,   // rs1 * rs2 + rs3, rounded once
+    OP_FMSUB_S,   // rs1 * rs2 - rs3
+    OP_FNMSUB_S,  // -(rs1 * rs2) + rs3
+    OP_FNMADD_S,  // -(rs1 * rs2) - rs3
+    OP_FADD_S,    // Add
+    OP_FSUB_S,    // Subtract
+    OP_FMUL_S,    // Multiply
+    OP_FDIV_S,    // Divide
+    OP_FSQRT_S,   // Square root
+    OP_FSGNJ_S,   // rs1 with the sign of rs2 (fmv.s)
+    OP_FSGNJN_S,  // rs1 with the opposite sign of rs2 (fneg.s)
+    OP_FSGNJX_S,  // rs1 with the sign of rs1 xor rs2 (fabs.s)
+    OP_FMIN_S,    // Minimum, a NaN operand loses
+    OP_FMAX_S,    // Maximum, a NaN operand loses
+    OP_FCVT_W_S,  // To signed word
+    OP_FCVT_WU_S, // To unsigned word
+    OP_FEQ_S,     // Quiet equal compare
+    OP_FLT_S,     // Signaling less than compare
+    OP_FLE_S,     // Signaling less or equal compare
+    OP_FCLASS_S,  // Classify into a one hot mask
+    OP_FCVT_S_W,  // From signed word
+    OP_FCVT_S_WU, // From unsigned word
+    OP_FMADD_D,
+    OP_FMSUB_D,
+    OP_FNMSUB_D,
+    OP_FNMADD_D,
+    OP_FADD_D,
+    OP_FSUB_D,
+    OP_FMUL_D,
+    OP_FDIV_D,
+    OP_FSQRT_D,
+    OP_FSGNJ_D,
+    OP_FSGNJN_D,
+    OP_FSGNJX_D,
+    OP_FMIN_D,
+    OP_FMAX_D,
+    OP_FCVT_W_D,
+    OP_FCVT_WU_D,
+    OP_FEQ_D,
+    OP_FLT_D,
+    OP_FLE_D,
+    OP_FCLASS_D,
+    OP_FCVT_D_W,
+    OP_FCVT_D_WU,
+    OP_FMV_X_W,   // Raw single bits to an integer register
+    OP_FMV_W_X,   // Integer register bits to a NaN-boxed single
+    OP_FCVT_S_D,  // Double to single
+    OP_FCVT_D_S,  // Single to double
+
+    // Macro-ops the decoder fuses from two instructions, see fuseInstructions
+    OP_LUI_ADDI,   // lui rd + addi rd, rd: 32 bit constant
+    OP_AUIPC_JALR, // auipc rd + jalr rd or x0, rd: far call or tail call
+    OP_AUIPC_LW,   // auipc rd + lw rd, rd: pc relative load
+    OP_SLLI_SRLI,  // slli rd + srli rd, rd: zero extension and bit field extract
+
+    OP_ILLEGAL,   // Could not be decoded
+
+    OP_COUNT      // Number of micro ops, keep last
 };
 
 //change this fucking monstrosity
@@ -141,6 +339,7 @@ typedef struct {
     INSTR_TYPE instruction_type;  // Determines which union field to use
     uint8_t microOp;              // Decoded instruction mnemonic
     uint8_t opcode;               // Common across all instruction types
+    uint8_t length;               // 2 for compressed instructions, 4 otherwise
 
     // Union of different instruction formats
     union {
@@ -189,25 +388,74 @@ typedef struct {
             uint32_t imm20;  // Immediate is 20 bits for J-type
         } j_type;
 
+        // V extension fields, shared by OP-V and the vector loads/stores
+        struct {
+            uint8_t vd;      // Also rd, and the data register (vs3) of stores
+            uint8_t funct3;  // Operand kind for OP-V, element width for loads/stores
+            uint8_t vs1;     // Also rs1 and the 5 bit immediate
+            uint8_t vs2;     // Also rs2 (stride, vsetvl) and lumop/sumop
+            uint8_t funct6;  // nf, mew and mop for loads/stores
+            bool vm;         // Unmasked, no v0.t
+            uint16_t zimm;   // vtype immediate of vsetvli/vsetivli
+        } v_type;
+
+        // F and D extension fields, the fused multiply-adds are R4-type
+        struct {
+            uint8_t rd;
+            uint8_t rm;      // Rounding mode, or the width of loads/stores and the variant of sign injection, min/max and compares
+            uint8_t rs1;
+            uint8_t rs2;
+            uint8_t rs3;
+            uint8_t funct7;  // funct5 and fmt of OP-FP, fmt in the low bits of R4-type
+            uint16_t imm12;  // Offset of loads and stores
+        } f_type;
+
+        // Macro-op of two fused instructions, the first one is lui, auipc or slli
+        struct {
+            uint8_t rd;           // Destination of the first instruction
+            uint8_t rs1;          // Source of slli
+            uint8_t rd2;          // Destination of the second instruction
+            uint8_t firstLength;  // Size of the first instruction, the second one starts there
+            uint32_t imm20;       // Immediate of lui/auipc, shift amount of slli
+            uint16_t imm12;       // Immediate of addi/jalr/lw, shift amount of srli
+        } fused;
+
     } instrFields;  // Union to store different instruction formats
 
 } decodedFields;
 
+/* Decode to execute latch */
+typedef struct {
+    uint32_t pc;
+    decodedFields df;
+} decodeLatch;
 
-typedef enum {
-    FETCH,
-    DECODE,
-    EXECUTE,
-    MEM_ACCESS,
-    REG_WRITE_BACK
-} currentStage;
 
+INSTR_TYPE get_Instr_Type(uint8_t opcode);
+
+/**
+ * @brief Decodes a 32 bit instruction into df. Shared by the decode thread and the interpreter.
+ * df->length is set to 4, the fetch unit overrides it for expanded compressed instructions
+ */
+void decodeInstruction(uint32_t instructionToDecode, decodedFields *df);
 
-/* Signal handler for SIGINT (Ctrl+C) */
-void sigint_handler(int sig);
+/* lui, auipc and slli start every pair fuseInstructions knows, only those look at the next instruction */
+static inline bool isFusionHead(uint32_t instruction) {
+    uint32_t opcode = instruction & 0x7F;
+    return opcode == 0x37 || opcode == 0x17 || (opcode == 0x13 && ((instruction >> 12) & 0x7) == 0x1);
+}
 
-INSTR_TYPE get_Instr_Type(uint8_t opcode);
+/**
+ * @brief Macro-op fusion: turns df into a single fused op if it and the next instruction form one of
+ * the OP_LUI_ADDI..OP_SLLI_SRLI pairs. The second instruction always overwrites the register the
+ * first one wrote (or is a tail call), so the pair has one architectural destination
+ * @return false if the pair does not fuse, df is then left untouched
+ */
+bool fuseInstructions(decodedFields *df, uint32_t next, uint8_t nextLength);
 
 
 #define MSB_8BIT 0x80 //10000000
+
+/* Sign extends the low bits of value to 32 bits */
+#define SIGN_EXTEND(value, bits) ((int32_t)((uint32_t)(value) << (32 - (bits))) >> (32 - (bits)))
 #endif // PIPELINE_H
\ No newline at end of file
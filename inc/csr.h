@@ -0,0 +1,112 @@
+/**
+ * Control and status registers and the current privilege level of the hart.
+ */
+#ifndef CSR_H
+#define CSR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "riscvsim.h"
+
+/* Privilege levels */
+#define PRIV_U 0
+#define PRIV_S 1
+#define PRIV_M 3
+
+/* CSR addresses */
+#define CSR_SATP 0x180
+#define CSR_MSTATUS 0x300
+#define CSR_MISA 0x301
+#define CSR_MIE 0x304
+#define CSR_MTVEC 0x305
+#define CSR_MSCRATCH 0x340
+#define CSR_MEPC 0x341
+#define CSR_MCAUSE 0x342
+#define CSR_MTVAL 0x343
+#define CSR_MIP 0x344
+#define CSR_MHARTID 0xF14
+#define CSR_CYCLE 0xC00
+#define CSR_TIME 0xC01
+#define CSR_INSTRET 0xC02
+#define CSR_CYCLEH 0xC80
+#define CSR_TIMEH 0xC81
+#define CSR_INSTRETH 0xC82
+#define CSR_FFLAGS 0x001
+#define CSR_FRM 0x002
+#define CSR_FCSR 0x003
+#define CSR_VSTART 0x008
+#define CSR_VXSAT 0x009
+#define CSR_VXRM 0x00A
+#define CSR_VCSR 0x00F
+#define CSR_VL 0xC20
+#define CSR_VTYPE 0xC21
+#define CSR_VLENB 0xC22
+
+/* mstatus bits */
+#define MSTATUS_MIE (1u << 3)
+#define MSTATUS_MPIE (1u << 7)
+#define MSTATUS_MPP_SHIFT 11
+#define MSTATUS_MPP (3u << MSTATUS_MPP_SHIFT)
+#define MSTATUS_MPRV (1u << 17)
+#define MSTATUS_SUM (1u << 18)
+#define MSTATUS_MXR (1u << 19)
+
+/* satp fields */
+#define SATP_MODE_SV32 (1u << 31)
+#define SATP_PPN_MASK 0x003FFFFFu
+
+/* Interrupt bits of mip/mie, also the interrupt cause numbers */
+#define IRQ_M_SOFT 3
+#define IRQ_M_TIMER 7
+#define IRQ_M_EXT 11
+#define MIP_MSIP (1u << IRQ_M_SOFT)
+#define MIP_MTIP (1u << IRQ_M_TIMER)
+#define MIP_MEIP (1u << IRQ_M_EXT)
+
+#define MCAUSE_INTERRUPT (1u << 31)
+#define MTVEC_VECTORED 1u
+
+/* RV32IMAFDCV with S and U modes */
+#define MISA_VALUE ((1u << 30) | (1u << 0) | (1u << 2) | (1u << 3) | (1u << 5) | (1u << 8) | (1u << 12) | (1u << 18) | \
+                    (1u << 20) | (1u << 21))
+
+/* Exception causes (mcause values) */
+#define CAUSE_FETCH_MISALIGNED 0
+#define CAUSE_FETCH_ACCESS 1
+#define CAUSE_ILLEGAL_INSTRUCTION 2
+#define CAUSE_BREAKPOINT 3
+#define CAUSE_LOAD_MISALIGNED 4
+#define CAUSE_LOAD_ACCESS 5
+#define CAUSE_STORE_MISALIGNED 6
+#define CAUSE_STORE_ACCESS 7
+#define CAUSE_ECALL_U 8
+#define CAUSE_ECALL_S 9
+#define CAUSE_ECALL_M 11
+#define CAUSE_FETCH_PAGE_FAULT 12
+#define CAUSE_LOAD_PAGE_FAULT 13
+#define CAUSE_STORE_PAGE_FAULT 15
+
+typedef struct {
+    uint8_t privilege;
+    uint32_t mstatus;
+    uint32_t satp;
+    uint32_t mie;
+    uint32_t mip;       /* MTIP and MSIP are driven by the CLINT */
+    uint32_t mtvec;
+    uint32_t mscratch;
+    uint32_t mepc;
+    uint32_t mcause;
+    uint32_t mtval;
+} csrFile;
+
+void initCsrs(csrFile *csrs);
+
+/**
+ * @brief Atomically reads and updates a CSR for the CSRRW/CSRRS/CSRRC family
+ * @param microOp One of the OP_CSRR* micro ops, the immediate forms behave like their register forms
+ * @param writes False when the instruction must not write (rs1/zimm of x0 for set/clear)
+ * @return false if the CSR does not exist, is read only or needs more privilege
+ */
+bool csrAccess(sim_t *sim, uint16_t csr, uint8_t microOp, uint32_t operand, bool writes, uint32_t *oldValue);
+
+#endif //CSR_H
@@ -0,0 +1,74 @@
+/**
+ * Decode stage body, shared by decodeInstruction and the specialised interpreter cores. It is always
+ * inlined so a constant extension set leaves the opcodes of the missing extensions illegal without
+ * calling their decoders.
+ */
+#ifndef DECODE_H
+#define DECODE_H
+
+#include <string.h>
+#include "controlUnit.h"
+#include "isa.h"
+
+#define ARITH_R_TYPE 0b0110011
+#define ATOMIC_R_TYPE 0b0101111
+#define VECTOR_V_TYPE 0b1010111
+#define LOAD_FP_F_TYPE 0b0000111 //Vector loads and stores share these opcodes with the float ones
+#define STORE_FP_F_TYPE 0b0100111
+#define MADD_F_TYPE 0b1000011 //Fused multiply-adds, the low two funct7 bits are the format
+#define NMADD_F_TYPE 0b1001111
+#define ARITH_F_TYPE 0b1010011
+
+/* Each decoder fills in the fields and micro op of its own opcodes, df already holds the opcode */
+void decodeBaseInstruction(uint32_t instruction, decodedFields *df);
+void decodeMulInstruction(uint32_t instruction, decodedFields *df);
+void decodeAtomicInstruction(uint32_t instruction, decodedFields *df);
+void decodeFloatInstruction(uint32_t instruction, decodedFields *df);
+void decodeVectorInstruction(uint32_t instruction, decodedFields *df);
+
+static inline __attribute__((always_inline)) void decodeFor(uint32_t instruction, decodedFields *df,
+                                                            uint32_t extensions) {
+    memset(df, 0, sizeof(*df));
+    df->microOp = OP_ILLEGAL;
+    df->length = 4;
+    df->opcode = instruction & 0b1111111;
+    df->instruction_type = get_Instr_Type(df->opcode);
+
+    switch (df->opcode) {
+        case ARITH_R_TYPE:
+            if ((instruction >> 25) != 0x01) {
+                decodeBaseInstruction(instruction, df);
+            } else if (extensions & ISA_M) {
+                decodeMulInstruction(instruction, df);
+            }
+            break;
+        case ATOMIC_R_TYPE:
+            if (extensions & ISA_A) {
+                decodeAtomicInstruction(instruction, df);
+            }
+            break;
+        case VECTOR_V_TYPE:
+            if (extensions & ISA_V) {
+                decodeVectorInstruction(instruction, df);
+            }
+            break;
+        case LOAD_FP_F_TYPE:
+        case STORE_FP_F_TYPE:
+        case MADD_F_TYPE:
+        case MADD_F_TYPE + 0b100:
+        case MADD_F_TYPE + 0b1000:
+        case NMADD_F_TYPE:
+        case ARITH_F_TYPE:
+            /* F, D and the vector memory ops share these opcodes, isaRestrict drops the ones left out */
+            if (extensions & (ISA_F | ISA_V)) {
+                decodeFloatInstruction(instruction, df);
+                isaRestrict(extensions, df);
+            }
+            break;
+        default:
+            decodeBaseInstruction(instruction, df);
+            break;
+    }
+}
+
+#endif //DECODE_H
@@ -0,0 +1,69 @@
+/**
+ * Decoupled mode: the interpreter runs the program on the calling thread and streams a compact
+ * record of every retired instruction through a single-producer single-consumer ring to a timing
+ * thread, which feeds them to the timing model. The two only wait on each other when the ring is
+ * full or empty. Both sides keep a private copy of their index and publish it once per batch, so
+ * the shared cache lines change hands once every RETIRE_BATCH records rather than every record.
+ *
+ * Simulated time follows the functional side, one tick per instruction as in functional mode, so
+ * timer interrupts do not depend on the timing model.
+ */
+#ifndef DECOUPLED_H
+#define DECOUPLED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "riscvsim.h"
+#include "timing.h"
+
+#define RETIRE_QUEUE_SIZE (1u << 16)   /* Records, a power of two */
+#define RETIRE_BATCH 64                /* Records between two index updates, divides RETIRE_QUEUE_SIZE */
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t head;   /* Records written by the interpreter */
+    _Alignas(64) _Atomic uint64_t tail;   /* Records consumed by the timing thread */
+    _Alignas(64) _Atomic bool done;       /* No more records until the next run */
+    retiredInstr *records;                /* Ring of RETIRE_QUEUE_SIZE, allocated on the first run */
+    pthread_t thread;                     /* Created on the first run, parked between runs */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;                  /* running or exiting changed */
+    bool started;
+    bool running;                         /* Set by a run, cleared by the timing thread once it caught up */
+    bool exiting;                         /* The parked thread returns, set by decoupledCleanup */
+    _Alignas(64) uint64_t producerHead;   /* The interpreter's own copy of head */
+    uint64_t producerTail;                /* Last tail it saw, only refreshed when the ring looks full */
+} retireQueue;
+
+/**
+ * @brief Publishes head and waits until the timing thread has freed a slot
+ */
+void retireWaitForSpace(retireQueue *queue);
+
+/* Called by the interpreter loop for every retired instruction */
+static inline void retirePush(retireQueue *queue, const decoder_to_execute *ex) {
+    uint64_t head = queue->producerHead;
+
+    if (head - queue->producerTail == RETIRE_QUEUE_SIZE) {
+        retireWaitForSpace(queue);
+    }
+    makeRetiredInstr(ex, &queue->records[head & (RETIRE_QUEUE_SIZE - 1)]);
+    queue->producerHead = ++head;
+    if ((head & (RETIRE_BATCH - 1)) == 0) {
+        atomic_store_explicit(&queue->head, head, memory_order_release);
+    }
+}
+
+/**
+ * @brief Runs up to n instructions functionally while the timing thread accounts them, and
+ * returns once the timing thread has caught up
+ */
+void runDecoupled(sim_t *sim, uint64_t n);
+
+/**
+ * @brief Stops and joins the timing thread, then frees the ring
+ */
+void decoupledCleanup(retireQueue *queue);
+
+#endif //DECOUPLED_H
@@ -0,0 +1,50 @@
+/**
+ * Future events on the simulated clock, kept in a timing wheel. The clock compares against the
+ * cached deadline of the earliest event every cycle; only when it is reached is the wheel slot for
+ * that cycle walked.
+ */
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EVENT_WHEEL_SLOTS 256 /* Power of two */
+/* nextDue of an empty queue, so the clock compare never fires. A real event can be due then too
+   (mtimecmp resets to it), so emptiness is always read from pending */
+#define NO_EVENT UINT64_MAX
+
+typedef void (*eventCallback)(void *arg);
+
+/* Owned by the caller, linked into the wheel while scheduled */
+typedef struct simEvent {
+    uint64_t when;
+    eventCallback callback;
+    void *arg;
+    bool scheduled;
+    bool background;   /* Bookkeeping such as stats export, does not count as work a waiting hart expects */
+    struct simEvent *next;
+} simEvent;
+
+typedef struct {
+    simEvent *wheel[EVENT_WHEEL_SLOTS];
+    uint32_t pending;             /* Scheduled events, 0 means nextDue holds no event */
+    uint32_t foregroundPending;   /* Scheduled events that are not background */
+    uint64_t nextDue;   /* Cycle of the earliest scheduled event, only meaningful while pending != 0 */
+} eventQueue;
+
+void eventQueueInit(eventQueue *queue);
+
+/**
+ * @brief Schedules ev to fire at cycle when, rescheduling it if it was already queued
+ */
+void eventSchedule(eventQueue *queue, simEvent *ev, uint64_t when);
+
+void eventCancel(eventQueue *queue, simEvent *ev);
+
+/**
+ * @brief Fires every event due at or before now. Called by the clock once now reaches nextDue
+ */
+void eventRunDue(eventQueue *queue, uint64_t now);
+
+#endif //EVENT_QUEUE_H
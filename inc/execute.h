@@ -0,0 +1,273 @@
+/**
+ * Execute stage body, shared by aluExecute and the specialised interpreter cores. It is always
+ * inlined so a constant extension set removes the handlers of the extensions that are left out.
+ */
+#ifndef EXECUTE_H
+#define EXECUTE_H
+
+#include <stdio.h>
+#include "alu.h"
+#include "sim.h"
+#include "isa.h"
+
+/**
+ * @brief Without C every instruction is word aligned, so a jump or taken branch to a target with bit 1
+ * set faults on the jump itself. A fused auipc+jalr still retires its auipc
+ */
+static inline __attribute__((always_inline)) void checkJumpAlignment(const decodedFields *df, decoder_to_execute *out,
+                                                                     uint32_t extensions) {
+    if ((extensions & ISA_C) || !out->branchTaken || !(out->nextPc & 2)) {
+        return;
+    }
+    out->exception = true;
+    out->cause = CAUSE_FETCH_MISALIGNED;
+    out->tval = out->nextPc;
+    if (df->microOp == OP_AUIPC_JALR) {
+        out->result = out->pc + (df->instrFields.fused.imm20 << 12);
+    } else {
+        out->writesRd = false;
+    }
+}
+
+static inline __attribute__((always_inline)) void executeFor(sim_t *sim, const decodedFields *df, uint32_t pc,
+                                                             decoder_to_execute *out, uint32_t extensions) {
+    uint32_t *x = sim->regFile.generalRegisters;
+    uint32_t rs1 = 0, rs2 = 0, imm = 0;
+
+    out->pc = pc;
+    out->nextPc = pc + df->length;
+    out->length = df->length;
+    out->microOp = df->microOp;
+    out->rd = 0;
+    out->rs1 = 0;
+    out->rs2 = 0;
+    out->result = 0;
+    out->memAddress = 0;
+    out->storeData = 0;
+    out->branchTaken = false;
+    out->writesRd = false;
+    out->csr = 0;
+    out->csrWrites = false;
+    out->exception = false;
+    out->vd = 0;
+    out->eew = 0;
+    out->vm = true;
+    out->fpResult = 0;
+    out->fpFlags = 0;
+    out->writesFd = false;
+    out->firstLength = 0;
+
+    /* Read operands according to the instruction format */
+    switch (df->instruction_type) {
+        case R_TYPE:
+            out->rd = df->instrFields.r_type.rd;
+            out->rs1 = df->instrFields.r_type.rs1;
+            out->rs2 = df->instrFields.r_type.rs2;
+            break;
+        case I_TYPE:
+            out->rd = df->instrFields.i_type.rd;
+            out->rs1 = df->instrFields.i_type.rs1;
+            imm = SIGN_EXTEND(df->instrFields.i_type.imm12, 12);
+            break;
+        case S_TYPE:
+            out->rs1 = df->instrFields.s_type.rs1;
+            out->rs2 = df->instrFields.s_type.rs2;
+            imm = SIGN_EXTEND(df->instrFields.s_type.imm12, 12);
+            break;
+        case B_TYPE:
+            out->rs1 = df->instrFields.b_type.rs1;
+            out->rs2 = df->instrFields.b_type.rs2;
+            imm = SIGN_EXTEND(df->instrFields.b_type.imm12, 13);
+            break;
+        case U_TYPE:
+            out->rd = df->instrFields.u_type.rd;
+            imm = df->instrFields.u_type.imm20 << 12;
+            break;
+        case J_TYPE:
+            out->rd = df->instrFields.j_type.rd;
+            imm = SIGN_EXTEND(df->instrFields.j_type.imm20, 21);
+            break;
+        case FUSED_TYPE:
+            out->rd = df->instrFields.fused.rd;
+            out->rs1 = df->instrFields.fused.rs1;
+            out->firstLength = df->instrFields.fused.firstLength;
+            imm = df->instrFields.fused.imm20;
+            break;
+        case V_TYPE:
+        case F_TYPE:
+            /* Vector and float instructions pick their operands themselves */
+            break;
+        case ILLEGAL_TYPE:
+            break;
+    }
+    if ((extensions & ISA_V) && isVectorOp(df->microOp)) {
+        vectorExecute(sim, df, out);
+        return;
+    }
+    if ((extensions & ISA_F) && isFloatOp(df->microOp)) {
+        floatExecute(sim, df, out);
+        return;
+    }
+    rs1 = x[out->rs1];
+    rs2 = x[out->rs2];
+    out->operand_1 = (int32_t)rs1;
+    out->operand_2 = rs2;
+    out->writesRd = true;
+
+    /* Decode never hands a core the ops of extensions it lacks, so their cases drop out of the switch */
+    if (!isaAllows(extensions, df->microOp)) {
+        __builtin_unreachable();
+    }
+    switch (df->microOp) {
+        case OP_ADD:    out->result = alu_add(rs1, rs2); break;
+        case OP_SUB:    out->result = alu_sub(rs1, rs2); break;
+        case OP_XOR:    out->result = alu_xor(rs1, rs2); break;
+        case OP_OR:     out->result = alu_or(rs1, rs2); break;
+        case OP_AND:    out->result = alu_and(rs1, rs2); break;
+        case OP_SLL:    out->result = alu_sll(rs1, rs2); break;
+        case OP_SRL:    out->result = alu_srl(rs1, rs2); break;
+        case OP_SRA:    out->result = (uint32_t)alu_sra((int32_t)rs1, rs2); break;
+        case OP_SLT:    out->result = alu_slt((int32_t)rs1, (int32_t)rs2); break;
+        case OP_SLTU:   out->result = alu_sltu(rs1, rs2); break;
+
+        case OP_ADDI:   out->result = alu_addi(rs1, imm); break;
+        case OP_XORI:   out->result = alu_xori(rs1, imm); break;
+        case OP_ORI:    out->result = alu_ori(rs1, imm); break;
+        case OP_ANDI:   out->result = alu_andi(rs1, imm); break;
+        case OP_SLLI:   out->result = alu_sll(rs1, imm); break;
+        case OP_SRLI:   out->result = alu_srl(rs1, imm); break;
+        case OP_SRAI:   out->result = (uint32_t)alu_sra((int32_t)rs1, imm); break;
+        case OP_SLTI:   out->result = alu_slt((int32_t)rs1, (int32_t)imm); break;
+        case OP_SLTIU:  out->result = alu_sltu(rs1, imm); break;
+
+        /* Loads finish in the memory access stage */
+        case OP_LB:
+        case OP_LH:
+        case OP_LW:
+        case OP_LBU:
+        case OP_LHU:
+            out->memAddress = alu_add(rs1, imm);
+            break;
+
+        case OP_SB:
+        case OP_SH:
+        case OP_SW:
+            out->memAddress = alu_add(rs1, imm);
+            out->storeData = rs2;
+            out->writesRd = false;
+            break;
+
+        case OP_BEQ:    out->branchTaken = alu_eq(rs1, rs2); break;
+        case OP_BNE:    out->branchTaken = alu_ne(rs1, rs2); break;
+        case OP_BLT:    out->branchTaken = alu_slt((int32_t)rs1, (int32_t)rs2); break;
+        case OP_BGE:    out->branchTaken = !alu_slt((int32_t)rs1, (int32_t)rs2); break;
+        case OP_BLTU:   out->branchTaken = alu_sltu(rs1, rs2); break;
+        case OP_BGEU:   out->branchTaken = !alu_sltu(rs1, rs2); break;
+
+        case OP_JAL:
+            out->result = pc + df->length;
+            out->nextPc = pc + imm;
+            out->branchTaken = true;
+            break;
+        case OP_JALR:
+            out->result = pc + df->length;
+            out->nextPc = (rs1 + imm) & ~1u;
+            out->branchTaken = true;
+            break;
+
+        case OP_LUI:    out->result = imm; break;
+        case OP_AUIPC:  out->result = pc + imm; break;
+
+        case OP_MUL:    out->result = alu_mul(rs1, rs2); break;
+        case OP_MULH:   out->result = alu_mulh((int32_t)rs1, (int32_t)rs2); break;
+        case OP_MULSU:  out->result = alu_mulhsu((int32_t)rs1, rs2); break;
+        case OP_MULU:   out->result = alu_mulhu(rs1, rs2); break;
+        case OP_DIV:    out->result = (uint32_t)alu_div_signed((int32_t)rs1, (int32_t)rs2); break;
+        case OP_DIVU:   out->result = alu_div(rs1, rs2); break;
+        case OP_REM:    out->result = (uint32_t)alu_mod_signed((int32_t)rs1, (int32_t)rs2); break;
+        case OP_REMU:   out->result = alu_mod(rs1, rs2); break;
+
+        /* Atomics read-modify-write in the memory access stage */
+        case OP_LRW:
+        case OP_SCW:
+        case OP_AMOSWAPW:
+        case OP_AMOADDW:
+        case OP_AMOANDW:
+        case OP_AMOORW:
+        case OP_AMOXORW:
+        case OP_AMOMAXW:
+        case OP_AMOMINW:
+        case OP_AMOMAXUW:
+        case OP_AMOMINUW:
+            out->memAddress = rs1;
+            out->storeData = rs2;
+            break;
+
+        /* The csr is read and written at write back, the operand is prepared here */
+        case OP_CSRRW:
+        case OP_CSRRS:
+        case OP_CSRRC:
+            out->csr = df->instrFields.i_type.imm12;
+            out->storeData = rs1;
+            out->csrWrites = df->microOp == OP_CSRRW || out->rs1 != 0;
+            break;
+        case OP_CSRRWI:
+        case OP_CSRRSI:
+        case OP_CSRRCI:
+            out->csr = df->instrFields.i_type.imm12;
+            out->storeData = out->rs1;
+            out->csrWrites = df->microOp == OP_CSRRWI || out->rs1 != 0;
+            out->rs1 = 0; /* Not a register read */
+            break;
+
+        /* Fused pairs, imm holds the immediate of the first instruction */
+        case OP_LUI_ADDI:
+            out->result = (imm << 12) + SIGN_EXTEND(df->instrFields.fused.imm12, 12);
+            break;
+        case OP_AUIPC_JALR:
+            /* rd keeps the auipc value of a tail call and is the link register of a call */
+            out->result = df->instrFields.fused.rd2 != 0 ? pc + df->length : pc + (imm << 12);
+            out->nextPc = (pc + (imm << 12) + SIGN_EXTEND(df->instrFields.fused.imm12, 12)) & ~1u;
+            out->branchTaken = true;
+            break;
+        case OP_AUIPC_LW:
+            /* result holds the auipc value until the load replaces it, a fault retires only the auipc */
+            out->result = pc + (imm << 12);
+            out->memAddress = out->result + SIGN_EXTEND(df->instrFields.fused.imm12, 12);
+            break;
+        case OP_SLLI_SRLI:
+            out->result = alu_srl(alu_sll(rs1, imm), df->instrFields.fused.imm12);
+            break;
+
+        /* Handled at write back */
+        case OP_SFENCE_VMA:
+        case OP_MRET:
+        case OP_WFI:
+            out->writesRd = false;
+            break;
+        case OP_ECALL:
+        case OP_EBREAK:
+        case OP_FENCE:
+        case OP_ILLEGAL:
+            out->writesRd = false;
+            break;
+
+        default:
+            perror("Instruction no implimented yet");
+            out->writesRd = false;
+    }
+
+    if (df->instruction_type == B_TYPE) {
+        out->writesRd = false;
+        if (out->branchTaken) {
+            out->nextPc = pc + imm;
+        }
+    }
+
+    checkJumpAlignment(df, out, extensions);
+
+    out->zero_flag = out->result == 0;
+    out->sign_flag = (out->result >> 31) & 1;
+}
+
+#endif //EXECUTE_H
@@ -0,0 +1,26 @@
+/**
+ * Instruction length aware fetch unit. Reads a 16 bit parcel at the program counter, and either
+ * completes a 32 bit instruction or expands the compressed one. The expansion of every 16 bit
+ * parcel is computed once per process into a read-only table shared by all simulators, so a
+ * compressed instruction costs one table lookup more than a normal one.
+ */
+#ifndef FETCH_H
+#define FETCH_H
+
+#include <stdint.h>
+#include "riscvsim.h"
+
+/**
+ * @brief Builds the expansion table, safe to call from any number of threads
+ */
+void fetchInit(void);
+
+/**
+ * @brief Fetches the instruction at pc
+ * @param length Set to 2 for compressed instructions and 4 otherwise. 0 marks a fetch fault, the
+ * cause is in the MMU's lastFault
+ * @return The 32 bit instruction, expanded if it was compressed. 0 (illegal) on a fetch fault
+ */
+uint32_t fetchParcel(sim_t *sim, uint32_t pc, uint8_t *length);
+
+#endif //FETCH_H
@@ -0,0 +1,63 @@
+/**
+ * Single and double precision floating point (RV32F and RV32D) executed on the host FPU.
+ *
+ * The f registers are 64 bits wide, single precision values live NaN-boxed in their low half and
+ * a single read from a register that is not a valid box yields the canonical NaN. NaN results are
+ * always canonical. The host rounding mode stays round to nearest even, so the common case runs
+ * without any mode switch; the other modes are set around the operation and restored. RMM has no
+ * host mode, it is computed in long double towards zero and rounded to the target in software.
+ * Exception flags are read back from the host after each operation and accrue into fflags at write
+ * back. The host flags are left set afterwards, the simulator does not preserve them for embedding
+ * code.
+ */
+#ifndef FPU_H
+#define FPU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "alu.h"
+
+/* Rounding modes, the rm field and frm */
+#define RM_RNE 0   /* Round to nearest, ties to even */
+#define RM_RTZ 1   /* Round towards zero */
+#define RM_RDN 2   /* Round down */
+#define RM_RUP 3   /* Round up */
+#define RM_RMM 4   /* Round to nearest, ties to max magnitude */
+#define RM_DYN 7   /* Use frm */
+
+/* fflags bits */
+#define FFLAG_NX (1u << 0)   /* Inexact */
+#define FFLAG_UF (1u << 1)   /* Underflow */
+#define FFLAG_OF (1u << 2)   /* Overflow */
+#define FFLAG_DZ (1u << 3)   /* Divide by zero */
+#define FFLAG_NV (1u << 4)   /* Invalid operation */
+#define FFLAGS_MASK 0x1Fu
+
+#define NAN_BOX 0xFFFFFFFF00000000ull
+#define CANONICAL_NAN_S 0x7FC00000u
+#define CANONICAL_NAN_D 0x7FF8000000000000ull
+
+typedef struct {
+    uint64_t regs[32];   /* f0-f31 */
+    uint32_t fflags;     /* Accrued exceptions */
+    uint32_t frm;        /* Dynamic rounding mode */
+} fpRegisterFile;
+
+void initFpRegFile(fpRegisterFile *fpRegFile);
+
+static inline bool isFloatOp(uint8_t microOp) {
+    return microOp >= OP_FLW && microOp <= OP_FCVT_D_S;
+}
+
+static inline bool isFloatMemoryOp(uint8_t microOp) {
+    return microOp >= OP_FLW && microOp <= OP_FSD;
+}
+
+/**
+ * @brief Execute stage for floating point instructions. Results for f registers go to out->fpResult
+ * with writesFd set, integer results to out->result, the raised flags to out->fpFlags. A reserved
+ * rounding mode is recorded in out as an illegal instruction exception
+ */
+void floatExecute(sim_t *sim, const decodedFields *df, decoder_to_execute *out);
+
+#endif //FPU_H
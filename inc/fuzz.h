@@ -0,0 +1,91 @@
+/**
+ * Coverage guided fuzzing with snapshot reset.
+ *
+ * The guest executes FUZZ_MARKER_INPUT where it wants an input, with the buffer address in a0 and
+ * its capacity in a1. The first time the marker retires the whole machine is snapshotted. Every
+ * input then starts from the snapshot with the input copied to the buffer and its length in a0.
+ * An input ends at FUZZ_MARKER_DONE, when the guest exits or crashes, or when its instruction
+ * budget runs out.
+ *
+ * Branches and jumps update an AFL compatible edge map with the block they continue at, which is
+ * what AFL's QEMU mode records as well. Resetting only copies back the ram pages written since the
+ * snapshot and the architectural, CLINT and event state. Pages are marked dirty when they enter a
+ * store TLB, so guest stores pay nothing for the tracking. The block device's image writes could not
+ * be undone, so fuzzing refuses a machine with one attached.
+ */
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "riscvsim.h"
+#include "csr.h"
+#include "clint.h"
+#include "eventQueue.h"
+#include "vector.h"
+#include "fpu.h"
+
+/* Guest markers, HINT encodings that every other RISC-V implementation runs as a nop */
+#define FUZZ_MARKER_INPUT 0x00100013u   /* addi x0, x0, 1 */
+#define FUZZ_MARKER_DONE 0x00200013u    /* addi x0, x0, 2 */
+
+/* Machine state at the input marker, ram is restored separately page by page */
+typedef struct {
+    uint32_t pc;
+    uint32_t x[32];
+    fpRegisterFile fp;
+    csrFile csrs;
+    vectorUnit vector;
+    uint32_t reservationAddress;
+    bool reservationValid;
+    clintDevice clint;
+    simEvent statsEvent;
+    eventQueue events;
+    uint64_t clockNow;
+    uint64_t instructionsRetired;
+    uint64_t wfiSkippedCycles;
+} fuzzSnapshot;
+
+typedef struct {
+    uint8_t *coverage;       /* SIM_FUZZ_MAP_SIZE edge hit counters, NULL while not fuzzing */
+    uint32_t prevLocation;   /* Hashed target of the previous edge, shifted as AFL does */
+    bool ready;              /* The snapshot has been taken */
+    bool inputRunning;       /* FUZZ_MARKER_DONE ends the run as well */
+    fuzzSnapshot snapshot;
+} fuzzState;
+
+/* AFL's edge hash over block addresses, the same as its QEMU mode uses */
+static inline void fuzzEdge(fuzzState *fuzz, uint32_t target) {
+    uint32_t location = ((target >> 4) ^ (target << 8)) & (SIM_FUZZ_MAP_SIZE - 1);
+    fuzz->coverage[location ^ fuzz->prevLocation]++;
+    fuzz->prevLocation = location >> 1;
+}
+
+/* Branches count taken or not, so the block after a fall through is an edge of its own */
+static inline bool fuzzIsControlTransfer(uint8_t op) {
+    return (op >= OP_BEQ && op <= OP_JALR) || op == OP_AUIPC_JALR;
+}
+
+/* Called by the interpreter loop for every retired instruction, true once a marker ends the run.
+   instruction is the one that just retired */
+static inline bool fuzzRetire(fuzzState *fuzz, const decoder_to_execute *ex, uint32_t instruction) {
+    if (fuzz->coverage != NULL && fuzzIsControlTransfer(ex->microOp)) {
+        fuzzEdge(fuzz, ex->nextPc);
+    }
+    return instruction == FUZZ_MARKER_INPUT || (fuzz->inputRunning && instruction == FUZZ_MARKER_DONE);
+}
+
+/**
+ * @brief Runs until the input marker retires and snapshots the machine there
+ * @return false if a block device is attached, or the program halted or maxInstructions ran out first
+ */
+bool fuzzStart(sim_t *sim, uint8_t *coverage, uint64_t maxInstructions);
+
+/**
+ * @brief Restores the snapshot, delivers input and runs it to one of the end conditions. A ram page
+ * that could not be saved before its first write ends fuzzing with SIM_FUZZ_ERROR
+ */
+sim_fuzz_result fuzzRun(sim_t *sim, const void *input, size_t bytes, uint64_t maxInstructions);
+
+#endif //FUZZ_H
@@ -0,0 +1,40 @@
+/**
+ * Functional model: runs instructions one after another without any pipeline timing.
+ * Also holds the memory access and write back stage logic shared with the pipeline threads.
+ */
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "alu.h"
+
+/* Never a valid pc, used to disable the stop marker of interpRun */
+#define NO_STOP_PC 0xFFFFFFFFu
+
+typedef enum {
+    INTERP_FUNCTIONAL,   /* Architectural state only */
+    INTERP_WARM,         /* Also trains the caches and branch predictor of the timing model */
+    INTERP_RETIRE,       /* Streams every retired instruction to the decoupled timing thread */
+    INTERP_FUZZ          /* Records edge coverage and stops once a fuzzing marker retires */
+} interpMode;
+
+/**
+ * @brief Memory access stage: performs the load, store or atomic of ex. A fault is recorded in ex
+ * and raised at write back
+ */
+void memAccessStage(sim_t *sim, decoder_to_execute *ex);
+
+/**
+ * @brief Write back stage: commits rd, handles system instructions and advances the program counter
+ */
+void writeBackStage(sim_t *sim, const decoder_to_execute *ex);
+
+/**
+ * @brief Runs up to n instructions on the selected core, stopping early if the program halts or the
+ * pc reaches stopPc. Fused pairs count as two instructions
+ * @return Number of instructions executed
+ */
+uint64_t interpRun(sim_t *sim, uint64_t n, interpMode mode, uint32_t stopPc);
+
+#endif //INTERPRETER_H
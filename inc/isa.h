@@ -0,0 +1,77 @@
+/**
+ * ISA configurations and the interpreter cores specialised for them. Each core is the interpreter
+ * loop compiled with its extension set as a constant (see isaCoreTemplate.h), so the fetch path of
+ * a core without C never looks for compressed parcels, and the decode, execute and memory access
+ * switches of a core without M, A, F, D or V have no cases for them. The core is picked from the
+ * Tag_RISCV_arch string of the ELF's .riscv.attributes section, the smallest one that covers it
+ * wins. Instructions of extensions outside the selected core decode as illegal; the pipeline
+ * decodes the full ISA and applies isaRestrict at run time.
+ */
+#ifndef ISA_H
+#define ISA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "alu.h"
+#include "interpreter.h"
+#include "vector.h"
+#include "fpu.h"
+
+/* Extension bits, the same as their misa bits */
+#define ISA_A (1u << 0)
+#define ISA_C (1u << 2)
+#define ISA_D (1u << 3)
+#define ISA_F (1u << 5)
+#define ISA_I (1u << 8)
+#define ISA_M (1u << 12)
+#define ISA_V (1u << 21)
+#define ISA_ALL (ISA_I | ISA_M | ISA_A | ISA_F | ISA_D | ISA_C | ISA_V)
+
+typedef struct {
+    const char *name;
+    uint32_t extensions;
+    uint64_t (*run)(sim_t *sim, uint64_t n, interpMode mode, uint32_t stopPc);
+} isaCore;
+
+/**
+ * @brief Parses an ISA string, "rv32imac" or the versioned "rv32i2p1_m2p0_zicsr2p0" form of the
+ * ELF attributes. Multi-letter extensions other than the Zve vector subsets are ignored
+ * @return false if it is not an RV32I string or names a single-letter extension the simulator lacks
+ */
+bool isaParse(const char *isa, uint32_t *extensions);
+
+/**
+ * @brief Smallest core that has every extension in extensions, the full one if none is that small
+ */
+const isaCore *isaSelectCore(uint32_t extensions);
+
+/* Micro-ops a core without the extension never decodes */
+static inline bool isaAllows(uint32_t extensions, uint8_t microOp) {
+    if (microOp >= OP_MUL && microOp <= OP_REMU) {
+        return extensions & ISA_M;
+    }
+    if (microOp >= OP_LRW && microOp <= OP_AMOMINUW) {
+        return extensions & ISA_A;
+    }
+    if (isVectorOp(microOp)) {
+        return extensions & ISA_V;
+    }
+    if (microOp == OP_FLD || microOp == OP_FSD || (microOp >= OP_FMADD_D && microOp <= OP_FCVT_D_WU) ||
+        microOp == OP_FCVT_S_D || microOp == OP_FCVT_D_S) {
+        return extensions & ISA_D;
+    }
+    if (isFloatOp(microOp)) {
+        return extensions & ISA_F;
+    }
+    return true;
+}
+
+/* Makes an instruction outside extensions illegal, compressed ones included when C is left out */
+static inline void isaRestrict(uint32_t extensions, decodedFields *df) {
+    if (!isaAllows(extensions, df->microOp) || (!(extensions & ISA_C) && df->length == 2)) {
+        df->microOp = OP_ILLEGAL;
+        df->instruction_type = ILLEGAL_TYPE;
+    }
+}
+
+#endif //ISA_H
@@ -0,0 +1,94 @@
+/**
+ * Interpreter core template. isaCores.c includes it once per core after defining CORE_NAME as the
+ * core's ISA string (an identifier) and CORE_EXTENSIONS as its extension bits, so it has no include
+ * guard. Every branch on CORE_EXTENSIONS is resolved at compile time, so decodeFor, executeFor,
+ * memAccessFor and writeBackFor keep only the opcodes of the core's extensions. Traps, system
+ * instructions and the per-extension decoders stay out of line and are shared by every core.
+ */
+#define CORE_CONCAT(prefix, name) prefix##_##name
+#define CORE_SYMBOL(prefix, name) CORE_CONCAT(prefix, name)
+#define CORE_QUOTE(name) #name
+#define CORE_STRING(name) CORE_QUOTE(name)
+
+/* Without C every instruction is one aligned word, no compressed expansion */
+static inline __attribute__((always_inline)) uint32_t CORE_SYMBOL(fetch, CORE_NAME)(sim_t *sim, uint32_t pc, uint8_t *length) {
+    uint32_t parcel = 0;
+
+    if (CORE_EXTENSIONS & ISA_C) {
+        return fetchParcel(sim, pc, length);
+    }
+    *length = mmuFetch(&sim->mmu, pc, 4, &parcel) ? 4 : 0;
+    return parcel;
+}
+
+/* One instruction, or a fused pair, through every stage. Each stage body is specialised on the core's extensions */
+static inline __attribute__((always_inline)) void CORE_SYMBOL(step, CORE_NAME)(sim_t *sim, decoder_to_execute *ex,
+                                                                               bool fuse, uint32_t stopPc) {
+    decodedFields df;
+    uint32_t pc;
+    uint32_t next;
+    uint8_t length;
+    uint8_t nextLength;
+
+    /* Interrupts are taken between instructions, before the next one is fetched */
+    checkInterrupts(sim);
+    pc = sim->regFile.programCounter;
+    sim->regFile.instructionRegister = CORE_SYMBOL(fetch, CORE_NAME)(sim, pc, &length);
+    decodeFor(sim->regFile.instructionRegister, &df, CORE_EXTENSIONS);
+    df.length = length;
+    if (fuse && length != 0 && pc + length != stopPc && isFusionHead(sim->regFile.instructionRegister)) {
+        next = CORE_SYMBOL(fetch, CORE_NAME)(sim, pc + length, &nextLength);
+        if (nextLength != 0) {
+            fuseInstructions(&df, next, nextLength);
+        }
+    }
+    executeFor(sim, &df, pc, ex, CORE_EXTENSIONS);
+    memAccessFor(sim, ex, CORE_EXTENSIONS);
+    writeBackFor(sim, ex, CORE_EXTENSIONS);
+}
+
+/* The interpreter loop, mode is a constant at every call so its per-instruction work is inlined */
+static inline __attribute__((always_inline)) uint64_t CORE_SYMBOL(loop, CORE_NAME)(sim_t *sim, uint64_t n,
+                                                                                   interpMode mode, uint32_t stopPc) {
+    decoder_to_execute ex;
+    retiredInstr rec;
+    uint64_t executed = 0;
+
+    while (executed < n && !sim->halted && sim->regFile.programCounter != stopPc) {
+        /* A fused pair counts as two instructions, so it must not overshoot n */
+        CORE_SYMBOL(step, CORE_NAME)(sim, &ex, sim->fusion && n - executed >= 2, stopPc);
+        executed += ex.firstLength != 0 ? 2 : 1;
+        if (mode == INTERP_WARM) {
+            makeRetiredInstr(&ex, &rec);
+            timingWarm(&sim->timing, &rec);
+        } else if (mode == INTERP_RETIRE) {
+            retirePush(&sim->retire, &ex);
+        } else if (mode == INTERP_FUZZ && fuzzRetire(&sim->fuzz, &ex, sim->regFile.instructionRegister)) {
+            break;
+        }
+    }
+    return executed;
+}
+
+/* One copy of the loop per mode */
+static uint64_t CORE_SYMBOL(run, CORE_NAME)(sim_t *sim, uint64_t n, interpMode mode, uint32_t stopPc) {
+    switch (mode) {
+        case INTERP_WARM:
+            return CORE_SYMBOL(loop, CORE_NAME)(sim, n, INTERP_WARM, stopPc);
+        case INTERP_RETIRE:
+            return CORE_SYMBOL(loop, CORE_NAME)(sim, n, INTERP_RETIRE, stopPc);
+        case INTERP_FUZZ:
+            return CORE_SYMBOL(loop, CORE_NAME)(sim, n, INTERP_FUZZ, stopPc);
+        default:
+            return CORE_SYMBOL(loop, CORE_NAME)(sim, n, INTERP_FUNCTIONAL, stopPc);
+    }
+}
+
+static const isaCore CORE_SYMBOL(core, CORE_NAME) = {
+    .name = CORE_STRING(CORE_NAME),
+    .extensions = CORE_EXTENSIONS,
+    .run = CORE_SYMBOL(run, CORE_NAME),
+};
+
+#undef CORE_NAME
+#undef CORE_EXTENSIONS
@@ -1,3 +1,26 @@
 /**
- * loadProgram will take a .hex file (with .data and .text separeated) and will load the ram with memory
- */
\ No newline at end of file
+ * loadProgram will take an ELF executable (with .data and .text separeated) and will load the ram with memory
+ */
+#ifndef LOAD_PROGRAM_H
+#define LOAD_PROGRAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ram.h"
+
+/**
+ * @brief Copies every PT_LOAD segment of a little-endian RV32 ELF to its physical address in ram
+ * and zero fills the rest of the segment (.bss)
+ * @param entry Set to the ELF entry point
+ * @return false if the file is not such an ELF or a segment does not fit in ram
+ */
+bool loadElf(const char *path, ram_t *ram, uint32_t *entry);
+
+/**
+ * @brief Reads the Tag_RISCV_arch string, "rv32i2p1_m2p0...", from the .riscv.attributes section
+ * @return false if the file has no such section or attribute
+ */
+bool elfArchString(const char *path, char *arch, size_t size);
+
+#endif //LOAD_PROGRAM_H
@@ -0,0 +1,104 @@
+/**
+ * Memory access stage body, shared by memAccessStage and the specialised interpreter cores. It is
+ * always inlined so a constant extension set removes the atomic, float and vector accesses of the
+ * extensions that are left out.
+ */
+#ifndef MEM_ACCESS_H
+#define MEM_ACCESS_H
+
+#include "alu.h"
+#include "sim.h"
+#include "isa.h"
+#include "mmu.h"
+#include "vector.h"
+
+/**
+ * @brief lr.w, sc.w and the AMOs, result gets the loaded word
+ * @return false if the access faulted, the fault is in sim->mmu.lastFault
+ */
+bool atomicAccess(sim_t *sim, decoder_to_execute *ex);
+
+/**
+ * @brief flw, fld, fsw and fsd, loads go to fpResult
+ * @return false if the access faulted, the fault is in mmu->lastFault
+ */
+bool floatAccess(mmuState *mmu, decoder_to_execute *ex);
+
+static inline __attribute__((always_inline)) void memAccessFor(sim_t *sim, decoder_to_execute *ex,
+                                                               uint32_t extensions) {
+    mmuState *mmu = &sim->mmu;
+    uint32_t loaded;
+    bool ok = true;
+
+    switch (ex->microOp) {
+        case OP_LB:  ok = mmuLoad(mmu, ex->memAddress, 1, true, &ex->result); break;
+        case OP_LH:  ok = mmuLoad(mmu, ex->memAddress, 2, true, &ex->result); break;
+        case OP_LW:  ok = mmuLoad(mmu, ex->memAddress, 4, false, &ex->result); break;
+        case OP_LBU: ok = mmuLoad(mmu, ex->memAddress, 1, false, &ex->result); break;
+        case OP_LHU: ok = mmuLoad(mmu, ex->memAddress, 2, false, &ex->result); break;
+
+        case OP_SB:  ok = mmuStore(mmu, ex->memAddress, 1, ex->storeData); break;
+        case OP_SH:  ok = mmuStore(mmu, ex->memAddress, 2, ex->storeData); break;
+        case OP_SW:  ok = mmuStore(mmu, ex->memAddress, 4, ex->storeData); break;
+
+        /* Leaves the auipc value in result if the load faults */
+        case OP_AUIPC_LW:
+            ok = mmuLoad(mmu, ex->memAddress, 4, false, &loaded);
+            if (ok) {
+                ex->result = loaded;
+            }
+            break;
+
+        case OP_LRW:
+        case OP_SCW:
+        case OP_AMOSWAPW:
+        case OP_AMOADDW:
+        case OP_AMOANDW:
+        case OP_AMOORW:
+        case OP_AMOXORW:
+        case OP_AMOMAXW:
+        case OP_AMOMINW:
+        case OP_AMOMAXUW:
+        case OP_AMOMINUW:
+            if (extensions & ISA_A) {
+                ok = atomicAccess(sim, ex);
+            }
+            break;
+
+        case OP_FLW:
+        case OP_FLD:
+        case OP_FSW:
+        case OP_FSD:
+            if (extensions & ISA_F) {
+                ok = floatAccess(mmu, ex);
+            }
+            break;
+
+        case OP_VLE:
+        case OP_VLSE:
+        case OP_VLM:
+        case OP_VSE:
+        case OP_VSSE:
+        case OP_VSM:
+            /* A trap raised in execute already left vstart alone */
+            if ((extensions & ISA_V) && !ex->exception) {
+                ok = vectorMemAccess(sim, ex);
+            }
+            break;
+
+        default:
+            /* Nothing to access in memory */
+            break;
+    }
+
+    if (!ok) {
+        /* Raised at write back so the trap is precise */
+        ex->exception = true;
+        ex->cause = mmu->lastFault.cause;
+        ex->tval = mmu->lastFault.tval;
+        ex->writesRd = ex->firstLength != 0;
+        ex->writesFd = false;
+    }
+}
+
+#endif //MEM_ACCESS_H
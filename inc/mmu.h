@@ -0,0 +1,143 @@
+/**
+ * Sv32 virtual memory. Every guest load, store and instruction fetch goes through a direct mapped
+ * software TLB that caches virtual page -> host pointer translations, so a hit is one compare and
+ * one add no matter if translation is on. Bare mode (M-mode or satp.MODE = 0) fills the same TLB
+ * with identity mappings. Only ram pages are cached, MMIO always takes the slow path to the bus.
+ */
+#ifndef MMU_H
+#define MMU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bus.h"
+#include "csr.h"
+
+#define PAGE_SHIFT 12
+#define PAGE_SIZE (1u << PAGE_SHIFT)
+#define PAGE_MASK (~(PAGE_SIZE - 1))
+
+#define TLB_ENTRIES 256 /* Power of two */
+#define TLB_INVALID 0xFFFu /* Never equal to a masked address */
+
+/* Sv32 page table entry bits */
+#define PTE_V (1u << 0)
+#define PTE_R (1u << 1)
+#define PTE_W (1u << 2)
+#define PTE_X (1u << 3)
+#define PTE_U (1u << 4)
+#define PTE_A (1u << 6)
+#define PTE_D (1u << 7)
+
+typedef struct {
+    uint32_t tag;       /* Virtual page address, TLB_INVALID when empty */
+    uintptr_t addend;   /* Host address = virtual address + addend */
+} tlbEntry;
+
+/* One TLB per access type, so permissions never have to be checked on a hit */
+typedef struct {
+    tlbEntry load[TLB_ENTRIES];
+    tlbEntry store[TLB_ENTRIES];
+    tlbEntry fetch[TLB_ENTRIES];
+} tlbSet;
+
+typedef enum {
+    ACCESS_LOAD,
+    ACCESS_STORE,
+    ACCESS_FETCH
+} accessType;
+
+/* Cause and faulting address of the last failed access */
+typedef struct {
+    uint32_t cause;
+    uint32_t tval;
+} mmuFault;
+
+typedef struct {
+    tlbSet tlbs[3];          /* Bare, S-mode and U-mode translation regimes */
+    tlbSet *current;         /* TLB set for the current translation regime */
+    tlbSet *data;            /* TLB set for loads and stores, the MPP regime while MPRV is set in M-mode */
+    mmuFault lastFault;
+    bool trapMisaligned;     /* Misaligned loads and stores fault instead of being carried out */
+    const csrFile *csrs;     /* Privilege, satp and mstatus of the hart */
+    busMap *bus;             /* Page table walks and MMIO */
+} mmuState;
+
+void mmuInit(mmuState *mmu, const csrFile *csrs, busMap *bus);
+
+/**
+ * @brief Drops every cached translation, on satp writes and SFENCE.VMA
+ */
+void mmuFlush(mmuState *mmu);
+
+/**
+ * @brief Also drops the identity mappings of the bare regime, after ram was restored from a
+ * snapshot so every page is marked dirty again on its next store
+ */
+void mmuFlushAll(mmuState *mmu);
+
+/**
+ * @brief Selects the TLB set after a privilege, satp or mstatus change
+ */
+void mmuUpdateMode(mmuState *mmu);
+
+/**
+ * @brief Records a load or store address misaligned fault
+ * @return false, so callers can return it directly
+ */
+bool mmuMisalignedFault(mmuState *mmu, uint32_t address, accessType type);
+
+/* Misaligned accesses never hit the TLB, so this is only checked on the slow paths */
+static inline bool mmuAligned(mmuState *mmu, uint32_t address, uint8_t bytes, accessType type) {
+    return !mmu->trapMisaligned || (address & (bytes - 1)) == 0 || mmuMisalignedFault(mmu, address, type);
+}
+
+/* TLB miss handling: page walk, TLB fill, MMIO dispatch, misaligned and page crossing accesses */
+bool mmuLoadSlow(mmuState *mmu, uint32_t address, uint8_t bytes, bool isSigned, uint32_t *value);
+bool mmuStoreSlow(mmuState *mmu, uint32_t address, uint8_t bytes, uint32_t value);
+bool mmuFetchSlow(mmuState *mmu, uint32_t address, uint8_t bytes, uint32_t *value);
+
+/**
+ * @brief Host pointer to a range of ram for bulk copies, filling the TLB on a miss
+ * @return NULL if the range crosses a page, is not ram or faults. The caller then falls back to
+ * single accesses, which report the fault
+ */
+uint8_t *mmuHostSpan(mmuState *mmu, uint32_t address, uint32_t bytes, accessType type);
+
+static inline tlbEntry *tlbLookup(tlbEntry *tlb, uint32_t address, uint8_t bytes) {
+    tlbEntry *entry = &tlb[(address >> PAGE_SHIFT) & (TLB_ENTRIES - 1)];
+    /* Misaligned accesses keep their low bits and never match, so they cannot cross a page here */
+    return (address & (PAGE_MASK | (bytes - 1))) == entry->tag ? entry : NULL;
+}
+
+static inline bool mmuLoad(mmuState *mmu, uint32_t address, uint8_t bytes, bool isSigned, uint32_t *value) {
+    tlbEntry *entry = tlbLookup(mmu->data->load, address, bytes);
+    if (__builtin_expect(entry != NULL, 1)) {
+        uint32_t raw = 0;
+        memcpy(&raw, (const void *)(address + entry->addend), bytes);
+        *value = extendLoad(raw, bytes, isSigned);
+        return true;
+    }
+    return mmuLoadSlow(mmu, address, bytes, isSigned, value);
+}
+
+static inline bool mmuStore(mmuState *mmu, uint32_t address, uint8_t bytes, uint32_t value) {
+    tlbEntry *entry = tlbLookup(mmu->data->store, address, bytes);
+    if (__builtin_expect(entry != NULL, 1)) {
+        memcpy((void *)(address + entry->addend), &value, bytes);
+        return true;
+    }
+    return mmuStoreSlow(mmu, address, bytes, value);
+}
+
+static inline bool mmuFetch(mmuState *mmu, uint32_t address, uint8_t bytes, uint32_t *value) {
+    tlbEntry *entry = tlbLookup(mmu->current->fetch, address, bytes);
+    if (__builtin_expect(entry != NULL, 1)) {
+        *value = 0;
+        memcpy(value, (const void *)(address + entry->addend), bytes);
+        return true;
+    }
+    return mmuFetchSlow(mmu, address, bytes, value);
+}
+
+#endif //MMU_H
@@ -0,0 +1,107 @@
+/**
+ * Out-of-order timing model. Instructions dispatch in order into a reorder buffer and a unified
+ * reservation station, rename their destination onto a physical register, issue to a functional
+ * unit as soon as their operands are ready and commit in order, issueWidth of each per cycle.
+ *
+ * The model works out the dispatch, issue, complete and commit cycle of each instruction as it
+ * arrives instead of stepping cycles. The ROB and the rename registers are rings of commit cycles,
+ * the reservation station a min-heap of issue cycles and the issue slots a ring indexed by cycle,
+ * all sized once at init, so an instruction costs the same whatever the ROB size. Only the
+ * instructions still in the reservation station issue past the current dispatch cycle, and none of
+ * them later than the smaller of rsEntries and robEntries times the longest latency, so the slot
+ * ring is sized to cover that window rather than the whole ROB.
+ *
+ * Only true dependencies through the integer registers are tracked, memory disambiguation is
+ * perfect and a physical register is freed when the instruction that wrote it commits.
+ */
+#ifndef OOO_H
+#define OOO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define OOO_MAX_WIDTH 4
+#define OOO_MAX_UNITS 4          /* Per functional unit class */
+#define OOO_MAX_ENTRIES 16384    /* ROB and reservation station entries, and rename registers past the 32 */
+
+typedef enum {
+    FU_ALU,       /* Integer, branches, jumps, system and vector arithmetic */
+    FU_MUL,
+    FU_DIV,       /* Not pipelined */
+    FU_MEM,       /* Loads, stores and atomics */
+    FU_FP,
+    FU_FP_DIV,    /* Float divide and square root, not pipelined */
+    FU_CLASSES
+} fuClass;
+
+typedef struct {
+    uint32_t issueWidth;          /* Dispatch, issue and commit width, 1 to OOO_MAX_WIDTH */
+    uint32_t robEntries;          /* 1 to OOO_MAX_ENTRIES */
+    uint32_t rsEntries;           /* Unified reservation station, 1 to OOO_MAX_ENTRIES */
+    uint32_t physRegs;            /* Integer physical registers, 33 to 32 + OOO_MAX_ENTRIES */
+    uint32_t units[FU_CLASSES];   /* 1 to OOO_MAX_UNITS of each */
+} oooConfig;
+
+typedef struct {
+    uint64_t robCycles;            /* Sum of cycles from dispatch to commit, / cycles is the mean ROB occupancy */
+    uint64_t robStalls;            /* Dispatch cycles lost to a full ROB */
+    uint64_t rsStalls;             /* ... to a full reservation station */
+    uint64_t renameStalls;         /* ... to running out of physical registers */
+    uint64_t unitBusy[FU_CLASSES]; /* Busy unit cycles, / (units * cycles) is the utilisation */
+} oooStats;
+
+/* Dispatch, issue, complete and commit cycle of one instruction */
+typedef struct {
+    uint64_t dispatch;
+    uint64_t issue;
+    uint64_t complete;
+    uint64_t commit;
+} oooTimes;
+
+/* Issue slots taken in one cycle, in total and per unit class */
+typedef struct {
+    uint64_t cycle;
+    uint8_t used[FU_CLASSES + 1];
+} oooSlot;
+
+typedef struct {
+    oooConfig cfg;
+    uint64_t *robCommit;     /* Commit cycles of the last robEntries instructions, a ring */
+    uint64_t *renameCommit;  /* Commit cycles of the last physRegs - 32 register writers, a ring */
+    uint64_t *rsIssue;       /* Issue cycles of the instructions in the reservation station, a min-heap */
+    uint32_t rsCount;
+    oooSlot *slots;          /* Ring of slotMask + 1 cycles, a power of two */
+    uint64_t slotMask;
+    uint64_t unitFree[FU_CLASSES][OOO_MAX_UNITS];   /* Cycle each unpipelined unit frees up */
+    uint64_t regReady[32];   /* Cycle the newest value of each register is available */
+    uint64_t instructions;
+    uint64_t writers;
+    uint64_t dispatchCycle;  /* Cycle of the last dispatch and how many went in it */
+    uint32_t dispatchCount;
+    uint64_t commitCycle;    /* Same for commit */
+    uint32_t commitCount;
+} oooModel;
+
+/* Three wide with a 64 entry ROB unless the caller passes its own config */
+extern const oooConfig oooDefaults;
+
+/**
+ * @brief Checks the widths, sizes and unit counts are in range
+ */
+bool oooConfigValid(const oooConfig *cfg);
+
+/**
+ * @brief Allocates the model's rings, maxLatency is the longest latency oooSchedule will be given
+ * @return false if they could not be allocated, oooCleanup still has to be called
+ */
+bool oooInit(oooModel *model, const oooConfig *cfg, uint32_t maxLatency);
+void oooCleanup(oooModel *model);
+
+/**
+ * @brief Schedules one instruction the frontend delivered at cycle ready. Serializing instructions
+ * dispatch into an empty ROB. Stalls and busy cycles are added to stats
+ */
+void oooSchedule(oooModel *model, uint8_t rd, uint8_t rs1, uint8_t rs2, fuClass unit, uint32_t latency,
+                 bool serializing, uint64_t ready, oooStats *stats, oooTimes *times);
+
+#endif //OOO_H
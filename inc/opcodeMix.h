@@ -0,0 +1,25 @@
+/**
+ * Opcode mix: retired macro-ops counted per microOp at write back, so the interpreter and the
+ * pipeline share one set of counters. Counting is a single increment, classes are only formed when
+ * the mix is printed. A fused pair counts once under its fused microOp.
+ */
+#ifndef OPCODE_MIX_H
+#define OPCODE_MIX_H
+
+#include <stdint.h>
+#include "controlUnit.h"
+
+typedef struct {
+    uint64_t counts[OP_COUNT];
+} opcodeMix;
+
+static inline void opcodeMixCount(opcodeMix *mix, uint8_t microOp) {
+    mix->counts[microOp]++;
+}
+
+/**
+ * @brief Prints the share of each instruction class and how many pairs of each kind were fused
+ */
+void printOpcodeMix(const opcodeMix *mix);
+
+#endif //OPCODE_MIX_H
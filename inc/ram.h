@@ -6,6 +6,7 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 
 
@@ -15,10 +16,29 @@
 // uint32_t ramInstruction[UINT32_MAX];
 // uint32_t ramData[UINT32_MAX];
 
+/* Loads and stores copy straight between guest and host memory, which only works on a little-endian host */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Guest memory needs a little-endian host"
+#endif
+
 typedef struct{
-   uint32_t *data;
-   size_t size;
+   uint8_t *data;
+   size_t size; /* In bytes */
+
+   /* Snapshot support, tracking is off until ramSnapshot is called */
+   uint8_t *dirty;          /* Per page: written since the snapshot was last restored */
+   uint8_t **saved;         /* Per page: contents at the snapshot, copied before its first write */
+   uint32_t *dirtyList;     /* Pages ramRestore has to copy back */
+   uint32_t dirtyCount;
+   bool snapshotLost;       /* A page could not be saved, ramRestore would leave it as written */
 }ram_t;
+
+/* Dirty tracking granularity, the same as the MMU page size */
+#define RAM_PAGE_SHIFT 12
+#define RAM_PAGE_SIZE (1u << RAM_PAGE_SHIFT)
+
+/* Default guest memory shared by instruction fetch and data accesses, 512 MiB starting at address 0 */
+#define RAM_SIZE_BYTES (512u << 20)
 /*
    Open ASM file (parameter)
    populate ram reg with 32 bit instructions
@@ -37,15 +57,69 @@ typedef struct{
   POSTCOND: ram array populated
 */
 
-void initRam(ram_t *ram, size_t size);
-void populateRAM(char* binFileName, ram_t *ram);
+bool initRam(ram_t *ram, size_t bytes);
+bool populateRAM(const char* binFileName, ram_t *ram);
 void populateDataRAM();
 void cleanRam(ram_t *ram);
 
 /* Function 2*/
 /*POSTCOND: RETURN MACHINE CODE STRING*/
 
-uint32_t fetchInstruction(int program);
+uint32_t fetchInstruction(ram_t *ram, uint32_t address);
 /*Function 3*/
 
+/* Host view of bytes [address, address + bytes) for bulk copies, NULL if outside of ram.
+   Writers that bypass storeMemory and the MMU have to call ramMarkDirty */
+uint8_t *ramPointer(const ram_t *ram, uint32_t address, uint32_t bytes);
+
+/**
+ * @brief Makes the current contents the snapshot ramRestore returns to and starts dirty tracking
+ * @return false if the tracking tables could not be allocated
+ */
+bool ramSnapshot(ram_t *ram);
+
+/**
+ * @brief Copies the snapshot contents back into every page written since the last restore
+ */
+void ramRestore(ram_t *ram);
+
+void ramMarkDirtySlow(ram_t *ram, uint32_t page);
+
+/* Must be called before a page is written, free while no snapshot is taken */
+static inline void ramMarkDirty(ram_t *ram, uint32_t address) {
+   if (__builtin_expect(ram->dirty != NULL, 0) && !ram->dirty[address >> RAM_PAGE_SHIFT]) {
+      ramMarkDirtySlow(ram, address >> RAM_PAGE_SHIFT);
+   }
+}
+
+static inline uint32_t extendLoad(uint32_t raw, uint8_t bytes, bool isSigned) {
+   switch (bytes) {
+      case 1: return isSigned ? (uint32_t)(int32_t)(int8_t)raw : (raw & 0xFF);
+      case 2: return isSigned ? (uint32_t)(int32_t)(int16_t)raw : (raw & 0xFFFF);
+      default: return raw;
+   }
+}
+
+/* Data accesses of 1, 2 or 4 bytes at any alignment, each a single host access of that width.
+   Return false if the address is outside of ram */
+static inline bool loadMemory(const ram_t *ram, uint32_t address, uint8_t bytes, bool isSigned, uint32_t *value) {
+   uint32_t raw = 0;
+   if ((uint64_t)address + bytes > ram->size) {
+      return false;
+   }
+   memcpy(&raw, ram->data + address, bytes);
+   *value = extendLoad(raw, bytes, isSigned);
+   return true;
+}
+
+static inline bool storeMemory(ram_t *ram, uint32_t address, uint8_t bytes, uint32_t value) {
+   if ((uint64_t)address + bytes > ram->size) {
+      return false;
+   }
+   ramMarkDirty(ram, address);
+   ramMarkDirty(ram, address + bytes - 1);
+   memcpy(ram->data + address, &value, bytes);
+   return true;
+}
+
 #endif //RAM_H
\ No newline at end of file
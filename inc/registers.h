@@ -12,5 +12,5 @@ typedef struct {
     uint32_t *generalRegisters; //Size: 32 elements
 } registerFile;
 void initRegFile(registerFile *regFile);
-extern registerFile regFile;
+void cleanRegFile(registerFile *regFile);
 #endif //REGISTERS_H
\ No newline at end of file
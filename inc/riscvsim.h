@@ -0,0 +1,159 @@
+/**
+ * Embeddable RV32IMAC simulator. Each sim_t owns all of its machine and model state, so any number
+ * of simulators can live in one process. A single instance must only be driven by one thread at a
+ * time; different instances may run concurrently.
+ */
+#ifndef RISCVSIM_H
+#define RISCVSIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported from libriscvsim.so, which is built with hidden visibility */
+#define SIM_API __attribute__((visibility("default")))
+
+typedef struct sim sim_t;
+
+typedef enum {
+    SIM_MODE_DETAILED,    /* Every instruction goes through the pipeline threads */
+    SIM_MODE_FUNCTIONAL,  /* Interpreter only, no timing */
+    SIM_MODE_SAMPLED,     /* Fast-forward with periodic detailed samples */
+    SIM_MODE_DECOUPLED    /* Interpreter with the timing model on a second host thread */
+} sim_mode;
+
+/* How the detailed pipeline's five stages are spread over host threads */
+typedef enum {
+    SIM_PIPELINE_PER_STAGE,   /* One thread per stage */
+    SIM_PIPELINE_SPLIT,       /* Fetch and decode in one thread, execute to write back in another */
+    SIM_PIPELINE_ONE_THREAD   /* All stages back to back in one thread, no hand-offs */
+} sim_pipeline_layout;
+
+/* What a load or store that is not naturally aligned does */
+typedef enum {
+    SIM_MISALIGNED_SPLIT,   /* Carried out, split into bytes where it crosses a page */
+    SIM_MISALIGNED_TRAP     /* Raises an address misaligned exception */
+} sim_misaligned_policy;
+
+/* Register number of the program counter for sim_read_reg, x0-x31 are 0-31 */
+#define SIM_REG_PC 32
+
+typedef struct {
+    sim_mode mode;
+    uint32_t ram_bytes;        /* Guest ram mapped at physical address 0 */
+    sim_misaligned_policy misaligned;
+    const char *isa;           /* Interpreter core for this ISA string, "rv32imac", NULL to follow the ELF attributes */
+    uint32_t vlen;             /* Vector register width in bits, a power of two from 32 to 256 */
+    int uart_fd;               /* Host file descriptor the UART transmits to */
+    const char *disk_image;    /* Backing file of the block device, NULL for none */
+    uint64_t wfi_sleep_hz;     /* 0 skips WFI idle time instantly, otherwise mtime ticks per host second */
+    const char *stats_name;    /* shm_open name to publish live statistics under, NULL for none */
+    uint64_t stats_interval;   /* Simulated cycles between two statistics updates */
+    bool fusion;               /* Fuse lui+addi, auipc+jalr, auipc+lw and slli+srli into one macro-op */
+    uint32_t fetch_width;      /* Instructions fetched per cycle, from one I-cache line */
+    uint32_t fetch_queue_depth; /* Fetch queue entries, from fetch_width up to 64 */
+    sim_pipeline_layout pipeline_layout;
+    const char *pipeline_cpus; /* Host CPUs to pin the pipeline threads to, "0,2", NULL for none */
+
+    /* Out-of-order timing model */
+    uint32_t issue_width;      /* 0 keeps the in-order pipeline, 1 to 4 times the program out of order */
+    uint32_t rob_entries;      /* Reorder buffer entries */
+    uint32_t rs_entries;       /* Reservation station entries */
+    uint32_t phys_regs;        /* Integer physical registers, more than 32 */
+
+    /* Sampled mode */
+    uint64_t fast_forward;     /* Instructions to skip before the first sample */
+    uint32_t start_pc;         /* Or skip until this pc is reached, 0xFFFFFFFF to disable */
+    uint64_t warmup;           /* Warming instructions before each measurement */
+    uint64_t detail;           /* Instructions measured in the detailed pipeline per sample */
+    uint64_t period;           /* Distance between the start of two samples, in instructions */
+} sim_config;
+
+/**
+ * @brief Fills config with the defaults sim_create uses when it is given NULL
+ */
+SIM_API void sim_default_config(sim_config *config);
+
+/**
+ * @brief Creates a simulator with zeroed ram, pc at 0 and sp at the top of ram
+ * @return NULL if the instance or one of its devices could not be set up
+ */
+SIM_API sim_t *sim_create(const sim_config *config);
+
+/**
+ * @brief Loads the PT_LOAD segments of a little-endian RV32 ELF into ram and jumps to its entry point
+ * @return false if the file is not such an ELF or a segment does not fit in ram
+ */
+SIM_API bool sim_load_elf(sim_t *sim, const char *path);
+
+/**
+ * @brief Loads a raw binary at address 0
+ */
+SIM_API bool sim_load_binary(sim_t *sim, const char *path);
+
+/**
+ * @brief Runs up to n_instructions in the configured mode, stopping early if the program halts
+ * @return Number of instructions retired by this call
+ */
+SIM_API uint64_t sim_run(sim_t *sim, uint64_t n_instructions);
+
+/**
+ * @brief Reads x0-x31, or the program counter for SIM_REG_PC. Other numbers read as 0
+ */
+SIM_API uint32_t sim_read_reg(const sim_t *sim, unsigned reg);
+
+/**
+ * @brief Copies bytes of guest ram starting at physical address into buffer
+ * @return false if the range is not entirely inside ram
+ */
+SIM_API bool sim_read_mem(const sim_t *sim, uint32_t address, void *buffer, size_t bytes);
+
+/* Set once the guest exits, hits ebreak or takes a fault with no handler installed */
+SIM_API bool sim_halted(const sim_t *sim);
+SIM_API int sim_exit_code(const sim_t *sim);
+SIM_API uint64_t sim_instructions_retired(const sim_t *sim);
+
+/* Fuzzing, the guest side of the protocol is described in inc/fuzz.h */
+#define SIM_FUZZ_MAP_SIZE 65536   /* Edge map size, AFL's MAP_SIZE */
+
+typedef enum {
+    SIM_FUZZ_OK,        /* Reached the done marker, exited or went idle */
+    SIM_FUZZ_CRASH,     /* Fault with no handler installed, or ebreak */
+    SIM_FUZZ_TIMEOUT,   /* Ran out of instructions */
+    SIM_FUZZ_ERROR      /* A written page could not be saved, the snapshot is gone and later runs fail */
+} sim_fuzz_result;
+
+/**
+ * @brief Runs the program functionally until it reaches its input marker and snapshots it there.
+ * Every later sim_fuzz_run adds its edges to coverage, which holds SIM_FUZZ_MAP_SIZE counters
+ * @return false if a block device is attached, or the program halted or max_instructions ran out
+ * before the marker
+ */
+SIM_API bool sim_fuzz_start(sim_t *sim, uint8_t *coverage, uint64_t max_instructions);
+
+/**
+ * @brief Resets to the snapshot and runs one input for up to max_instructions. Inputs longer than
+ * the guest buffer are truncated. The state is left as the input ended until the next call
+ * @return SIM_FUZZ_CRASH as well if sim_fuzz_start has not succeeded
+ */
+SIM_API sim_fuzz_result sim_fuzz_run(sim_t *sim, const void *input, size_t bytes, uint64_t max_instructions);
+
+/**
+ * @brief Prints the statistics of the configured mode to stdout
+ */
+SIM_API void sim_print_stats(const sim_t *sim);
+
+/**
+ * @brief Stops the pipeline threads, syncs the block device and frees the instance
+ */
+SIM_API void sim_destroy(sim_t *sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RISCVSIM_H
@@ -0,0 +1,44 @@
+/**
+ * Sampled simulation: fast-forwards functionally through the program and only runs short,
+ * periodic measurement intervals through the detailed pipeline. Each interval is preceded by a
+ * warming window that trains the caches and branch predictor. Whole-program CPI is extrapolated
+ * from the samples together with a confidence interval, which needs at least two samples.
+ */
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "riscvsim.h"
+
+typedef struct {
+    uint64_t fastForward;      /* Instructions to skip before the first sample */
+    uint32_t startPc;          /* Or skip until this pc is reached, NO_STOP_PC to disable */
+    uint64_t warmup;           /* Warming instructions before each measurement */
+    uint64_t detail;           /* Instructions measured in the detailed pipeline per sample */
+    uint64_t period;           /* Distance between the start of two samples, in instructions */
+    uint64_t maxInstructions;  /* Stop after this many instructions, 0 for the whole program */
+} samplerConfig;
+
+typedef struct {
+    uint64_t samples;
+    uint64_t instructions;     /* Total retired, functional and detailed */
+    uint64_t detailedInstructions;
+    double meanCpi;
+    double stddevCpi;
+    double cpiLow;             /* 95% confidence bounds of the mean, Student t with samples - 1 degrees */
+    double cpiHigh;
+    bool hasInterval;          /* False with a single sample, the bounds are then just the mean */
+    double estimatedCycles;
+} samplerResult;
+
+extern const samplerConfig samplerDefaults;
+
+/**
+ * @brief Runs the loaded program to completion in sampled mode and extrapolates its CPI
+ */
+void runSampled(sim_t *sim, const samplerConfig *cfg, samplerResult *result);
+
+void printSamplerResult(const samplerResult *result);
+
+#endif //SAMPLER_H
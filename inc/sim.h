@@ -0,0 +1,82 @@
+/**
+ * Simulator instance. Every piece of architectural, device and model state lives in struct sim,
+ * so each function works on the instance it is handed and simulators never share anything but
+ * read-only tables.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "riscvsim.h"
+#include "registers.h"
+#include "ram.h"
+#include "csr.h"
+#include "bus.h"
+#include "mmu.h"
+#include "eventQueue.h"
+#include "clint.h"
+#include "uart.h"
+#include "blockDevice.h"
+#include "timing.h"
+#include "sampler.h"
+#include "controlUnit.h"
+#include "statsExport.h"
+#include "vector.h"
+#include "fpu.h"
+#include "opcodeMix.h"
+#include "fuzz.h"
+#include "decoupled.h"
+#include "isa.h"
+
+struct sim {
+    sim_mode mode;
+
+    /* Architectural state */
+    registerFile regFile;
+    fpRegisterFile fpRegFile;
+    csrFile csrs;
+    ram_t mainMemory;
+    vectorUnit vector;
+    uint32_t reservationAddress;   /* LR/SC reservation, there is only one hart */
+    bool reservationValid;
+
+    /* Physical address map and devices */
+    busMap bus;
+    mmuState mmu;
+    uartDevice uart;
+    clintDevice clint;
+    blockDevice disk;
+
+    /* Simulated time, one tick per retired instruction */
+    uint64_t clockNow;
+    eventQueue events;
+    uint64_t wfiSleepHz;           /* Host sleep rate for WFI, 0 skips idle time instantly */
+    uint64_t wfiSkippedCycles;     /* Cycles jumped over while the hart was in WFI */
+
+    /* Set once the guest exits, hits ebreak or faults */
+    volatile bool halted;
+    bool crashed;                  /* Halted by ebreak or a fault no handler could take */
+    int exitCode;
+
+    /* Total instructions retired by the interpreter and the pipeline */
+    uint64_t instructionsRetired;
+    opcodeMix mix;
+    bool fusion;                   /* Decode common instruction pairs into one macro-op */
+    const isaCore *core;           /* Interpreter specialised for the program's extensions */
+    bool isaForced;                /* core came from the config, ELF attributes do not change it */
+
+    /* Timing models */
+    timingModel timing;
+    samplerConfig sampler;
+    samplerResult samplerResult;
+    pipelineState pipeline;
+    retireQueue retire;            /* Decoupled mode */
+
+    /* Live statistics for external monitors */
+    statsExport stats;
+
+    fuzzState fuzz;
+};
+
+#endif //SIM_H
@@ -0,0 +1,74 @@
+/**
+ * Live statistics published in a POSIX shared memory object, so a long run can be watched (see
+ * tools/simtop.c) without pausing the simulator or parsing stdout. The simulator is the only writer
+ * and never waits: the block is guarded by a sequence lock that is odd while an update is in
+ * progress, and readers retry until they copy it between two identical even sequence values.
+ */
+#ifndef STATS_EXPORT_H
+#define STATS_EXPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "riscvsim.h"
+#include "eventQueue.h"
+#include "timing.h"
+
+#define SIM_STATS_MAGIC 0x54535652u   /* "RVST" */
+#define SIM_STATS_VERSION 4
+
+typedef enum {
+    STATS_RUNNING,   /* Inside sim_run */
+    STATS_PAUSED,    /* sim_run returned before the program halted */
+    STATS_HALTED,
+    STATS_CLOSED     /* Instance destroyed, nothing will update the block again */
+} statsState;
+
+/* Layout of the shared memory object */
+typedef struct {
+    _Atomic uint32_t magic;        /* Written last, once the rest of the header is valid */
+    uint32_t version;
+    _Atomic uint32_t sequence;     /* Odd while the fields below are being written */
+    uint32_t pid;
+
+    uint32_t mode;                 /* sim_mode */
+    uint32_t state;                /* statsState */
+    uint32_t pc;
+    int32_t exitCode;
+    uint64_t clock;                /* Simulated time, what mtime reads */
+    uint64_t instructions;
+    uint64_t idleCycles;           /* Skipped while waiting in WFI */
+    timingStats timing;            /* Detailed model totals, zero in functional mode. While running only
+                                      cycles, instructions and the stalls are refreshed */
+} simStatsBlock;
+
+typedef struct {
+    simStatsBlock *block;          /* NULL when exporting is off */
+    char *name;
+    uint64_t interval;             /* Simulated cycles between updates */
+    simEvent event;
+} statsExport;
+
+/**
+ * @brief Creates the shared memory object name and publishes to it every interval cycles
+ * @return false if the object could not be created or mapped
+ */
+bool statsExportOpen(sim_t *sim, const char *name, uint64_t interval);
+
+/**
+ * @brief Writes the state and counters of sim into the block under the sequence lock, and the full
+ * timing totals unless state is STATS_RUNNING
+ */
+void statsPublish(sim_t *sim, statsState state);
+
+/**
+ * @brief Publishes STATS_CLOSED, then unmaps and unlinks the object
+ */
+void statsExportClose(sim_t *sim);
+
+/**
+ * @brief Reader side of the sequence lock: copies a consistent snapshot of block into out
+ */
+void statsSnapshot(const simStatsBlock *block, simStatsBlock *out);
+
+#endif //STATS_EXPORT_H
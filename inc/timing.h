@@ -0,0 +1,149 @@
+/**
+ * Timing model for the in-order five stage pipeline. Each retired instruction costs one cycle plus
+ * stalls from data cache misses, load-use hazards and multi-cycle multiply/divide and floating point.
+ * A fused pair issues as one macro-op. Caches and predictors can be warmed without charging cycles.
+ *
+ * The frontend is decoupled: it fetches blocks of up to fetchWidth instructions from one I-cache line
+ * into a fetchQueueDepth entry queue, ending a block at every predicted taken branch, and runs ahead
+ * of decode while the queue has room. I-cache misses are only charged for the cycles decode actually
+ * waits on an empty queue. Mispredicts, traps and serializing instructions flush the queue.
+ *
+ * With outOfOrder set the same frontend feeds the out-of-order backend of ooo.h instead, and the
+ * cycles are counted at commit.
+ */
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "alu.h"
+#include "ooo.h"
+
+/* Compact record of one retired instruction, everything the timing model needs */
+typedef struct {
+    uint32_t pc;
+    uint32_t nextPc;
+    uint32_t memAddress;
+    uint8_t microOp;
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    uint8_t length;
+    bool branchTaken;
+} retiredInstr;
+
+typedef struct {
+    uint32_t sets;       /* Power of two */
+    uint32_t ways;
+    uint32_t lineBytes;  /* Power of two */
+} cacheConfig;
+
+typedef struct {
+    cacheConfig icache;
+    cacheConfig dcache;
+    uint32_t predictorEntries;   /* 2-bit bimodal counters, power of two */
+    uint32_t btbEntries;         /* Direct mapped branch target buffer, power of two */
+    uint32_t fetchWidth;         /* Instructions per fetch block, never crossing an I-cache line */
+    uint32_t fetchQueueDepth;    /* At least fetchWidth */
+    uint32_t missPenalty;        /* Cycles to refill a line from memory */
+    uint32_t mispredictPenalty;  /* Branches resolve in execute */
+    uint32_t loadUsePenalty;
+    uint32_t mulLatency;
+    uint32_t divLatency;
+    uint32_t fpLatency;          /* Float add, multiply, fused multiply-add and conversions */
+    uint32_t fpDivLatency;       /* Float divide and square root */
+    bool outOfOrder;             /* Out-of-order backend instead of the in-order pipeline */
+    oooConfig ooo;
+} timingConfig;
+
+typedef struct {
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t icacheMisses;
+    uint64_t dcacheMisses;
+    uint64_t mispredicts;
+    /* Stall breakdown in cycles, I-cache, branch and fetch stalls are cycles decode found the fetch
+       queue empty */
+    uint64_t icacheStalls;
+    uint64_t dcacheStalls;
+    uint64_t branchStalls;
+    uint64_t fetchStalls;        /* Queue refills after traps and serializing instructions */
+    uint64_t loadUseStalls;
+    uint64_t mulDivStalls;       /* Includes the float latencies */
+    oooStats ooo;                /* Out-of-order backend only, which overlaps the three above */
+} timingStats;
+
+typedef struct {
+    cacheConfig cfg;
+    uint32_t *tags;      /* sets * ways, line address + 1 so that 0 means invalid */
+    uint32_t *lastUse;   /* LRU stamps */
+    uint32_t clock;
+    uint32_t lineShift;
+} cacheModel;
+
+typedef struct {
+    timingConfig cfg;
+    timingStats totals;      /* Accumulated by timingAccount only, warming is free */
+    cacheModel icache;
+    cacheModel dcache;
+    uint8_t *predictor;      /* 2-bit saturating counters */
+    uint32_t *btbTags;
+    uint32_t *btbTargets;
+    uint8_t lastLoadRd;      /* Destination of the previous instruction if it was a load */
+
+    /* Decoupled frontend, all times are cycles of the model's own clock */
+    uint64_t clock;          /* Cycle the next instruction can issue */
+    uint64_t fetchClock;     /* Cycle the fetch unit can start the next block */
+    uint64_t blockReady;     /* Cycle the current block reached the queue */
+    uint64_t blockMiss;      /* Cycles of that spent on an I-cache miss */
+    bool blockMispredict;    /* The block was refetched after a mispredict */
+    bool redirectMispredict; /* The next block will be */
+    uint32_t blockLine;
+    uint32_t blockLeft;      /* Instructions left in the current block, 0 starts a new one */
+    uint32_t expectedPc;     /* Where fetch continues after the last instruction */
+    uint64_t *issued;        /* Issue cycles of the last fetchQueueDepth instructions, a ring */
+    uint64_t sequence;       /* Instructions seen so far, indexes issued */
+
+    oooModel ooo;            /* Used with cfg.outOfOrder */
+} timingModel;
+
+/* The modelled machine unless the caller passes its own config to timingInit */
+extern const timingConfig timingDefaults;
+
+/**
+ * @brief Allocates the caches, predictor and queues
+ * @return false if an allocation failed, timingCleanup still has to be called
+ */
+bool timingInit(timingModel *model, const timingConfig *cfg);
+void timingCleanup(timingModel *model);
+
+/**
+ * @brief Builds the retired instruction record from the execute/memory stage output
+ */
+void makeRetiredInstr(const decoder_to_execute *ex, retiredInstr *rec);
+
+/**
+ * @brief Next fetch pc the predictor picks for a control transfer at pc, pc + length if it predicts
+ * not taken or the BTB has no target
+ */
+uint32_t timingPredictNext(const timingModel *model, uint32_t pc, uint8_t length, bool conditional);
+
+/**
+ * @brief Updates caches, predictor and hazard tracking without charging any cycles
+ */
+void timingWarm(timingModel *model, const retiredInstr *rec);
+
+/**
+ * @brief Updates the model and charges the cycles of rec to model->totals
+ * @return Cycles spent on this instruction
+ */
+uint32_t timingAccount(timingModel *model, const retiredInstr *rec);
+
+void printTimingStats(const timingStats *stats);
+
+/**
+ * @brief Prints IPC, mean ROB occupancy, dispatch stalls and unit utilisation of the out-of-order backend
+ */
+void printOutOfOrderStats(const oooConfig *cfg, const timingStats *stats);
+
+#endif //TIMING_H
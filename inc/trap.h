@@ -0,0 +1,47 @@
+/**
+ * Machine mode traps: synchronous exceptions, CLINT interrupts, MRET and WFI.
+ * All traps go to M-mode, there is no delegation. Until the guest installs a handler (mtvec != 0)
+ * ecalls are serviced by the host syscall proxy and exceptions halt the simulation.
+ */
+#ifndef TRAP_H
+#define TRAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sim.h"
+
+static inline bool trapHandlerInstalled(const sim_t *sim) {
+    return sim->csrs.mtvec != 0;
+}
+
+/**
+ * @brief Enters the M-mode handler. cause has MCAUSE_INTERRUPT set for interrupts, pc is saved in mepc
+ */
+void takeTrap(sim_t *sim, uint32_t cause, uint32_t tval, uint32_t pc);
+
+/**
+ * @brief MRET: restores the privilege and interrupt enable saved by takeTrap
+ * @return The pc to continue at (mepc)
+ */
+uint32_t trapReturn(sim_t *sim);
+
+/**
+ * @brief Takes the highest priority pending and enabled interrupt, if there is one
+ * @return true if the program counter was redirected to the handler
+ */
+bool takePendingInterrupt(sim_t *sim);
+
+static inline void checkInterrupts(sim_t *sim) {
+    if (__builtin_expect((sim->csrs.mip & sim->csrs.mie) != 0, 0)) {
+        takePendingInterrupt(sim);
+    }
+}
+
+/**
+ * @brief WFI: advances simulated time straight to the next event (or sleeps the host) until an
+ * interrupt becomes pending. A host sleep is cut into slices and returns early once one runs out.
+ * Halts the simulation if nothing could ever wake the hart
+ */
+void waitForInterrupt(sim_t *sim);
+
+#endif //TRAP_H
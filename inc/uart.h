@@ -0,0 +1,33 @@
+/**
+ * Transmit-only 16550 style UART. Guest writes to THR are collected in a host buffer and written
+ * out in large chunks instead of one syscall per character.
+ */
+#ifndef UART_H
+#define UART_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bus.h"
+
+#define UART_SIZE 0x100
+#define UART_THR 0x0 /* Transmit holding register */
+#define UART_LSR 0x5 /* Line status register */
+#define UART_LSR_TX_IDLE 0x60
+
+#define UART_BUFFER_SIZE 4096
+
+typedef struct {
+    int hostFd;
+    bool lineBuffered;   /* Flush on newline when attached to a terminal */
+    uint32_t used;
+    char buffer[UART_BUFFER_SIZE];
+} uartDevice;
+
+void uartInit(uartDevice *uart, busMap *bus, uint32_t base, int hostFd);
+
+/**
+ * @brief Writes any buffered output to the host, called on halt and on newline for terminals
+ */
+void uartFlush(uartDevice *uart);
+
+#endif //UART_H
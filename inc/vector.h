@@ -0,0 +1,90 @@
+/**
+ * Subset of the RVV 1.0 vector extension with SEW up to 32 and VLEN configurable up to 256:
+ * vset{i}vl{i}, unit-stride, strided and mask loads/stores, integer add/sub/mul/logic/shift,
+ * compares into masks, mask logic, merges, reductions and the scalar moves.
+ *
+ * Element-wise ops are computed a whole host vector at a time with the compiler's vector types, so
+ * they become SSE2/AVX2 (or NEON) instructions. Results land in a scratch buffer and only the body
+ * elements are copied into the destination group: tail and inactive elements stay undisturbed,
+ * which is valid for every vta/vma setting.
+ */
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "alu.h"
+
+#define VLEN_MIN 32
+#define VLEN_MAX 256
+#define VLENB_MAX (VLEN_MAX / 8)
+#define VECTOR_ELEN 32
+
+/* Width of one host vector operation, the register file is padded by it so the last chunk of a
+   group may be read in full */
+#if defined(__AVX2__)
+#define HOST_VECTOR_BYTES 32
+#else
+#define HOST_VECTOR_BYTES 16
+#endif
+
+/* OP-V funct3, which operands an arithmetic instruction takes */
+#define OPIVV 0x0
+#define OPMVV 0x2
+#define OPIVI 0x3
+#define OPIVX 0x4
+#define OPMVX 0x6
+#define OPCFG 0x7
+
+/* vtype fields */
+#define VTYPE_VLMUL 0x7u
+#define VTYPE_VSEW_SHIFT 3
+#define VTYPE_VSEW (0x7u << VTYPE_VSEW_SHIFT)
+#define VTYPE_VTA (1u << 6)
+#define VTYPE_VMA (1u << 7)
+#define VTYPE_VILL (1u << 31)
+
+typedef struct {
+    /* v0-v31, register i starts at i * vlenb so that LMUL > 1 groups are contiguous */
+    uint8_t regs[32 * VLENB_MAX + HOST_VECTOR_BYTES] __attribute__((aligned(32)));
+    uint32_t vlenb;
+    uint32_t vl;
+    uint32_t vtype;
+    uint32_t vstart;
+    uint32_t vxsat;
+    uint32_t vxrm;
+
+    /* Decoded from vtype by the last vset instruction */
+    uint32_t sew;        /* Element width in bits */
+    uint32_t lmulRegs;   /* Registers per group, 1 for fractional LMUL */
+} vectorUnit;
+
+/**
+ * @brief Resets the vector state with vl = 0 and vill set
+ * @return false if vlen is not a power of two between VLEN_MIN and VLEN_MAX
+ */
+bool vectorInit(vectorUnit *vu, uint32_t vlen);
+
+static inline bool isVectorOp(uint8_t microOp) {
+    return microOp >= OP_VSETVLI && microOp <= OP_VFIRST;
+}
+
+static inline bool isVectorMemoryOp(uint8_t microOp) {
+    return microOp >= OP_VLE && microOp <= OP_VSM;
+}
+
+/**
+ * @brief Execute stage for vector instructions. Configuration and arithmetic complete here, loads
+ * and stores only get their address and stride and finish in vectorMemAccess. Illegal
+ * configurations are recorded in out as an illegal instruction exception
+ */
+void vectorExecute(sim_t *sim, const decodedFields *df, decoder_to_execute *out);
+
+/**
+ * @brief Memory access stage for vector loads and stores
+ * @return false on a fault, vstart then holds the index of the faulting element so the instruction
+ * resumes there after the trap
+ */
+bool vectorMemAccess(sim_t *sim, decoder_to_execute *ex);
+
+#endif //VECTOR_H
@@ -0,0 +1,50 @@
+/**
+ * Write back stage body, shared by writeBackStage and the specialised interpreter cores. It is always
+ * inlined so a core without F or D leaves out the float register write. Traps and system
+ * instructions go out of line to writeBackStage.
+ */
+#ifndef WRITE_BACK_H
+#define WRITE_BACK_H
+
+#include "alu.h"
+#include "sim.h"
+#include "isa.h"
+#include "clock.h"
+#include "interpreter.h"
+
+/* Advances the pc and counts the retired instruction, both halves of a fused pair */
+static inline __attribute__((always_inline)) void retireInstruction(sim_t *sim, const decoder_to_execute *ex,
+                                                                    uint32_t nextPc) {
+    sim->regFile.programCounter = nextPc;
+    sim->instructionsRetired++;
+    opcodeMixCount(&sim->mix, ex->microOp);
+    clockTick(sim);
+
+    if (ex->firstLength != 0) {
+        sim->instructionsRetired++;
+        clockTick(sim);
+    }
+}
+
+static inline __attribute__((always_inline)) void writeBackFor(sim_t *sim, const decoder_to_execute *ex,
+                                                               uint32_t extensions) {
+    if (sim->halted) {
+        return;
+    }
+    if (ex->exception || (ex->microOp >= OP_ECALL && ex->microOp <= OP_WFI) || ex->microOp == OP_ILLEGAL) {
+        writeBackStage(sim, ex);
+        return;
+    }
+    if (ex->writesRd && ex->rd != 0) {
+        sim->regFile.generalRegisters[ex->rd] = ex->result;
+    }
+    if (extensions & (ISA_F | ISA_D)) {
+        if (ex->writesFd) {
+            sim->fpRegFile.regs[ex->rd] = ex->fpResult;
+        }
+        sim->fpRegFile.fflags |= ex->fpFlags;
+    }
+    retireInstruction(sim, ex, ex->nextPc);
+}
+
+#endif //WRITE_BACK_H
@@ -1,6 +1,8 @@
 #include "alu.h"
-
-decoder_to_execute aluOut;
+#include "sim.h"
+#include "vector.h"
+#include "fpu.h"
+#include "execute.h"
 
 uint32_t alu_add(uint32_t a, uint32_t b) {
     return a + b;
@@ -8,4 +10,124 @@ uint32_t alu_add(uint32_t a, uint32_t b) {
 
 uint32_t alu_sub(uint32_t a, uint32_t b) {
     return a - b;
-}
\ No newline at end of file
+}
+
+uint32_t alu_mul(uint32_t a, uint32_t b) {
+    return a * b;
+}
+
+uint32_t alu_mulh(int32_t a, int32_t b) {
+    return (uint32_t)(((int64_t)a * (int64_t)b) >> 32);
+}
+
+uint32_t alu_mulhsu(int32_t a, uint32_t b) {
+    return (uint32_t)(((int64_t)a * (int64_t)(uint64_t)b) >> 32);
+}
+
+uint32_t alu_mulhu(uint32_t a, uint32_t b) {
+    return (uint32_t)(((uint64_t)a * (uint64_t)b) >> 32);
+}
+
+/* Division by zero and overflow follow the RISC-V spec instead of trapping */
+uint32_t alu_div(uint32_t a, uint32_t b) {
+    return b == 0 ? UINT32_MAX : a / b;
+}
+
+int32_t alu_div_signed(int32_t a, int32_t b) {
+    if (b == 0) {
+        return -1;
+    }
+    if (a == INT32_MIN && b == -1) {
+        return INT32_MIN;
+    }
+    return a / b;
+}
+
+uint32_t alu_mod(uint32_t a, uint32_t b) {
+    return b == 0 ? a : a % b;
+}
+
+int32_t alu_mod_signed(int32_t a, int32_t b) {
+    if (b == 0) {
+        return a;
+    }
+    if (a == INT32_MIN && b == -1) {
+        return 0;
+    }
+    return a % b;
+}
+
+uint32_t alu_and(uint32_t a, uint32_t b) {
+    return a & b;
+}
+
+uint32_t alu_or(uint32_t a, uint32_t b) {
+    return a | b;
+}
+
+uint32_t alu_xor(uint32_t a, uint32_t b) {
+    return a ^ b;
+}
+
+uint32_t alu_not(uint32_t a) {
+    return ~a;
+}
+
+uint32_t alu_sll(uint32_t a, uint32_t b) {
+    return a << (b & 0x1F);
+}
+
+uint32_t alu_srl(uint32_t a, uint32_t b) {
+    return a >> (b & 0x1F);
+}
+
+int32_t alu_sra(int32_t a, uint32_t b) {
+    return a >> (b & 0x1F);
+}
+
+uint32_t alu_slt(int32_t a, int32_t b) {
+    return a < b;
+}
+
+uint32_t alu_sltu(uint32_t a, uint32_t b) {
+    return a < b;
+}
+
+uint32_t alu_eq(uint32_t a, uint32_t b) {
+    return a == b;
+}
+
+uint32_t alu_ne(uint32_t a, uint32_t b) {
+    return a != b;
+}
+
+uint32_t alu_addi(uint32_t a, uint32_t imm) {
+    return a + imm;
+}
+
+uint32_t alu_andi(uint32_t a, uint32_t imm) {
+    return a & imm;
+}
+
+uint32_t alu_ori(uint32_t a, uint32_t imm) {
+    return a | imm;
+}
+
+uint32_t alu_xori(uint32_t a, uint32_t imm) {
+    return a ^ imm;
+}
+
+uint32_t alu_add_overflow(uint32_t a, uint32_t b) {
+    uint32_t sum = a + b;
+    return ((~(a ^ b) & (a ^ sum)) >> 31) & 1;
+}
+
+uint32_t alu_sub_overflow(uint32_t a, uint32_t b) {
+    uint32_t diff = a - b;
+    return (((a ^ b) & (a ^ diff)) >> 31) & 1;
+}
+
+void aluExecute(sim_t *sim, const decodedFields *df, uint32_t pc, decoder_to_execute *out) {
+    executeFor(sim, df, pc, out, ISA_ALL);
+    checkJumpAlignment(df, out, sim->core->extensions);
+}
@@ -0,0 +1,104 @@
+#include "blockDevice.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void runCommand(blockDevice *dev, uint32_t command) {
+    uint64_t offset = (uint64_t)dev->sector * BLOCK_SECTOR_SIZE;
+    uint64_t length = (uint64_t)dev->count * BLOCK_SECTOR_SIZE;
+    uint8_t *guest = length <= UINT32_MAX ? ramPointer(dev->ram, dev->buffer, (uint32_t)length) : NULL;
+
+    if (guest == NULL || offset + length > dev->imageSize) {
+        dev->status = BLOCK_STATUS_ERROR;
+        return;
+    }
+    switch (command) {
+        case BLOCK_CMD_READ:
+            for (uint64_t page = 0; page < length; page += RAM_PAGE_SIZE) {
+                ramMarkDirty(dev->ram, dev->buffer + (uint32_t)page);
+            }
+            if (length != 0) {
+                ramMarkDirty(dev->ram, dev->buffer + (uint32_t)length - 1);
+            }
+            memcpy(guest, dev->image + offset, length);
+            break;
+        case BLOCK_CMD_WRITE:
+            memcpy(dev->image + offset, guest, length);
+            break;
+        default:
+            dev->status = BLOCK_STATUS_ERROR;
+            return;
+    }
+    dev->status = BLOCK_STATUS_OK;
+}
+
+static uint32_t blockRead(void *device, uint32_t offset, uint8_t bytes) {
+    blockDevice *dev = (blockDevice *)device;
+    (void)bytes;
+    switch (offset) {
+        case BLOCK_REG_SECTOR: return dev->sector;
+        case BLOCK_REG_BUFFER: return dev->buffer;
+        case BLOCK_REG_COUNT: return dev->count;
+        case BLOCK_REG_STATUS: return dev->status;
+        case BLOCK_REG_CAPACITY: return (uint32_t)(dev->imageSize / BLOCK_SECTOR_SIZE);
+        default: return 0;
+    }
+}
+
+static void blockWrite(void *device, uint32_t offset, uint8_t bytes, uint32_t value) {
+    blockDevice *dev = (blockDevice *)device;
+    (void)bytes;
+    switch (offset) {
+        case BLOCK_REG_SECTOR: dev->sector = value; break;
+        case BLOCK_REG_BUFFER: dev->buffer = value; break;
+        case BLOCK_REG_COUNT: dev->count = value; break;
+        case BLOCK_REG_COMMAND: runCommand(dev, value); break;
+        default: break;
+    }
+}
+
+bool blockDeviceInit(blockDevice *disk, busMap *bus, uint32_t base, const char *imagePath) {
+    struct stat info;
+    int fd = open(imagePath, O_RDWR);
+    if (fd == -1 || fstat(fd, &info) == -1) {
+        perror("Block device image");
+        if (fd != -1) {
+            close(fd);
+        }
+        return false;
+    }
+
+    memset(disk, 0, sizeof(*disk));
+    disk->ram = bus->ram;
+    disk->imageSize = (size_t)info.st_size;
+    if (disk->imageSize > 0) {
+        disk->image = mmap(NULL, disk->imageSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd); /* The mapping keeps the file alive */
+    if (disk->image == MAP_FAILED) {
+        perror("Block device mmap");
+        disk->image = NULL;
+        return false;
+    }
+
+    busRegion region = {
+        .name = "block",
+        .base = base,
+        .size = BLOCK_DEVICE_SIZE,
+        .device = disk,
+        .read = blockRead,
+        .write = blockWrite,
+    };
+    return busAddRegion(bus, &region);
+}
+
+void blockDeviceCleanup(blockDevice *disk) {
+    if (disk->image != NULL) {
+        msync(disk->image, disk->imageSize, MS_SYNC);
+        munmap(disk->image, disk->imageSize);
+        disk->image = NULL;
+    }
+}
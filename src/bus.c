@@ -0,0 +1,75 @@
+#include "bus.h"
+#include <stdio.h>
+
+void busInit(busMap *bus, ram_t *ram) {
+    bus->regionCount = 0;
+    bus->ram = ram;
+    busRegion region = {
+        .name = "ram",
+        .base = 0,
+        .size = (uint32_t)ram->size,
+        .isRam = true,
+    };
+    busAddRegion(bus, &region);
+    bus->ramHit = &bus->regions[0];
+}
+
+bool busAddRegion(busMap *bus, const busRegion *region) {
+    if (bus->regionCount == BUS_MAX_REGIONS) {
+        printf("Bus full, cannot map %s\n", region->name);
+        return false;
+    }
+    for (int i = 0; i < bus->regionCount; i++) {
+        uint64_t end = (uint64_t)bus->regions[i].base + bus->regions[i].size;
+        uint64_t newEnd = (uint64_t)region->base + region->size;
+        if (region->base < end && bus->regions[i].base < newEnd) {
+            printf("Bus region %s overlaps %s\n", region->name, bus->regions[i].name);
+            return false;
+        }
+    }
+    bus->regions[bus->regionCount++] = *region;
+    return true;
+}
+
+static const busRegion *findRegion(const busMap *bus, uint32_t address, uint8_t bytes) {
+    for (int i = 0; i < bus->regionCount; i++) {
+        /* A region smaller than the access can never hold it, and size - bytes would wrap */
+        if (bytes <= bus->regions[i].size && address - bus->regions[i].base <= bus->regions[i].size - bytes) {
+            return &bus->regions[i];
+        }
+    }
+    return NULL;
+}
+
+bool busLoadSlow(busMap *bus, uint32_t address, uint8_t bytes, bool isSigned, uint32_t *value) {
+    const busRegion *region = findRegion(bus, address, bytes);
+    if (region == NULL) {
+        return false;
+    }
+    if (region->isRam) {
+        bus->ramHit = region;
+        return loadMemory(bus->ram, address, bytes, isSigned, value);
+    }
+    if (region->read == NULL) {
+        return false;
+    }
+
+    *value = extendLoad(region->read(region->device, address - region->base, bytes), bytes, isSigned);
+    return true;
+}
+
+bool busStoreSlow(busMap *bus, uint32_t address, uint8_t bytes, uint32_t value) {
+    const busRegion *region = findRegion(bus, address, bytes);
+    if (region == NULL) {
+        return false;
+    }
+    if (region->isRam) {
+        bus->ramHit = region;
+        return storeMemory(bus->ram, address, bytes, value);
+    }
+    if (region->write == NULL) {
+        return false;
+    }
+    region->write(region->device, address - region->base, bytes, value);
+    return true;
+}
@@ -0,0 +1,92 @@
+#include "clint.h"
+#include "bus.h"
+#include "clock.h"
+#include "csr.h"
+
+uint64_t clintMtime(const sim_t *sim) {
+    return sim->clockNow;
+}
+
+static void timerFired(void *arg) {
+    sim_t *sim = (sim_t *)arg;
+    sim->csrs.mip |= MIP_MTIP;
+}
+
+/* MTIP follows mtime >= mtimecmp, the event only has to catch the rising edge */
+static void updateTimer(sim_t *sim) {
+    clintDevice *clint = &sim->clint;
+    if (clintMtime(sim) >= clint->mtimecmp) {
+        eventCancel(&sim->events, &clint->timerEvent);
+        sim->csrs.mip |= MIP_MTIP;
+    } else {
+        sim->csrs.mip &= ~MIP_MTIP;
+        eventSchedule(&sim->events, &clint->timerEvent, clint->mtimecmp);
+    }
+}
+
+/* 64 bit registers are accessed as two 32 bit halves */
+static uint32_t readHalf(uint64_t reg, uint32_t offset) {
+    return (offset & 4) ? (uint32_t)(reg >> 32) : (uint32_t)reg;
+}
+
+static uint64_t writeHalf(uint64_t reg, uint32_t offset, uint32_t value) {
+    if (offset & 4) {
+        return (reg & 0xFFFFFFFFull) | ((uint64_t)value << 32);
+    }
+    return (reg & ~0xFFFFFFFFull) | value;
+}
+
+/* The CLINT drives the hart's mip bits, so its bus context is the whole instance */
+static uint32_t clintRead(void *device, uint32_t offset, uint8_t bytes) {
+    sim_t *sim = (sim_t *)device;
+    (void)bytes;
+    if (offset == CLINT_MSIP) {
+        return sim->clint.msip;
+    }
+    if (offset - CLINT_MTIMECMP < 8) {
+        return readHalf(sim->clint.mtimecmp, offset);
+    }
+    if (offset - CLINT_MTIME < 8) {
+        return readHalf(clintMtime(sim), offset);
+    }
+    return 0;
+}
+
+static void clintWrite(void *device, uint32_t offset, uint8_t bytes, uint32_t value) {
+    sim_t *sim = (sim_t *)device;
+    clintDevice *dev = &sim->clint;
+    (void)bytes;
+    if (offset == CLINT_MSIP) {
+        dev->msip = value & 1;
+        if (dev->msip) {
+            sim->csrs.mip |= MIP_MSIP;
+        } else {
+            sim->csrs.mip &= ~MIP_MSIP;
+        }
+    } else if (offset - CLINT_MTIMECMP < 8) {
+        dev->mtimecmp = writeHalf(dev->mtimecmp, offset, value);
+        updateTimer(sim);
+    }
+    /* mtime follows the simulated clock and is read only */
+}
+
+void clintInit(sim_t *sim, uint32_t base) {
+    clintDevice *clint = &sim->clint;
+    clint->msip = 0;
+    clint->mtimecmp = UINT64_MAX;
+    clint->timerEvent.callback = timerFired;
+    clint->timerEvent.arg = sim;
+    clint->timerEvent.scheduled = false;
+    clint->timerEvent.background = false;
+    clint->timerEvent.next = NULL;
+
+    busRegion region = {
+        .name = "clint",
+        .base = base,
+        .size = CLINT_SIZE,
+        .device = sim,
+        .read = clintRead,
+        .write = clintWrite,
+    };
+    busAddRegion(&sim->bus, &region);
+}
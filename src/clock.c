@@ -0,0 +1,20 @@
+#include "clock.h"
+#include <pthread.h>
+#include <signal.h>
+#include "controlUnit.h"
+
+void sendRisingEdge(sim_t *sim) {
+    pipelineHandOff(sim, FETCH);
+}
+
+void clockInit(sim_t *sim) {
+    sim->clockNow = 0;
+    eventQueueInit(&sim->events);
+}
+
+void clockSkipTo(sim_t *sim, uint64_t when) {
+    if (when > sim->clockNow) {
+        sim->clockNow = when;
+    }
+    eventRunDue(&sim->events, sim->clockNow);
+}
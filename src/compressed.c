@@ -0,0 +1,238 @@
+#include "compressed.h"
+#include <stddef.h>
+
+#define OPCODE_LOAD 0b0000011
+#define OPCODE_OP_IMM 0b0010011
+#define OPCODE_STORE 0b0100011
+#define OPCODE_LOAD_FP 0b0000111
+#define OPCODE_STORE_FP 0b0100111
+#define OPCODE_OP 0b0110011
+#define OPCODE_LUI 0b0110111
+#define OPCODE_BRANCH 0b1100011
+#define OPCODE_JALR 0b1100111
+#define OPCODE_JAL 0b1101111
+#define EBREAK_INSTRUCTION 0x00100073u
+
+/* Field extraction */
+#define BIT(value, n) (((value) >> (n)) & 1u)
+#define BITS(value, hi, lo) (((value) >> (lo)) & ((1u << ((hi) - (lo) + 1)) - 1))
+#define C_RD(parcel) BITS(parcel, 11, 7)
+#define C_RS2(parcel) BITS(parcel, 6, 2)
+#define C_RD_PRIME(parcel) (BITS(parcel, 4, 2) + 8)   /* Registers x8-x15 */
+#define C_RS1_PRIME(parcel) (BITS(parcel, 9, 7) + 8)
+
+/* Immediate formats shared by several instructions */
+#define C_IMM6(parcel) ((BIT(parcel, 12) << 5) | BITS(parcel, 6, 2))
+#define C_LW_OFFSET(parcel) ((BITS(parcel, 12, 10) << 3) | (BIT(parcel, 6) << 2) | (BIT(parcel, 5) << 6))
+#define C_LD_OFFSET(parcel) ((BITS(parcel, 12, 10) << 3) | (BITS(parcel, 6, 5) << 6))
+#define C_LWSP_OFFSET(parcel) ((BIT(parcel, 12) << 5) | (BITS(parcel, 6, 4) << 2) | (BITS(parcel, 3, 2) << 6))
+#define C_LDSP_OFFSET(parcel) ((BIT(parcel, 12) << 5) | (BITS(parcel, 6, 5) << 3) | (BITS(parcel, 4, 2) << 6))
+#define C_SWSP_OFFSET(parcel) ((BITS(parcel, 12, 9) << 2) | (BITS(parcel, 8, 7) << 6))
+#define C_SDSP_OFFSET(parcel) ((BITS(parcel, 12, 10) << 3) | (BITS(parcel, 9, 7) << 6))
+
+/* 32 bit encoders */
+static uint32_t encodeR(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode) {
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+static uint32_t encodeI(int32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode) {
+    return (((uint32_t)imm & 0xFFF) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+static uint32_t encodeS(int32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode) {
+    uint32_t u = (uint32_t)imm;
+    return (BITS(u, 11, 5) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (BITS(u, 4, 0) << 7) | opcode;
+}
+
+static uint32_t encodeB(int32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3) {
+    uint32_t u = (uint32_t)imm;
+    return (BIT(u, 12) << 31) | (BITS(u, 10, 5) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) |
+           (BITS(u, 4, 1) << 8) | (BIT(u, 11) << 7) | OPCODE_BRANCH;
+}
+
+static uint32_t encodeJ(int32_t imm, uint32_t rd) {
+    uint32_t u = (uint32_t)imm;
+    return (BIT(u, 20) << 31) | (BITS(u, 10, 1) << 21) | (BIT(u, 11) << 20) | (BITS(u, 19, 12) << 12) |
+           (rd << 7) | OPCODE_JAL;
+}
+
+static int32_t signExtend(uint32_t value, int bits) {
+    return (int32_t)(value << (32 - bits)) >> (32 - bits);
+}
+
+static int32_t cjOffset(uint16_t p) {
+    uint32_t offset = (BIT(p, 12) << 11) | (BIT(p, 11) << 4) | (BITS(p, 10, 9) << 8) | (BIT(p, 8) << 10) |
+                      (BIT(p, 7) << 6) | (BIT(p, 6) << 7) | (BITS(p, 5, 3) << 1) | (BIT(p, 2) << 5);
+    return signExtend(offset, 12);
+}
+
+static int32_t cbOffset(uint16_t p) {
+    uint32_t offset = (BIT(p, 12) << 8) | (BITS(p, 11, 10) << 3) | (BITS(p, 6, 5) << 6) |
+                      (BITS(p, 4, 3) << 1) | (BIT(p, 2) << 5);
+    return signExtend(offset, 9);
+}
+
+//==========================================Quadrant 0=====================================================
+static uint32_t cAddi4spn(uint16_t p) {
+    uint32_t imm = (BITS(p, 12, 11) << 4) | (BITS(p, 10, 7) << 6) | (BIT(p, 6) << 2) | (BIT(p, 5) << 3);
+    if (imm == 0) {
+        return 0;
+    }
+    return encodeI((int32_t)imm, 2, 0x0, C_RD_PRIME(p), OPCODE_OP_IMM);
+}
+
+static uint32_t cFld(uint16_t p) {
+    return encodeI((int32_t)C_LD_OFFSET(p), C_RS1_PRIME(p), 0x3, C_RD_PRIME(p), OPCODE_LOAD_FP);
+}
+
+static uint32_t cLw(uint16_t p) {
+    return encodeI((int32_t)C_LW_OFFSET(p), C_RS1_PRIME(p), 0x2, C_RD_PRIME(p), OPCODE_LOAD);
+}
+
+static uint32_t cFlw(uint16_t p) {
+    return encodeI((int32_t)C_LW_OFFSET(p), C_RS1_PRIME(p), 0x2, C_RD_PRIME(p), OPCODE_LOAD_FP);
+}
+
+static uint32_t cFsd(uint16_t p) {
+    return encodeS((int32_t)C_LD_OFFSET(p), C_RD_PRIME(p), C_RS1_PRIME(p), 0x3, OPCODE_STORE_FP);
+}
+
+static uint32_t cSw(uint16_t p) {
+    return encodeS((int32_t)C_LW_OFFSET(p), C_RD_PRIME(p), C_RS1_PRIME(p), 0x2, OPCODE_STORE);
+}
+
+static uint32_t cFsw(uint16_t p) {
+    return encodeS((int32_t)C_LW_OFFSET(p), C_RD_PRIME(p), C_RS1_PRIME(p), 0x2, OPCODE_STORE_FP);
+}
+
+//==========================================Quadrant 1=====================================================
+static uint32_t cAddi(uint16_t p) {
+    return encodeI(signExtend(C_IMM6(p), 6), C_RD(p), 0x0, C_RD(p), OPCODE_OP_IMM);
+}
+
+static uint32_t cJal(uint16_t p) {
+    return encodeJ(cjOffset(p), 1);
+}
+
+static uint32_t cLi(uint16_t p) {
+    return encodeI(signExtend(C_IMM6(p), 6), 0, 0x0, C_RD(p), OPCODE_OP_IMM);
+}
+
+static uint32_t cLuiAddi16sp(uint16_t p) {
+    uint32_t rd = C_RD(p);
+    if (rd == 2) {
+        uint32_t imm = (BIT(p, 12) << 9) | (BIT(p, 6) << 4) | (BIT(p, 5) << 6) | (BITS(p, 4, 3) << 7) | (BIT(p, 2) << 5);
+        if (imm == 0) {
+            return 0;
+        }
+        return encodeI(signExtend(imm, 10), 2, 0x0, 2, OPCODE_OP_IMM);
+    }
+    if (C_IMM6(p) == 0) {
+        return 0;
+    }
+    return ((uint32_t)signExtend(C_IMM6(p), 6) << 12) | (rd << 7) | OPCODE_LUI;
+}
+
+static uint32_t cMiscAlu(uint16_t p) {
+    uint32_t rd = C_RS1_PRIME(p);
+    uint32_t shamt = C_IMM6(p);
+
+    switch (BITS(p, 11, 10)) {
+        case 0x0: /* C.SRLI */
+            return shamt & 0x20 ? 0 : encodeI((int32_t)shamt, rd, 0x5, rd, OPCODE_OP_IMM);
+        case 0x1: /* C.SRAI */
+            return shamt & 0x20 ? 0 : encodeI((int32_t)(shamt | 0x400), rd, 0x5, rd, OPCODE_OP_IMM);
+        case 0x2: /* C.ANDI */
+            return encodeI(signExtend(shamt, 6), rd, 0x7, rd, OPCODE_OP_IMM);
+        default:
+            if (BIT(p, 12)) {
+                return 0; /* RV64 only */
+            }
+            switch (BITS(p, 6, 5)) {
+                case 0x0: return encodeR(0x20, C_RD_PRIME(p), rd, 0x0, rd, OPCODE_OP); /* C.SUB */
+                case 0x1: return encodeR(0x00, C_RD_PRIME(p), rd, 0x4, rd, OPCODE_OP); /* C.XOR */
+                case 0x2: return encodeR(0x00, C_RD_PRIME(p), rd, 0x6, rd, OPCODE_OP); /* C.OR */
+                default:  return encodeR(0x00, C_RD_PRIME(p), rd, 0x7, rd, OPCODE_OP); /* C.AND */
+            }
+    }
+}
+
+static uint32_t cJ(uint16_t p) {
+    return encodeJ(cjOffset(p), 0);
+}
+
+static uint32_t cBeqz(uint16_t p) {
+    return encodeB(cbOffset(p), 0, C_RS1_PRIME(p), 0x0);
+}
+
+static uint32_t cBnez(uint16_t p) {
+    return encodeB(cbOffset(p), 0, C_RS1_PRIME(p), 0x1);
+}
+
+//==========================================Quadrant 2=====================================================
+static uint32_t cSlli(uint16_t p) {
+    uint32_t shamt = C_IMM6(p);
+    return shamt & 0x20 ? 0 : encodeI((int32_t)shamt, C_RD(p), 0x1, C_RD(p), OPCODE_OP_IMM);
+}
+
+static uint32_t cFldsp(uint16_t p) {
+    return encodeI((int32_t)C_LDSP_OFFSET(p), 2, 0x3, C_RD(p), OPCODE_LOAD_FP);
+}
+
+static uint32_t cLwsp(uint16_t p) {
+    if (C_RD(p) == 0) {
+        return 0;
+    }
+    return encodeI((int32_t)C_LWSP_OFFSET(p), 2, 0x2, C_RD(p), OPCODE_LOAD);
+}
+
+/* f0 is an ordinary register, unlike x0 for C.LWSP */
+static uint32_t cFlwsp(uint16_t p) {
+    return encodeI((int32_t)C_LWSP_OFFSET(p), 2, 0x2, C_RD(p), OPCODE_LOAD_FP);
+}
+
+static uint32_t cJrMvAdd(uint16_t p) {
+    uint32_t rd = C_RD(p);
+    uint32_t rs2 = C_RS2(p);
+
+    if (!BIT(p, 12)) {
+        if (rs2 == 0) {
+            return rd == 0 ? 0 : encodeI(0, rd, 0x0, 0, OPCODE_JALR);  /* C.JR */
+        }
+        return encodeR(0x00, rs2, 0, 0x0, rd, OPCODE_OP);                /* C.MV */
+    }
+    if (rs2 == 0) {
+        if (rd == 0) {
+            return EBREAK_INSTRUCTION;                                  /* C.EBREAK */
+        }
+        return encodeI(0, rd, 0x0, 1, OPCODE_JALR);                      /* C.JALR */
+    }
+    return encodeR(0x00, rs2, rd, 0x0, rd, OPCODE_OP);                   /* C.ADD */
+}
+
+static uint32_t cFsdsp(uint16_t p) {
+    return encodeS((int32_t)C_SDSP_OFFSET(p), C_RS2(p), 2, 0x3, OPCODE_STORE_FP);
+}
+
+static uint32_t cSwsp(uint16_t p) {
+    return encodeS((int32_t)C_SWSP_OFFSET(p), C_RS2(p), 2, 0x2, OPCODE_STORE);
+}
+
+static uint32_t cFswsp(uint16_t p) {
+    return encodeS((int32_t)C_SWSP_OFFSET(p), C_RS2(p), 2, 0x2, OPCODE_STORE_FP);
+}
+
+/* Indexed by quadrant (low two bits) then funct3 (top three bits), NULL entries are reserved.
+   funct3 3 and 7 of quadrants 0 and 2 are the RV32 only C.FLW/C.FSW forms */
+typedef uint32_t (*compressedExpander)(uint16_t parcel);
+
+static const compressedExpander expanders[3][8] = {
+    { cAddi4spn, cFld, cLw, cFlw, NULL, cFsd, cSw, cFsw },
+    { cAddi, cJal, cLi, cLuiAddi16sp, cMiscAlu, cJ, cBeqz, cBnez },
+    { cSlli, cFldsp, cLwsp, cFlwsp, cJrMvAdd, cFsdsp, cSwsp, cFswsp },
+};
+
+uint32_t expandCompressed(uint16_t parcel) {
+    compressedExpander expander = expanders[parcel & 0b11][parcel >> 13];
+    return expander == NULL ? 0 : expander(parcel);
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE   /* pthread_setaffinity_np */
 #include "controlUnit.h"
 #include <ctype.h>
 #include <errno.h>
@@ -9,17 +10,29 @@
 #include <unistd.h>
 #include <signal.h>
 #include <fcntl.h>
-#include "ram.h"
-#include "registers.h"
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
 #include "alu.h"
+#include "interpreter.h"
+#include "fetch.h"
+#include "clock.h"
+#include "trap.h"
+#include "vector.h"
+#include "fpu.h"
+#include "decode.h"
 
 #define INSTRUCTION_TO_RD(instructionToDecode) ((instructionToDecode >> 7) & 0b11111)
 #define INSTRUCTION_TO_FUNCT3(instructionToDecode) ((instructionToDecode >> 12) & 0b111)
-#define INSTRUCTION_TO_RS1(instruction) (((instruction) >> 15) & 0b1111)
-#define INSTRUCTION_TO_RS2(instruction) (((instruction) >> 20) & 0b1111)
+#define INSTRUCTION_TO_RS1(instruction) (((instruction) >> 15) & 0b11111)
+#define INSTRUCTION_TO_RS2(instruction) (((instruction) >> 20) & 0b11111)
 #define INSTRUCTION_TO_FUNCT7(instruction) (((instruction) >> 25) & 0b1111111)
-#define INSTRUCTION_TO_IMM_B(instruction) ((instruction >> 25) & 0b1111111) + ((instruction >> 6) & 0b11111)
-#define INSTRUCTION_TO_IMM_U(instruction) (instruction >> 11 & 0b11111111111)
+#define INSTRUCTION_TO_IMM_S(instruction) ((((instruction) >> 25) << 5) | (((instruction) >> 7) & 0b11111))
+#define INSTRUCTION_TO_IMM_B(instruction) ((((instruction) >> 31) & 0b1) << 12 | (((instruction) >> 7) & 0b1) << 11 | \
+                                           (((instruction) >> 25) & 0b111111) << 5 | (((instruction) >> 8) & 0b1111) << 1)
+#define INSTRUCTION_TO_IMM_U(instruction) ((instruction) >> 12)
+#define INSTRUCTION_TO_IMM_J(instruction) ((((instruction) >> 31) & 0b1) << 20 | (((instruction) >> 12) & 0b11111111) << 12 | \
+                                           (((instruction) >> 20) & 0b1) << 11 | (((instruction) >> 21) & 0b1111111111) << 1)
 
 // #define INSTRUCTION_TO_IMMI_20(instructionToDecode) ( (instructionToDecode >> 20) & 0b1111111)
 
@@ -28,545 +41,1042 @@
 
 #define LOGICAL_I_TYPE 0b0010011
 #define LOAD_I_TYPE 0b0000011
-#define JAL_I_TYPE 0b1100111
+#define JALR_I_TYPE 0b1100111
 #define FENCE_I_TYPE 0b0001111 //Memory barrier instructions 
+#define SYSTEM_I_TYPE 0b1110011
+#define LUI_U_TYPE 0b0110111
+#define AUIPC_U_TYPE 0b0010111
+
+#define VECTOR_FORM(funct3) (1u << (funct3))
+#define FORMS_VXI (VECTOR_FORM(OPIVV) | VECTOR_FORM(OPIVX) | VECTOR_FORM(OPIVI))
+#define FORMS_VX (VECTOR_FORM(OPIVV) | VECTOR_FORM(OPIVX))
+#define FORMS_XI (VECTOR_FORM(OPIVX) | VECTOR_FORM(OPIVI))
+
+
+
+/* Bytes of each stage's output latch, write back has none */
+static const size_t latchBytes[STAGE_COUNT] = {
+    [FETCH] = sizeof(fetchLatch),
+    [DECODE] = sizeof(decodeLatch),
+    [EXECUTE] = sizeof(decoder_to_execute),
+    [MEM_ACCESS] = sizeof(decoder_to_execute),
+};
+
+static currentStage runStage(sim_t *sim, currentStage stage);
+
+void pipelineInit(sim_t *sim) {
+    pipelineState *pipeline = &sim->pipeline;
+    pipeline->started = false;
+    pipeline->layout = SIM_PIPELINE_PER_STAGE;
+    pipeline->threadCount = 0;
+    pipeline->cpuCount = 0;
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        pipeline->latches[stage] = NULL;
+    }
+    pipeline->currStage = FETCH;
+    pipeline->pipelineBudget = 0;
+    pipeline->pipelineIdle = true;
+    pipeline->fetchHead = 0;
+    pipeline->fetchCount = 0;
+    pipeline->fetchPc = 0;
+    pipeline->fetchPeeked = false;
+    pipeline->fetchFlush = false;
+    pthread_mutex_init(&pipeline->retireLock, NULL);
+    pthread_cond_init(&pipeline->retireCond, NULL);
+}
 
+bool pipelineConfigure(sim_t *sim, sim_pipeline_layout layout, const char *cpus) {
+    pipelineState *pipeline = &sim->pipeline;
+    const char *cursor = cpus;
+
+    pipeline->layout = layout;
+    pipeline->cpuCount = 0;
+    while (cursor != NULL && *cursor != '\0') {
+        char *end;
+        long cpu = strtol(cursor, &end, 10);
+        if (end == cursor || cpu < 0 || cpu >= CPU_SETSIZE || pipeline->cpuCount == STAGE_COUNT ||
+            (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        pipeline->cpus[pipeline->cpuCount++] = (int)cpu;
+        cursor = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
 
+void cleanup(sim_t *sim) {
+    pipelineState *pipeline = &sim->pipeline;
 
-/* Handles for each pipeline thread */
-pthread_t fetchThreadHandle;
-pthread_t decodeThreadHandle;
-pthread_t executeThreadHandle;
-pthread_t memAccessThreadHandle;
-pthread_t regWriteThreadHandle;
-
-/* Pipes that transfer data from one thread to the next */
-int pipe_fetch_to_decode[2];
-int pipe_decode_to_execute[2];
-int pipe_execute_to_memAccess[2];
-int pipe_memAccess_to_regWrite[2];
-
-/* Signal that threads will wait on */
-sigset_t set;
+    if (pipeline->started) {
+        /* Cancel threads, they never leave their loops on their own */
+        for (uint32_t i = 0; i < pipeline->threadCount; i++) {
+            pthread_cancel(pipeline->threads[i].handle);
+        }
+        for (uint32_t i = 0; i < pipeline->threadCount; i++) {
+            pthread_join(pipeline->threads[i].handle, NULL);
+        }
+        pthread_barrier_destroy(&pipeline->startBarrier);
 
-/* Holds the current state of the system */
-currentStage currStage = FETCH;
+        /* Unmap all the latches */
+        for (int stage = 0; stage < STAGE_COUNT; stage++) {
+            if (pipeline->latches[stage] != NULL) {
+                munmap(pipeline->latches[stage], latchBytes[stage]);
+                pipeline->latches[stage] = NULL;
+            }
+        }
+        pipeline->threadCount = 0;
+        pipeline->started = false;
+    }
+    pthread_mutex_destroy(&pipeline->retireLock);
+    pthread_cond_destroy(&pipeline->retireCond);
+}
 
+/* Initializes signal handling */
+int initializeSignal(sim_t *sim) {
+    sigemptyset(&sim->pipeline.set);
+    sigaddset(&sim->pipeline.set, SIGUSR1);
+    return 0;
+}
 
+/* Thread a stage runs on in each layout */
+static uint32_t layoutThread(sim_pipeline_layout layout, currentStage stage) {
+    switch (layout) {
+        case SIM_PIPELINE_ONE_THREAD: return 0;
+        case SIM_PIPELINE_SPLIT: return stage <= DECODE ? 0 : 1;
+        default: return (uint32_t)stage;
+    }
+}
 
-/* Function prototypes for all threads */
-void *fetchThread(void *arg);
-void *decodeThread(void *arg);
-void *executeThread(void *arg);
-void *memAccessThread(void *arg);
-void *regWriteThread(void *arg);
+/* Initializes all threads. SIGUSR1 is blocked while they are created so that they inherit the mask,
+   then the caller's own mask is restored. Returns once every thread has mapped its latches */
+int initializeThreads(sim_t *sim) {
+    pipelineState *pipeline = &sim->pipeline;
+    sigset_t previous;
+
+    pipeline->threadCount = layoutThread(pipeline->layout, REG_WRITE_BACK) + 1;
+    for (int stage = STAGE_COUNT - 1; stage >= 0; stage--) {
+        uint32_t index = layoutThread(pipeline->layout, (currentStage)stage);
+        stageThread *thread = &pipeline->threads[index];
+
+        pipeline->owner[stage] = (uint8_t)index;
+        thread->sim = sim;
+        thread->first = (currentStage)stage;
+        if (stage == REG_WRITE_BACK || index != layoutThread(pipeline->layout, (currentStage)(stage + 1))) {
+            thread->last = (currentStage)stage;
+        }
+        thread->cpu = pipeline->cpuCount != 0 ? pipeline->cpus[index % pipeline->cpuCount] : -1;
+    }
+    pthread_barrier_init(&pipeline->startBarrier, NULL, pipeline->threadCount + 1);
 
-void flush_pipe(int pipe_fd) {
-    char buf[1024];
-    while (read(pipe_fd, buf, sizeof(buf)) > 0) {
-        // Continue reading until the pipe is empty
+    pthread_sigmask(SIG_BLOCK, &pipeline->set, &previous);
+    for (uint32_t i = 0; i < pipeline->threadCount; i++) {
+        pthread_create(&pipeline->threads[i].handle, NULL, stageThreadMain, &pipeline->threads[i]);
     }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    pthread_barrier_wait(&pipeline->startBarrier);
+    return 0;
 }
 
-void cleanup() {
-    printf("Flushing pipes...\n");
-
-    /* Flush all the pipes */
-    flush_pipe(pipe_fetch_to_decode[0]);
-    flush_pipe(pipe_decode_to_execute[0]);
-    flush_pipe(pipe_execute_to_memAccess[0]);
-    flush_pipe(pipe_memAccess_to_regWrite[0]);
-
-    /* Cancel threads */
-    pthread_cancel(fetchThreadHandle);
-    pthread_cancel(decodeThreadHandle);
-    pthread_cancel(executeThreadHandle);
-    pthread_cancel(memAccessThreadHandle);
-    pthread_cancel(regWriteThreadHandle);
-
-    /* Close all pipes */
-    close(pipe_fetch_to_decode[0]);
-    close(pipe_fetch_to_decode[1]);
-    close(pipe_decode_to_execute[0]);
-    close(pipe_decode_to_execute[1]);
-    close(pipe_execute_to_memAccess[0]);
-    close(pipe_execute_to_memAccess[1]);
-    close(pipe_memAccess_to_regWrite[0]);
-    close(pipe_memAccess_to_regWrite[1]);
-
-    printf("Cleanup done. Exiting program.\n");
-    exit(0);
+void pipelineHandOff(sim_t *sim, currentStage stage) {
+    pipelineState *pipeline = &sim->pipeline;
+    pipeline->currStage = stage;
+    atomic_thread_fence(memory_order_release);
+    pthread_kill(pipeline->threads[pipeline->owner[stage]].handle, SIGUSR1);
 }
-/* Signal handler for SIGINT (Ctrl+C) */
-void sigint_handler(int sig) {
-    printf("SIGINT received. Initiating cleanup...\n");
-    cleanup();
+
+/* Runs the stages of one thread. Stages that share a thread run back to back, so only a stage on
+   another thread costs a signal */
+void *stageThreadMain(void *arg) {
+    stageThread *self = (stageThread *)arg;
+    sim_t *sim = self->sim;
+    pipelineState *pipeline = &sim->pipeline;
+    int signal;
+
+    if (self->cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(self->cpu, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+            fprintf(stderr, "Could not pin a pipeline thread to CPU %d\n", self->cpu);
+        }
+    }
+    for (currentStage stage = self->first; stage <= self->last && stage != REG_WRITE_BACK; stage++) {
+        void *latch = mmap(NULL, latchBytes[stage], PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (latch == MAP_FAILED) {
+            perror("Latch allocation error");
+            exit(1);
+        }
+        memset(latch, 0, latchBytes[stage]);
+        pipeline->latches[stage] = latch;
+    }
+    pthread_barrier_wait(&pipeline->startBarrier);
+
+    for (;;) {
+        /* Block on signal */
+        sigwait(&pipeline->set, &signal);
+        atomic_thread_fence(memory_order_acquire);
+
+        currentStage stage = pipeline->currStage;
+        if (signal != SIGUSR1 || stage < self->first || stage > self->last) {
+            perror("Different signal received");
+            continue;
+        }
+        do {
+            stage = runStage(sim, stage);
+        } while (stage >= self->first && stage <= self->last);
+
+        /* STAGE_COUNT: the budget is spent and pipelineRun has been woken up */
+        if (stage != STAGE_COUNT) {
+            pipelineHandOff(sim, stage);
+        }
+    }
 }
 
-/* Initializes all pipes */
-int initialPipes() {
-    if (pipe(pipe_fetch_to_decode) == -1 ||
-        pipe(pipe_decode_to_execute) == -1 ||
-        pipe(pipe_execute_to_memAccess) == -1 ||
-        pipe(pipe_memAccess_to_regWrite) == -1) {
-        perror("Pipe creation error");
-        exit(EXIT_FAILURE);
+uint64_t pipelineRun(sim_t *sim, uint64_t n) {
+    pipelineState *pipeline = &sim->pipeline;
+    uint64_t start = sim->instructionsRetired;
+    if (n == 0 || sim->halted) {
+        return 0;
     }
 
-    /* Convert read ends to non-blocking */
-    int flags;
-    flags = fcntl(pipe_fetch_to_decode[0], F_GETFL, 0);
-    fcntl(pipe_fetch_to_decode[0], F_SETFL, flags | O_NONBLOCK); /* or the nonblock bit*/
+    /* Simulators that never run in detail never pay for the threads */
+    if (!pipeline->started) {
+        initializeSignal(sim);
+        initializeThreads(sim);
+        pipeline->started = true;
+    }
 
-    flags = fcntl(pipe_decode_to_execute[0], F_GETFL, 0);
-    fcntl(pipe_decode_to_execute[0], F_SETFL, flags | O_NONBLOCK);
+    pthread_mutex_lock(&pipeline->retireLock);
+    pipeline->pipelineBudget = n;
+    pipeline->pipelineIdle = false;
+    pipeline->fetchFlush = true;   /* The interpreter may have run or changed the code since */
+    pthread_mutex_unlock(&pipeline->retireLock);
 
-    flags = fcntl(pipe_execute_to_memAccess[0], F_GETFL, 0);
-    fcntl(pipe_execute_to_memAccess[0], F_SETFL, flags | O_NONBLOCK);
+    sendRisingEdge(sim);
 
-    flags = fcntl(pipe_memAccess_to_regWrite[0], F_GETFL, 0);
-    fcntl(pipe_memAccess_to_regWrite[0], F_SETFL, flags | O_NONBLOCK);
+    pthread_mutex_lock(&pipeline->retireLock);
+    while (!pipeline->pipelineIdle) {
+        pthread_cond_wait(&pipeline->retireCond, &pipeline->retireLock);
+    }
+    pthread_mutex_unlock(&pipeline->retireLock);
+    return sim->instructionsRetired - start;
 }
 
-/* Initializes signal handling */
-int initializeSignal() {
-    sigemptyset(&set);
-    sigaddset(&set, SIGUSR1);
-    pthread_sigmask(SIG_BLOCK, &set, NULL);
+static inline fetchLatch *fetchQueueAt(pipelineState *pipeline, uint32_t index) {
+    return &pipeline->fetchQueue[(pipeline->fetchHead + index) % FETCH_QUEUE_MAX];
 }
 
-/* Initializes all threads */
-int initializeThreads() {
-    pthread_create(&fetchThreadHandle, NULL, fetchThread, (void*)&set);
-    pthread_create(&decodeThreadHandle, NULL, decodeThread, (void*)&set);
-    pthread_create(&executeThreadHandle, NULL, executeThread, (void*)&set);
-    pthread_create(&memAccessThreadHandle, NULL, memAccessThread, (void*)&set);
-    pthread_create(&regWriteThreadHandle, NULL, regWriteThread, (void*)&set);
+/* Appends one block to the fetch queue: up to fetchWidth instructions of the I-cache line fetchPc is
+   in, ending after a branch the predictor takes. A fault ends it as well, the faulting fetch is
+   repeated once it reaches the head so that speculation never reports one */
+static void fetchBlock(sim_t *sim) {
+    pipelineState *pipeline = &sim->pipeline;
+    const timingModel *model = &sim->timing;
+    uint32_t pc = pipeline->fetchPc;
+    uint32_t line = pc >> model->icache.lineShift;
+
+    for (uint32_t i = 0; i < model->cfg.fetchWidth && (pc >> model->icache.lineShift) == line; i++) {
+        fetchLatch *entry = fetchQueueAt(pipeline, pipeline->fetchCount);
+        uint32_t opcode;
+
+        entry->pc = pc;
+        entry->instruction = fetchParcel(sim, pc, &entry->length);
+        entry->nextLength = 0;
+        if (entry->length == 0) {
+            break;
+        }
+        pipeline->fetchCount++;
+
+        /* Predecode, only branches and jumps steer fetch */
+        opcode = entry->instruction & 0x7F;
+        if (opcode == 0x63 || opcode == 0x6F || opcode == JALR_I_TYPE) {
+            uint32_t next = timingPredictNext(model, pc, entry->length, opcode == 0x63);
+            if (next != pc + entry->length) {
+                pc = next;
+                break;
+            }
+        }
+        pc += entry->length;
+    }
+    pipeline->fetchPc = pc;
 }
 
-/* Fetch Thread */
-void *fetchThread(void *arg) {
-    sigset_t *set = (sigset_t *)arg;
-    int signal;
-    
+/* Fetch stage */
+static void fetchStage(sim_t *sim) {
+    pipelineState *pipeline = &sim->pipeline;
+    const timingConfig *cfg = &sim->timing.cfg;
+    fetchLatch *latch = (fetchLatch *)pipeline->latches[FETCH];
+    uint32_t pc;
+
+#ifdef DEBUG
+    printf("Fetch Thread\n");
+#endif
+    /* Interrupts are taken between instructions, before the next one is fetched */
+    checkInterrupts(sim);
+    pc = sim->regFile.programCounter;
+
+    /* The second half of a fused pair was decoded along with the first one */
+    if (pipeline->fetchPeeked && pipeline->fetchCount != 0) {
+        fetchLatch *head = fetchQueueAt(pipeline, 0);
+        if (head->pc != pc && head->pc + head->length == pc) {
+            pipeline->fetchHead = (pipeline->fetchHead + 1) % FETCH_QUEUE_MAX;
+            pipeline->fetchCount--;
+        }
+    }
 
-    for (;;) {
-        /* Block on signal */
-        sigwait(set, &signal);
+    /* Anything but the predicted path is a mispredict, trap or interrupt, refetch from pc */
+    if (pipeline->fetchFlush || (pipeline->fetchCount != 0 && fetchQueueAt(pipeline, 0)->pc != pc)) {
+        pipeline->fetchCount = 0;
+        pipeline->fetchFlush = false;
+    }
+    if (pipeline->fetchCount == 0) {
+        pipeline->fetchPc = pc;
+    }
+    if (pipeline->fetchCount + cfg->fetchWidth <= cfg->fetchQueueDepth) {
+        fetchBlock(sim);
+    }
 
-        if (signal == SIGUSR1 && currStage == FETCH) {
-            printf("Fetch Thread\n");
+    /* Fetch instruction from the queue, compressed ones were expanded when they entered it */
+    if (pipeline->fetchCount != 0) {
+        *latch = *fetchQueueAt(pipeline, 0);
+        pipeline->fetchHead = (pipeline->fetchHead + 1) % FETCH_QUEUE_MAX;
+        pipeline->fetchCount--;
+    } else {
+        latch->pc = pc;
+        latch->instruction = fetchParcel(sim, pc, &latch->length);
+    }
+    sim->regFile.instructionRegister = latch->instruction;
+
+    /* A fused pair retires two instructions, so it needs two left in the budget. The partner is
+       normally the next queue entry and stays there until the pair is known to fuse */
+    latch->nextLength = 0;
+    pipeline->fetchPeeked = false;
+    if (sim->fusion && latch->length != 0 && pipeline->pipelineBudget >= 2 && isFusionHead(latch->instruction)) {
+        fetchLatch *partner = fetchQueueAt(pipeline, 0);
+        if (pipeline->fetchCount != 0 && partner->pc == latch->pc + latch->length) {
+            latch->next = partner->instruction;
+            latch->nextLength = partner->length;
+            pipeline->fetchPeeked = true;
+        } else {
+            latch->next = fetchParcel(sim, latch->pc + latch->length, &latch->nextLength);
+        }
+    }
+}
+
+/* Integer OPIVV/OPIVX/OPIVI ops by funct6, forms lists the operand kinds each one exists in */
+static uint8_t vectorIntegerOp(uint8_t funct6, uint8_t funct3) {
+    uint8_t op;
+    uint32_t forms;
+
+    switch (funct6) {
+        case 0x00: op = OP_VADD;   forms = FORMS_VXI; break;
+        case 0x02: op = OP_VSUB;   forms = FORMS_VX;  break;
+        case 0x03: op = OP_VRSUB;  forms = FORMS_XI;  break;
+        case 0x09: op = OP_VAND;   forms = FORMS_VXI; break;
+        case 0x0A: op = OP_VOR;    forms = FORMS_VXI; break;
+        case 0x0B: op = OP_VXOR;   forms = FORMS_VXI; break;
+        case 0x17: op = OP_VMERGE; forms = FORMS_VXI; break;
+        case 0x18: op = OP_VMSEQ;  forms = FORMS_VXI; break;
+        case 0x19: op = OP_VMSNE;  forms = FORMS_VXI; break;
+        case 0x1A: op = OP_VMSLTU; forms = FORMS_VX;  break;
+        case 0x1B: op = OP_VMSLT;  forms = FORMS_VX;  break;
+        case 0x1C: op = OP_VMSLEU; forms = FORMS_VXI; break;
+        case 0x1D: op = OP_VMSLE;  forms = FORMS_VXI; break;
+        case 0x1E: op = OP_VMSGTU; forms = FORMS_XI;  break;
+        case 0x1F: op = OP_VMSGT;  forms = FORMS_XI;  break;
+        case 0x25: op = OP_VSLL;   forms = FORMS_VXI; break;
+        case 0x28: op = OP_VSRL;   forms = FORMS_VXI; break;
+        case 0x29: op = OP_VSRA;   forms = FORMS_VXI; break;
+        default:
+            return OP_ILLEGAL;
+    }
+    return (forms & VECTOR_FORM(funct3)) ? op : OP_ILLEGAL;
+}
+
+/* OPMVV/OPMVX ops by funct6, vs1 (OPMVV) or vs2 (OPMVX) select the unary ones */
+static uint8_t vectorMaskOrReduceOp(uint8_t funct6, uint8_t funct3, uint8_t vs1, uint8_t vs2) {
+    if (funct6 == 0x25) {
+        return OP_VMUL;
+    }
+    if (funct3 == OPMVX) {
+        return funct6 == 0x10 && vs2 == 0 ? OP_VMV_S_X : OP_ILLEGAL;
+    }
+    if (funct6 <= 0x07) {
+        return OP_VREDSUM + funct6;   /* vredsum..vredmax keep the funct6 order */
+    }
+    if (funct6 >= 0x18 && funct6 <= 0x1F) {
+        return OP_VMANDN + (funct6 - 0x18);   /* Mask logical ops keep the funct6 order as well */
+    }
+    if (funct6 == 0x10) {
+        switch (vs1) {
+            case 0x00: return OP_VMV_X_S;
+            case 0x10: return OP_VCPOP;
+            case 0x11: return OP_VFIRST;
+            default: break;
+        }
+    }
+    return OP_ILLEGAL;
+}
 
-            /* Fetch instruction from Instruction memory using program counter */
-            regFile.instructionRegister =  0x00410093;//addi   //fetchInstruction( regFile.programCounter );
+void decodeVectorInstruction(uint32_t instruction, decodedFields *df) {
+    df->instrFields.v_type.vd = INSTRUCTION_TO_RD(instruction);
+    df->instrFields.v_type.funct3 = INSTRUCTION_TO_FUNCT3(instruction);
+    df->instrFields.v_type.vs1 = INSTRUCTION_TO_RS1(instruction);
+    df->instrFields.v_type.vs2 = INSTRUCTION_TO_RS2(instruction);
+    df->instrFields.v_type.funct6 = (instruction >> 26) & 0b111111;
+    df->instrFields.v_type.vm = (instruction >> 25) & 0b1;
+
+    uint8_t funct3 = df->instrFields.v_type.funct3;
+    uint8_t funct6 = df->instrFields.v_type.funct6;
+
+    if (df->opcode == LOAD_FP_F_TYPE || df->opcode == STORE_FP_F_TYPE) {
+        bool load = df->opcode == LOAD_FP_F_TYPE;
+        uint8_t mop = funct6 & 0b11;
+        uint8_t lumop = df->instrFields.v_type.vs2;
+
+        /* Element widths 8, 16 and 32 only, segments, mew and indexed accesses are not supported */
+        if ((funct3 != 0x0 && funct3 != 0x5 && funct3 != 0x6) || (funct6 >> 2) != 0) {
+            return;
+        }
+        if (mop == 0b10) {
+            df->microOp = load ? OP_VLSE : OP_VSSE;
+        } else if (mop == 0b00 && lumop == 0x00) {
+            df->microOp = load ? OP_VLE : OP_VSE;
+        } else if (mop == 0b00 && lumop == 0x0B && funct3 == 0x0 && df->instrFields.v_type.vm) {
+            df->microOp = load ? OP_VLM : OP_VSM;
+        }
+        return;
+    }
 
-            /* Incriment Program counter by 4 bytes (32 bits) */
-            regFile.programCounter += 4;
+    switch (funct3) {
+        case OPCFG:
+            if ((instruction >> 31) == 0) {
+                df->microOp = OP_VSETVLI;
+                df->instrFields.v_type.zimm = (instruction >> 20) & 0x7FF;
+            } else if ((instruction >> 30) == 0b11) {
+                df->microOp = OP_VSETIVLI;
+                df->instrFields.v_type.zimm = (instruction >> 20) & 0x3FF;
+            } else if (((instruction >> 25) & 0b111111) == 0) {
+                df->microOp = OP_VSETVL;
+            }
+            break;
+        case OPIVV:
+        case OPIVI:
+        case OPIVX:
+            df->microOp = vectorIntegerOp(funct6, funct3);
+            break;
+        case OPMVV:
+        case OPMVX:
+            df->microOp = vectorMaskOrReduceOp(funct6, funct3, df->instrFields.v_type.vs1, df->instrFields.v_type.vs2);
+            break;
+        default:
+            /* Floating point vector ops */
+            break;
+    }
+}
+
+/* OP-FP ops by funct5 as their single precision form, rm and rs2 select the variants */
+static uint8_t floatOp(uint8_t funct5, uint8_t rm, uint8_t rs2) {
+    switch (funct5) {
+        case 0x00: return OP_FADD_S;
+        case 0x01: return OP_FSUB_S;
+        case 0x02: return OP_FMUL_S;
+        case 0x03: return OP_FDIV_S;
+        case 0x0B: return rs2 == 0 ? OP_FSQRT_S : OP_ILLEGAL;
+        case 0x04: return rm <= 0x2 ? OP_FSGNJ_S + rm : OP_ILLEGAL;      /* fsgnj, fsgnjn, fsgnjx */
+        case 0x05: return rm <= 0x1 ? OP_FMIN_S + rm : OP_ILLEGAL;       /* fmin, fmax */
+        case 0x14: return rm <= 0x2 ? OP_FLE_S - rm : OP_ILLEGAL;        /* fle, flt, feq */
+        case 0x18: return rs2 <= 0x1 ? OP_FCVT_W_S + rs2 : OP_ILLEGAL;   /* fcvt.w, fcvt.wu */
+        case 0x1A: return rs2 <= 0x1 ? OP_FCVT_S_W + rs2 : OP_ILLEGAL;   /* fcvt from w, wu */
+        case 0x1C:
+            if (rs2 != 0) {
+                return OP_ILLEGAL;
+            }
+            return rm == 0x0 ? OP_FMV_X_W : rm == 0x1 ? OP_FCLASS_S : OP_ILLEGAL;
+        case 0x1E: return rs2 == 0 && rm == 0x0 ? OP_FMV_W_X : OP_ILLEGAL;
+        default:
+            return OP_ILLEGAL;
+    }
+}
 
-            /* Pass the fetched uint32_t instruction */
-            write( pipe_fetch_to_decode[1], (char *) &regFile.instructionRegister, sizeof(regFile.instructionRegister) ); /* replace  with fucntion clal*/
+void decodeFloatInstruction(uint32_t instruction, decodedFields *df) {
+    bool memory = df->opcode == LOAD_FP_F_TYPE || df->opcode == STORE_FP_F_TYPE;
 
-            currStage = DECODE;
-            pthread_kill(decodeThreadHandle, SIGUSR1);
+    /* Widths 2 and 3 are flw/fsw and fld/fsd, every other width is a vector access */
+    if (memory && INSTRUCTION_TO_FUNCT3(instruction) != 0x2 && INSTRUCTION_TO_FUNCT3(instruction) != 0x3) {
+        df->instruction_type = V_TYPE;
+        decodeVectorInstruction(instruction, df);
+        return;
+    }
 
+    df->instrFields.f_type.rd = INSTRUCTION_TO_RD(instruction);
+    df->instrFields.f_type.rm = INSTRUCTION_TO_FUNCT3(instruction);
+    df->instrFields.f_type.rs1 = INSTRUCTION_TO_RS1(instruction);
+    df->instrFields.f_type.rs2 = INSTRUCTION_TO_RS2(instruction);
+    df->instrFields.f_type.rs3 = instruction >> 27;
+    df->instrFields.f_type.funct7 = INSTRUCTION_TO_FUNCT7(instruction);
+
+    uint8_t rm = df->instrFields.f_type.rm;
+    uint8_t rs2 = df->instrFields.f_type.rs2;
+    uint8_t fmt = df->instrFields.f_type.funct7 & 0b11;
+    uint8_t funct5 = df->instrFields.f_type.funct7 >> 2;
+    uint8_t op;
+
+    if (memory) {
+        bool load = df->opcode == LOAD_FP_F_TYPE;
+        df->instrFields.f_type.imm12 = load ? INSTRUCTION_TO_IMMI_12(instruction) : INSTRUCTION_TO_IMM_S(instruction);
+        if (load) {
+            df->microOp = rm == 0x2 ? OP_FLW : OP_FLD;
         } else {
-            perror("Different signal received");
+            df->microOp = rm == 0x2 ? OP_FSW : OP_FSD;
         }
+        return;
     }
-}
 
+    if (df->opcode >= MADD_F_TYPE && df->opcode <= NMADD_F_TYPE) {
+        op = OP_FMADD_S + ((df->opcode >> 2) & 0b11);   /* fmadd, fmsub, fnmsub, fnmadd */
+    } else if (funct5 == 0x08) {
+        /* fcvt.s.d and fcvt.d.s, rs2 holds the source format */
+        if (fmt == 0 && rs2 == 1) {
+            df->microOp = OP_FCVT_S_D;
+        } else if (fmt == 1 && rs2 == 0) {
+            df->microOp = OP_FCVT_D_S;
+        }
+        return;
+    } else {
+        op = floatOp(funct5, rm, rs2);
+    }
 
+    /* The double forms keep the order of the single ones, fmv.x.w and fmv.w.x have none on RV32 */
+    if (fmt == 0) {
+        df->microOp = op;
+    } else if (fmt == 1 && op >= OP_FMADD_S && op <= OP_FCVT_S_WU) {
+        df->microOp = op + (OP_FMADD_D - OP_FMADD_S);
+    }
+}
 
-/* Decode Thread */
-void *decodeThread(void *arg) {
-    sigset_t *set = (sigset_t *)arg;
-    int signal;
-    
-    /* Instructions to decode */
-    uint32_t instructionToDecode;
+static void decodeRFields(uint32_t instruction, decodedFields *df) {
+    df->instrFields.r_type.rd = INSTRUCTION_TO_RD(instruction);
+    df->instrFields.r_type.funct3 = INSTRUCTION_TO_FUNCT3(instruction);
+    df->instrFields.r_type.rs1 = INSTRUCTION_TO_RS1(instruction);
+    df->instrFields.r_type.rs2 = INSTRUCTION_TO_RS2(instruction);
+    df->instrFields.r_type.funct7 = INSTRUCTION_TO_FUNCT7(instruction);
+}
+
+//atomic extension, funct5 lives in the top of funct7 next to aq/rl
+void decodeAtomicInstruction(uint32_t instruction, decodedFields *df) {
+    decodeRFields(instruction, df);
+    if (df->instrFields.r_type.funct3 != 0x2) {
+        perror("Only word atomics are supported");
+        return;
+    }
+    switch (df->instrFields.r_type.funct7 >> 2) {
+        case 0x02: df->microOp = OP_LRW; break;
+        case 0x03: df->microOp = OP_SCW; break;
+        case 0x01: df->microOp = OP_AMOSWAPW; break;
+        case 0x00: df->microOp = OP_AMOADDW; break;
+        case 0x04: df->microOp = OP_AMOXORW; break;
+        case 0x0C: df->microOp = OP_AMOANDW; break;
+        case 0x08: df->microOp = OP_AMOORW; break;
+        case 0x10: df->microOp = OP_AMOMINW; break;
+        case 0x14: df->microOp = OP_AMOMAXW; break;
+        case 0x18: df->microOp = OP_AMOMINUW; break;
+        case 0x1C: df->microOp = OP_AMOMAXUW; break;
+        default:
+            perror("404 atomic op not found");
+            break;
+    }
+}
 
+//mul extention shares every funct3 with the base ops
+void decodeMulInstruction(uint32_t instruction, decodedFields *df) {
+    decodeRFields(instruction, df);
+    switch(df->instrFields.r_type.funct3){
+        case 0x0:
+            df->microOp = OP_MUL;
+            break;
+        case 0x1:
+            df->microOp = OP_MULH;
+            break;
+        case 0x2:
+            df->microOp = OP_MULSU;
+            break;
+        case 0x3:
+            df->microOp = OP_MULU;
+            break;
+        case 0x4:
+            df->microOp = OP_DIV;
+            break;
+        case 0x5:
+            df->microOp = OP_DIVU;
+            break;
+        case 0x6:
+            df->microOp = OP_REM;
+            break;
+        case 0x7:
+            df->microOp = OP_REMU;
+            break;
+        default:
+            perror("404 r type mul op not found");
+            break;
+    }
+}
 
-    for (;;) {
-        /* Block on signal */
-        sigwait(set, &signal);
-
-        if (signal == SIGUSR1 && read(pipe_fetch_to_decode[0], &instructionToDecode, sizeof(instructionToDecode)) && (currStage == DECODE) ) {
-            printf("Decode Thread. Instruction read %08X\n", instructionToDecode);
-
-           
-
-            decodedFields df = {0};
-            df.opcode = instructionToDecode & 0b1111111; /* extract opcode*/
-            df.instruction_type = get_Instr_Type(df.opcode);//we have 3 i types btw each has diff opcode
-            INSTR_TYPE type = df.instruction_type;
-            /* Determine type of instruction */
-            switch(type){
-                case R_TYPE://Rtype
-                    df.instrFields.r_type.rd = INSTRUCTION_TO_RD(instructionToDecode);
-                    df.instrFields.r_type.funct3 = INSTRUCTION_TO_FUNCT3(instructionToDecode);
-                    df.instrFields.r_type.rs1 = INSTRUCTION_TO_RS1(instructionToDecode);
-                    df.instrFields.r_type.rs2 = INSTRUCTION_TO_RS2(instructionToDecode);
-                    df.instrFields.r_type.funct7 = INSTRUCTION_TO_FUNCT7(instructionToDecode);
-                    //bro missed like 10 break statements
-
-                    /* Determine exact instruction*/
-                    switch (df.instrFields.r_type.funct3) {
-                        case 0x0:
-                            switch (df.instrFields.r_type.funct7) {
-                                case 0x00:
-                                    df.microOp = OP_ADD;
-                                    break;
-                                case 0x20:
-                                    df.microOp = OP_SUB;
-                                    break;
-                                default:
-                                    perror("Incorrect funct7");
-                                    break;
-                            }
+/* The base integer ops, decodeFor routes the extension opcodes elsewhere before calling it */
+void decodeBaseInstruction(uint32_t instructionToDecode, decodedFields *df) {
+    INSTR_TYPE type = df->instruction_type;
+    /* Determine type of instruction */
+    switch(type){
+        case R_TYPE://Rtype
+            decodeRFields(instructionToDecode, df);
+            /* Determine exact instruction*/
+            switch (df->instrFields.r_type.funct3) {
+                case 0x0:
+                    switch (df->instrFields.r_type.funct7) {
+                        case 0x00:
+                            df->microOp = OP_ADD;
                             break;
-                        case 0x4:
-                            switch (df.instrFields.r_type.funct7) {
-                                case 0x00:
-                                    df.microOp = OP_XOR;
-                                    break;
-                                default:
-                                    perror("Incorrect funct7");
-
-                            }
+                        case 0x20:
+                            df->microOp = OP_SUB;
                             break;
-                        case 0x6:
-                            switch (df.instrFields.r_type.funct7) {
-                                case 0x00:
-                                    df.microOp = OP_OR;
-                                    break;
-                                default:
-                                    perror("Incorrect funct7");
-                            }
+                        default:
+                            perror("Incorrect funct7");
+                            break;
+                    }
+                    break;
+                case 0x4:
+                    switch (df->instrFields.r_type.funct7) {
+                        case 0x00:
+                            df->microOp = OP_XOR;
                             break;
-                        case 0x7:
-                            switch (df.instrFields.r_type.funct7) {
-                                case 0x00:
-                                   df.microOp = OP_AND;
-                                   break;
-                                default:
-                                    perror("Incorrect funct7");
-                            }
+                        default:
+                            perror("Incorrect funct7");
+
+                    }
+                    break;
+                case 0x6:
+                    switch (df->instrFields.r_type.funct7) {
+                        case 0x00:
+                            df->microOp = OP_OR;
                             break;
-                        case 0x1:
-                            switch (df.instrFields.r_type.funct7) {
-                                case 0x00:
-                                    df.microOp = OP_SLL;
-                                    break;
-                                case 0x01://mul extention
-                                    switch(df.instrFields.r_type.funct3){
-                                        case 0x0:
-                                            df.microOp = OP_MUL;
-                                            break;
-                                        case 0x1:
-                                            df.microOp = OP_MULH;
-                                            break;
-                                        case 0x2:
-                                            df.microOp = OP_MULSU;
-                                            break;
-                                        case 0x3:
-                                            df.microOp = OP_MULU;
-                                            break;
-                                        case 0x4:
-                                            df.microOp = OP_DIV;
-                                            break;
-                                        case 0x5:
-                                            df.microOp = OP_DIVU;
-                                            break;
-                                        case 0x6:
-                                            df.microOp = OP_REM;
-                                            break;
-                                        case 0x7:
-                                            df.microOp = OP_REMU;
-                                            break;
-                                        default:
-                                            perror("404 r type mul op not found");
-                                            break;
-                                    }
-                                    break;
-                                default:
-                                    perror("Incorrect funct7");
-
-                            }
+                        default:
+                            perror("Incorrect funct7");
+                    }
+                    break;
+                case 0x7:
+                    switch (df->instrFields.r_type.funct7) {
+                        case 0x00:
+                           df->microOp = OP_AND;
+                           break;
+                        default:
+                            perror("Incorrect funct7");
+                    }
+                    break;
+                case 0x1:
+                    switch (df->instrFields.r_type.funct7) {
+                        case 0x00:
+                            df->microOp = OP_SLL;
                             break;
-                        case 0x5:
-                            switch (df.instrFields.r_type.funct7) {
-                                case 0x00:
-                                    df.microOp = OP_SRL;
-                                    break;
-                                case 0x20:
-                                    df.microOp = OP_SRA;
-                                    break;
-                                default:
-                                    perror("Incorrect funct7");
-
-                            }
+                        default:
+                            perror("Incorrect funct7");
+
+                    }
+                    break;
+                case 0x5:
+                    switch (df->instrFields.r_type.funct7) {
+                        case 0x00:
+                            df->microOp = OP_SRL;
                             break;
-                        case 0x2:
-                            switch (df.instrFields.r_type.funct7) {
-                                case 0x00:
-                                    df.microOp = OP_SLT;
-                                    break;
-                                default:
-                                    perror("Incorrect funct7");
-
-                            }
+                        case 0x20:
+                            df->microOp = OP_SRA;
                             break;
-                        case 0x3:
-                            switch (df.instrFields.r_type.funct7) {
-                                case 0x00:
-                                    df.microOp = OP_SLTU;
-                                    break;
-                                default:
-                                    perror("Incorrect funct7");
-
-                            }
+                        default:
+                            perror("Incorrect funct7");
+
+                    }
+                    break;
+                case 0x2:
+                    switch (df->instrFields.r_type.funct7) {
+                        case 0x00:
+                            df->microOp = OP_SLT;
                             break;
                         default:
-                            perror("incorect funct3 bits");
+                            perror("Incorrect funct7");
+
                     }
-                case I_TYPE:
-                    df.instrFields.i_type.rd = INSTRUCTION_TO_RD(instructionToDecode);
-                    df.instrFields.i_type.funct3 = INSTRUCTION_TO_FUNCT3(instructionToDecode);
-                    df.instrFields.i_type.rs1 = INSTRUCTION_TO_RS1(instructionToDecode);
-                    df.instrFields.i_type.imm12 = INSTRUCTION_TO_IMMI_12(instructionToDecode);
-                    // Logical I-type
-                    if (df.opcode == LOGICAL_I_TYPE){
-                        switch(df.instrFields.i_type.funct3){
-                            case 0x0:
-                                df.microOp = OP_ADDI;
-                                break;
-                            case 0x1:
-                                df.microOp = OP_SLLI;
-                                break;
-                            case 0x2:
-                                df.microOp = OP_SLTI;
-                                break;
-                            case 0x3:
-                                df.microOp = OP_SLTIU;
-                                break;
-                            case 0x4:
-                                df.microOp = OP_XORI;
-                                break;
-                            case 0x5:
-                                switch(df.instrFields.i_type.funct3){
-                                    case 0x0 :
-                                        df.microOp = OP_SRLI;
-                                        break;
-                                    case 0x20 :
-                                        df.microOp = OP_SRAI;
-                                        break;
-                                    default:
-                                        perror("illegal imm for srli and srai differentiation\n");
-                                }
-                                break;
-                            case 0x6:
-                                df.microOp = OP_ORI;
-                                break;
-                            case 0x7:
-                                df.microOp = OP_ANDI;
-                                break;
-                            default:
-                                perror("404 I type funct 3 not found\n");
-                                printf("%x LoadI-type instruction not found", df.opcode);
-                            }
+                    break;
+                case 0x3:
+                    switch (df->instrFields.r_type.funct7) {
+                        case 0x00:
+                            df->microOp = OP_SLTU;
+                            break;
+                        default:
+                            perror("Incorrect funct7");
+
                     }
-                    //ecall/ebreak
-                    else if(df.opcode == 0b1110011){
-                        switch(df.instrFields.i_type.imm12){
-                            case 0x0:
-                                df.microOp = OP_ECALL;
+                    break;
+                default:
+                    perror("incorect funct3 bits");
+            }
+            break;
+        case I_TYPE:
+            df->instrFields.i_type.rd = INSTRUCTION_TO_RD(instructionToDecode);
+            df->instrFields.i_type.funct3 = INSTRUCTION_TO_FUNCT3(instructionToDecode);
+            df->instrFields.i_type.rs1 = INSTRUCTION_TO_RS1(instructionToDecode);
+            df->instrFields.i_type.imm12 = INSTRUCTION_TO_IMMI_12(instructionToDecode);
+            // Logical I-type
+            if (df->opcode == LOGICAL_I_TYPE){
+                switch(df->instrFields.i_type.funct3){
+                    case 0x0:
+                        df->microOp = OP_ADDI;
+                        break;
+                    case 0x1:
+                        df->microOp = OP_SLLI;
+                        break;
+                    case 0x2:
+                        df->microOp = OP_SLTI;
+                        break;
+                    case 0x3:
+                        df->microOp = OP_SLTIU;
+                        break;
+                    case 0x4:
+                        df->microOp = OP_XORI;
+                        break;
+                    case 0x5:
+                        /* Upper immediate bits tell srli and srai apart */
+                        switch(df->instrFields.i_type.imm12 >> 5){
+                            case 0x0 :
+                                df->microOp = OP_SRLI;
                                 break;
-                            case 0x1:
-                                df.microOp = OP_EBREAK;//idk how we're gonna implement this lmao
+                            case 0x20 :
+                                df->microOp = OP_SRAI;
                                 break;
                             default:
-                                perror("ecall/break error");//was spelled peerror lmao
+                                perror("illegal imm for srli and srai differentiation\n");
                         }
+                        break;
+                    case 0x6:
+                        df->microOp = OP_ORI;
+                        break;
+                    case 0x7:
+                        df->microOp = OP_ANDI;
+                        break;
+                    default:
+                        perror("404 I type funct 3 not found\n");
+                        printf("%x LoadI-type instruction not found", df->opcode);
                     }
-                    //Load I-type
-                    else if(df.opcode == LOAD_I_TYPE){
-                        switch(df.instrFields.i_type.funct3){
-                            case 0x0:
-                                df.microOp = OP_LB;
-                                break;
-                            case 0x1:
-                                df.microOp = OP_LH;
-                                break;
-                            case 0x2:
-                                df.microOp = OP_LW;
-                                break;
-                            case 0x4:
-                                df.microOp = OP_LBU;
-                                break;
-                            case 0x5:
-                                df.microOp = OP_LHU;
-                                break;
-                            default:
-                                printf("%x Load I-type instruction not found", df.opcode);
-                                break;
+            }
+            //ecall/ebreak
+            else if(df->opcode == SYSTEM_I_TYPE && df->instrFields.i_type.funct3 == 0x0){
+                switch(df->instrFields.i_type.imm12){
+                    case 0x0:
+                        df->microOp = OP_ECALL;
+                        break;
+                    case 0x1:
+                        df->microOp = OP_EBREAK;//idk how we're gonna implement this lmao
+                        break;
+                    case 0x302:
+                        df->microOp = OP_MRET;
+                        break;
+                    case 0x105:
+                        df->microOp = OP_WFI;
+                        break;
+                    default:
+                        /* sfence.vma is R-type shaped, funct7 lands in the top of imm12 */
+                        if ((df->instrFields.i_type.imm12 >> 5) == 0x09 && df->instrFields.i_type.rd == 0) {
+                            df->microOp = OP_SFENCE_VMA;
+                            break;
                         }
-                    }
+                        perror("ecall/break error");//was spelled peerror lmao
+                }
+            }
+            //Zicsr, imm12 holds the csr number and rs1 doubles as the 5 bit immediate
+            else if(df->opcode == SYSTEM_I_TYPE){
+                switch(df->instrFields.i_type.funct3){
+                    case 0x1:
+                        df->microOp = OP_CSRRW;
+                        break;
+                    case 0x2:
+                        df->microOp = OP_CSRRS;
+                        break;
+                    case 0x3:
+                        df->microOp = OP_CSRRC;
+                        break;
+                    case 0x5:
+                        df->microOp = OP_CSRRWI;
+                        break;
+                    case 0x6:
+                        df->microOp = OP_CSRRSI;
+                        break;
+                    case 0x7:
+                        df->microOp = OP_CSRRCI;
+                        break;
+                    default:
+                        perror("404 csr funct 3 not found\n");
+                        break;
+                }
+            }
+            //Load I-type
+            else if(df->opcode == LOAD_I_TYPE){
+                switch(df->instrFields.i_type.funct3){
+                    case 0x0:
+                        df->microOp = OP_LB;
+                        break;
+                    case 0x1:
+                        df->microOp = OP_LH;
+                        break;
+                    case 0x2:
+                        df->microOp = OP_LW;
+                        break;
+                    case 0x4:
+                        df->microOp = OP_LBU;
+                        break;
+                    case 0x5:
+                        df->microOp = OP_LHU;
+                        break;
+                    default:
+                        printf("%x Load I-type instruction not found", df->opcode);
+                        break;
+                }
+            }
 
-                    else if(df.opcode== JAL_I_TYPE) {
-                        switch(df.instrFields.i_type.funct3) {
-                            case 0x0:
-                                df.microOp = OP_JAL;
-                                break;
-                            default:
-                                perror("404 I type funct 3 not found\n");
-                                break;
-                        }
-                    }
+            else if(df->opcode== JALR_I_TYPE) {
+                switch(df->instrFields.i_type.funct3) {
+                    case 0x0:
+                        df->microOp = OP_JALR;
+                        break;
+                    default:
+                        perror("404 I type funct 3 not found\n");
+                        break;
+                }
+            }
+            else if(df->opcode == FENCE_I_TYPE) {
+                df->microOp = OP_FENCE;
+            }
+            break;
+
+        case S_TYPE:
+            df->instrFields.s_type.rs1 = INSTRUCTION_TO_RS1(instructionToDecode);
+            df->instrFields.s_type.rs2 = INSTRUCTION_TO_RS2(instructionToDecode);
+            df->instrFields.s_type.funct3 = INSTRUCTION_TO_FUNCT3(instructionToDecode);
+            df->instrFields.s_type.imm12 = INSTRUCTION_TO_IMM_S(instructionToDecode);
+            switch(df->instrFields.s_type.funct3){
+                case 0x0:
+                    df->microOp = OP_SB;
                     break;
-
-                case S_TYPE:
-
+                case 0x1:
+                    df->microOp = OP_SH;
                     break;
-                case B_TYPE:
-                    df.instrFields.b_type.rs1 = INSTRUCTION_TO_RS1(instructionToDecode);
-                    df.instrFields.b_type.rs2 = INSTRUCTION_TO_RS2(instructionToDecode);
-                    df.instrFields.b_type.funct3 = INSTRUCTION_TO_FUNCT3(instructionToDecode);
-                    df.instrFields.b_type.imm12 = INSTRUCTION_TO_IMM_B(instructionToDecode);
-                                // df.instrFields.b_type.imm12 =  
-                                // switch(df.instrFields.b_type.funct3){
-                                //     break;
-                                //     default:
-                                //     perror("b type instruction error");
-                                // }
+                case 0x2:
+                    df->microOp = OP_SW;
                     break;
-
-                        // Branch
-                case U_TYPE:
-                    df.instrFields.u_type.rd = INSTRUCTION_TO_RD(instructionToDecode);
-                    df.instrFields.u_type.imm20 = INSTRUCTION_TO_IMM_U(instructionToDecode);
+                default:
+                    perror("s type instruction error");
+            }
+            break;
+        case B_TYPE:
+            df->instrFields.b_type.rs1 = INSTRUCTION_TO_RS1(instructionToDecode);
+            df->instrFields.b_type.rs2 = INSTRUCTION_TO_RS2(instructionToDecode);
+            df->instrFields.b_type.funct3 = INSTRUCTION_TO_FUNCT3(instructionToDecode);
+            df->instrFields.b_type.imm12 = INSTRUCTION_TO_IMM_B(instructionToDecode);
+            switch(df->instrFields.b_type.funct3){
+                case 0x0:
+                    df->microOp = OP_BEQ;
                     break;
-                case J_TYPE:
-                    //TODO
+                case 0x1:
+                    df->microOp = OP_BNE;
                     break;
-
-                case 0b0101111://atomic extension
+                case 0x4:
+                    df->microOp = OP_BLT;
+                    break;
+                case 0x5:
+                    df->microOp = OP_BGE;
+                    break;
+                case 0x6:
+                    df->microOp = OP_BLTU;
+                    break;
+                case 0x7:
+                    df->microOp = OP_BGEU;
                     break;
                 default:
-                    printf("Instruction type: %d not found", df.instruction_type);
-                    break;    
+                    perror("b type instruction error");
             }
-
-
-            /* Pass df to pipe */
-            write(pipe_decode_to_execute[1], &df, sizeof(df));
-            
-            currStage = EXECUTE;
-            pthread_kill(executeThreadHandle, SIGUSR1);
-
-            
-
-        } else {
-            perror("Nothing to decode yet");
-        }
+            break;
+
+                // Branch
+        case U_TYPE:
+            df->instrFields.u_type.rd = INSTRUCTION_TO_RD(instructionToDecode);
+            df->instrFields.u_type.imm20 = INSTRUCTION_TO_IMM_U(instructionToDecode);
+            df->microOp = df->opcode == LUI_U_TYPE ? OP_LUI : OP_AUIPC;
+            break;
+        case J_TYPE:
+            df->instrFields.j_type.rd = INSTRUCTION_TO_RD(instructionToDecode);
+            df->instrFields.j_type.imm20 = INSTRUCTION_TO_IMM_J(instructionToDecode);
+            df->microOp = OP_JAL;
+            break;
+
+        case V_TYPE:
+        case F_TYPE:
+        case ILLEGAL_TYPE:
+            /* Left as OP_ILLEGAL, write back reports it */
+            break;
+        default:
+            printf("Instruction type: %d not found", df->instruction_type);
+            break;    
     }
 }
 
-/* Execute Thread */
-void *executeThread(void *arg) { /* replace with fucntion */
-    sigset_t *set = (sigset_t *)arg;
-    int signal;
-    
-    /* Will be populated from data from pipe*/
-    decodedFields df = {0};
+void decodeInstruction(uint32_t instructionToDecode, decodedFields *df) {
+    decodeFor(instructionToDecode, df, ISA_ALL);
+}
 
-    uint32_t aluResult;
+bool fuseInstructions(decodedFields *df, uint32_t next, uint8_t nextLength) {
+    uint8_t rd, rs1, rd2;
+    uint32_t imm20;
+    uint8_t op;
+    decodedFields second;
+
+    switch (df->microOp) {
+        case OP_LUI:
+        case OP_AUIPC:
+            rd = df->instrFields.u_type.rd;
+            rs1 = 0;
+            imm20 = df->instrFields.u_type.imm20;
+            break;
+        case OP_SLLI:
+            rd = df->instrFields.i_type.rd;
+            rs1 = df->instrFields.i_type.rs1;
+            imm20 = df->instrFields.i_type.imm12 & 0x1F;
+            break;
+        default:
+            return false;
+    }
 
-    for (;;) {
-        /* Block on signal */
-        sigwait(set, &signal);
+    /* The second instruction has to be an I-type that consumes the result of the first */
+    if (rd == 0 || INSTRUCTION_TO_RS1(next) != rd ||
+        ((next & 0x7F) != LOGICAL_I_TYPE && (next & 0x7F) != LOAD_I_TYPE && (next & 0x7F) != JALR_I_TYPE)) {
+        return false;
+    }
+    decodeInstruction(next, &second);
+    rd2 = second.instrFields.i_type.rd;
+
+    if (df->microOp == OP_LUI && second.microOp == OP_ADDI && rd2 == rd) {
+        op = OP_LUI_ADDI;
+    } else if (df->microOp == OP_AUIPC && second.microOp == OP_JALR && (rd2 == rd || rd2 == 0)) {
+        op = OP_AUIPC_JALR;
+    } else if (df->microOp == OP_AUIPC && second.microOp == OP_LW && rd2 == rd) {
+        op = OP_AUIPC_LW;
+    } else if (df->microOp == OP_SLLI && second.microOp == OP_SRLI && rd2 == rd) {
+        op = OP_SLLI_SRLI;
+    } else {
+        return false;
+    }
 
-        if (signal == SIGUSR1 && read(pipe_decode_to_execute[0], &df, sizeof(df)) && (currStage == EXECUTE) ){
-            /* Execute the command */
-            switch (df.microOp) {
-                case OP_ADD: 
-                    aluOut.result =  alu_add(regFile.generalRegisters[df.instrFields.r_type.rs1], regFile.generalRegisters[df.instrFields.r_type.rs2]);
-                    break;
-                case OP_ADDI:
-                    aluOut.result = alu_add(regFile.generalRegisters[df.instrFields.i_type.rs1], (uint32_t)df.instrFields.i_type.imm12);
-                    aluOut.rd = df.instrFields.i_type.rd;
-                    break;
-                case OP_SUB:
-                    aluResult =  alu_sub(regFile.generalRegisters[df.instrFields.r_type.rs1], regFile.generalRegisters[df.instrFields.r_type.rs2]);
-                    break;
+    df->instruction_type = FUSED_TYPE;
+    df->microOp = op;
+    df->instrFields.fused.rd = rd;
+    df->instrFields.fused.rs1 = rs1;
+    df->instrFields.fused.rd2 = rd2;
+    df->instrFields.fused.firstLength = df->length;
+    df->instrFields.fused.imm20 = imm20;
+    df->instrFields.fused.imm12 = second.instrFields.i_type.imm12;
+    df->length += nextLength;
+    return true;
+}
 
-                /* add more later*/
-                default:
-                    perror("Instruction no implimented yet");
-            }
-            
-
-        
-            /* pass the result of the alu operation */
-            write(pipe_execute_to_memAccess[1], &aluOut, sizeof(aluOut));
-            currStage = REG_WRITE_BACK;
-            pthread_kill(regWriteThreadHandle, SIGUSR1);
-        } else {//need to pass rd too evnentually truee , wait we created a struct for alu output 
-            perror("Nothing to execute yet");
-        }
+/* Decode stage */
+static void decodeStage(sim_t *sim) {
+    pipelineState *pipeline = &sim->pipeline;
+    const fetchLatch *instructionToDecode = (const fetchLatch *)pipeline->latches[FETCH];
+    decodeLatch *latch = (decodeLatch *)pipeline->latches[DECODE];
+
+#ifdef DEBUG
+    printf("Decode Thread. Instruction read %08X\n", instructionToDecode->instruction);
+#endif
+    latch->pc = instructionToDecode->pc;
+    decodeInstruction(instructionToDecode->instruction, &latch->df);
+    latch->df.length = instructionToDecode->length;
+    isaRestrict(sim->core->extensions, &latch->df);
+    if (instructionToDecode->nextLength == 4 ||
+        (instructionToDecode->nextLength == 2 && (sim->core->extensions & ISA_C))) {
+        fuseInstructions(&latch->df, instructionToDecode->next, instructionToDecode->nextLength);
     }
 }
 
-/* Memory Access Thread */
-void *memAccessThread(void *arg) {
-    sigset_t *set = (sigset_t *)arg;
-    int signal;
-    uint32_t valueFromExecute;
+/* Execute stage */
+static void executeStage(sim_t *sim) {
+    pipelineState *pipeline = &sim->pipeline;
+    const decodeLatch *latch = (const decodeLatch *)pipeline->latches[DECODE];
 
-    for (;;) {
-        /* Block on signal */
-        sigwait(set, &signal);
+    aluExecute(sim, &latch->df, latch->pc, (decoder_to_execute *)pipeline->latches[EXECUTE]);
+}
 
-        if (signal == SIGUSR1 && read(pipe_execute_to_memAccess[0], &valueFromExecute, sizeof(valueFromExecute)) && (currStage == MEM_ACCESS) ) {
-            printf("Memory Access Thread: %s\n", valueFromExecute);
-            char message[] = "Memory accessed";
-            
-            write(pipe_memAccess_to_regWrite[1], &valueFromExecute, sizeof(valueFromExecute));
-            currStage = REG_WRITE_BACK;
-            pthread_kill(regWriteThreadHandle, SIGUSR1);
+/* Memory access stage */
+static void memAccessThreadStage(sim_t *sim) {
+    pipelineState *pipeline = &sim->pipeline;
+    decoder_to_execute *valueFromExecute = (decoder_to_execute *)pipeline->latches[MEM_ACCESS];
 
-        } else {
-            perror("Nothing to access in memory yet");
-        }
-    }
+    *valueFromExecute = *(const decoder_to_execute *)pipeline->latches[EXECUTE];
+#ifdef DEBUG
+    printf("Memory Access Thread: %08X\n", valueFromExecute->memAddress);
+#endif
+    memAccessStage(sim, valueFromExecute);
 }
 
-/* Register Write Thread */
-void *regWriteThread(void *arg) {
-    sigset_t *set = (sigset_t *)arg;
-    int signal;
-    uint32_t valueFromExecute;
+/* Register write back stage, returns false once the budget is spent and pipelineRun was woken */
+static bool regWriteStage(sim_t *sim) {
+    pipelineState *pipeline = &sim->pipeline;
+    const decoder_to_execute *valueFromExecute = (const decoder_to_execute *)pipeline->latches[MEM_ACCESS];
+    retiredInstr retired;
 
-    for (;;) {
-        /* Block on signal */
-        sigwait(set, &signal);
+#ifdef DEBUG
+    printf("Register Write Thread: x%u = %08X\n", valueFromExecute->rd, valueFromExecute->result);
+#endif
+    writeBackStage(sim, valueFromExecute);
 
-        if (signal == SIGUSR1 && read(pipe_memAccess_to_regWrite[0], &valueFromExecute, sizeof(valueFromExecute)) && (currStage == REG_WRITE_BACK) ) {
-            printf("Register Write Thread: %s\n", valueFromExecute);
-            regFile.generalRegisters[aluOut.rd] = aluOut.result;
-        } else {
-            perror("Nothing to write to register yet");
-        }
+    /* CSR writes, fences and traps change what fetch may see, refetch after them */
+    if (valueFromExecute->microOp >= OP_ECALL && valueFromExecute->microOp <= OP_WFI) {
+        pipeline->fetchFlush = true;
+    }
 
-        currStage = FETCH;
-        pthread_kill(fetchThreadHandle, SIGUSR1);
+    /* The detailed model charges cycles for every instruction that leaves the pipeline */
+    makeRetiredInstr(valueFromExecute, &retired);
+    timingAccount(&sim->timing, &retired);
+
+    /* Start the next instruction or hand control back to pipelineRun, a fused pair counts twice */
+    pipeline->pipelineBudget -= valueFromExecute->firstLength != 0 ? 2 : 1;
+    if (pipeline->pipelineBudget == 0 || sim->halted) {
+        pthread_mutex_lock(&pipeline->retireLock);
+        pipeline->pipelineIdle = true;
+        pthread_cond_signal(&pipeline->retireCond);
+        pthread_mutex_unlock(&pipeline->retireLock);
+        return false;
     }
+    return true;
+}
 
+static currentStage runStage(sim_t *sim, currentStage stage) {
+    switch (stage) {
+        case FETCH:
+            fetchStage(sim);
+            return DECODE;
+        case DECODE:
+            decodeStage(sim);
+            return EXECUTE;
+        case EXECUTE:
+            executeStage(sim);
+            return MEM_ACCESS;
+        case MEM_ACCESS:
+            memAccessThreadStage(sim);
+            return REG_WRITE_BACK;
+        default:
+            return regWriteStage(sim) ? FETCH : STAGE_COUNT;
+    }
 }
 
 INSTR_TYPE get_Instr_Type(uint8_t opcode) {
     if ((opcode & MSB_8BIT) != 0){
-        printf("Invalid Instruction Type: %d", opcode);
-        exit(1);
+        return ILLEGAL_TYPE;
     }
     switch(opcode){
         case(0b0110011):
@@ -577,16 +1087,39 @@ INSTR_TYPE get_Instr_Type(uint8_t opcode) {
             return I_TYPE;
         case(0b1100111):
             return I_TYPE;
+        case(0b1110011):
+            return I_TYPE;
+        case(0b0001111):
+            return I_TYPE;
+        case(0b0101111):
+            return R_TYPE;
         case(0b0100011):
             return S_TYPE;
         case(0b1100011):
             return B_TYPE;
         case(0b0110111):
             return U_TYPE;
+        case(0b0010111):
+            return U_TYPE;
         case(0b1101111):
             return J_TYPE;
+        case(0b1010111):
+            return V_TYPE;
+        case(0b0000111):
+            return F_TYPE;
+        case(0b0100111):
+            return F_TYPE;
+        case(0b1000011):
+            return F_TYPE;
+        case(0b1000111):
+            return F_TYPE;
+        case(0b1001011):
+            return F_TYPE;
+        case(0b1001111):
+            return F_TYPE;
+        case(0b1010011):
+            return F_TYPE;
         default:
-            printf("OPCode not recognized: %d", opcode);
-            exit(1);
+            return ILLEGAL_TYPE;
     }
 }
\ No newline at end of file
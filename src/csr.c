@@ -0,0 +1,172 @@
+#include "csr.h"
+#include "controlUnit.h"
+#include "sim.h"
+
+void initCsrs(csrFile *csrs) {
+    csrs->privilege = PRIV_M;
+    csrs->mstatus = 0;
+    csrs->satp = 0;
+    csrs->mie = 0;
+    csrs->mip = 0;
+    csrs->mtvec = 0;
+    csrs->mscratch = 0;
+    csrs->mepc = 0;
+    csrs->mcause = 0;
+    csrs->mtval = 0;
+}
+
+/* Only detailed mode times every instruction. Elsewhere the totals stand still or belong to the timing
+   thread, so cycle follows simulated time like mtime */
+static uint64_t cycleCount(const sim_t *sim) {
+    return sim->mode == SIM_MODE_DETAILED ? sim->timing.totals.cycles : sim->clockNow;
+}
+
+static bool csrRead(const sim_t *sim, uint16_t csr, uint32_t *value) {
+    const csrFile *csrs = &sim->csrs;
+
+    /* The float CSRs only exist with F */
+    if (csr >= CSR_FFLAGS && csr <= CSR_FCSR && !(sim->core->extensions & ISA_F)) {
+        return false;
+    }
+
+    switch (csr) {
+        case CSR_SATP:     *value = csrs->satp; break;
+        case CSR_MSTATUS:  *value = csrs->mstatus; break;
+        case CSR_MISA:     *value = MISA_VALUE & ~(ISA_ALL & ~sim->core->extensions); break;
+        case CSR_MHARTID:  *value = 0; break;
+        case CSR_MIE:      *value = csrs->mie; break;
+        case CSR_MIP:      *value = csrs->mip; break;
+        case CSR_MTVEC:    *value = csrs->mtvec; break;
+        case CSR_MSCRATCH: *value = csrs->mscratch; break;
+        case CSR_MEPC:     *value = csrs->mepc; break;
+        case CSR_MCAUSE:   *value = csrs->mcause; break;
+        case CSR_MTVAL:    *value = csrs->mtval; break;
+        case CSR_TIME:     *value = (uint32_t)sim->clockNow; break;
+        case CSR_TIMEH:    *value = (uint32_t)(sim->clockNow >> 32); break;
+        case CSR_CYCLE:    *value = (uint32_t)cycleCount(sim); break;
+        case CSR_CYCLEH:   *value = (uint32_t)(cycleCount(sim) >> 32); break;
+        case CSR_INSTRET:  *value = (uint32_t)sim->instructionsRetired; break;
+        case CSR_INSTRETH: *value = (uint32_t)(sim->instructionsRetired >> 32); break;
+        case CSR_FFLAGS:   *value = sim->fpRegFile.fflags; break;
+        case CSR_FRM:      *value = sim->fpRegFile.frm; break;
+        case CSR_FCSR:     *value = (sim->fpRegFile.frm << 5) | sim->fpRegFile.fflags; break;
+        case CSR_VSTART:   *value = sim->vector.vstart; break;
+        case CSR_VXSAT:    *value = sim->vector.vxsat; break;
+        case CSR_VXRM:     *value = sim->vector.vxrm; break;
+        case CSR_VCSR:     *value = (sim->vector.vxrm << 1) | sim->vector.vxsat; break;
+        case CSR_VL:       *value = sim->vector.vl; break;
+        case CSR_VTYPE:    *value = sim->vector.vtype; break;
+        case CSR_VLENB:    *value = sim->vector.vlenb; break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+static bool csrWrite(sim_t *sim, uint16_t csr, uint32_t value) {
+    csrFile *csrs = &sim->csrs;
+
+    switch (csr) {
+        case CSR_SATP:
+            /* Only bare and Sv32, the ASID field is not implemented */
+            csrs->satp = value & (SATP_MODE_SV32 | SATP_PPN_MASK);
+            mmuFlush(&sim->mmu);
+            break;
+        case CSR_MSTATUS: {
+            uint32_t old = csrs->mstatus;
+            csrs->mstatus = value & (MSTATUS_MIE | MSTATUS_MPIE | MSTATUS_MPP | MSTATUS_MPRV | MSTATUS_SUM | MSTATUS_MXR);
+            /* MPP is WARL, there is no hypervisor level */
+            if (((csrs->mstatus & MSTATUS_MPP) >> MSTATUS_MPP_SHIFT) == 2) {
+                csrs->mstatus &= ~MSTATUS_MPP;
+            }
+            /* SUM and MXR were baked into the cached permissions */
+            if ((old ^ csrs->mstatus) & (MSTATUS_SUM | MSTATUS_MXR)) {
+                mmuFlush(&sim->mmu);
+            } else if ((old ^ csrs->mstatus) & (MSTATUS_MPRV | MSTATUS_MPP)) {
+                /* MPRV moves loads and stores to the MPP regime */
+                mmuUpdateMode(&sim->mmu);
+            }
+            break;
+        }
+        case CSR_MISA:
+            /* WARL, writes are ignored */
+            break;
+        case CSR_MIE:
+            csrs->mie = value & (MIP_MSIP | MIP_MTIP | MIP_MEIP);
+            break;
+        case CSR_MIP:
+            /* The machine level pending bits all belong to devices */
+            break;
+        case CSR_MTVEC:
+            /* Direct or vectored, base is 4 byte aligned */
+            csrs->mtvec = value & ~2u;
+            break;
+        case CSR_MSCRATCH:
+            csrs->mscratch = value;
+            break;
+        case CSR_MEPC:
+            csrs->mepc = value & ~1u;
+            break;
+        case CSR_MCAUSE:
+            csrs->mcause = value;
+            break;
+        case CSR_MTVAL:
+            csrs->mtval = value;
+            break;
+        case CSR_FFLAGS:
+            sim->fpRegFile.fflags = value & FFLAGS_MASK;
+            break;
+        case CSR_FRM:
+            /* Reserved modes can be written, instructions using them are illegal */
+            sim->fpRegFile.frm = value & 7;
+            break;
+        case CSR_FCSR:
+            sim->fpRegFile.fflags = value & FFLAGS_MASK;
+            sim->fpRegFile.frm = (value >> 5) & 7;
+            break;
+        case CSR_VSTART:
+            /* Only needs to hold the largest element index */
+            sim->vector.vstart = value & (VLEN_MAX - 1);
+            break;
+        case CSR_VXSAT:
+            sim->vector.vxsat = value & 1;
+            break;
+        case CSR_VXRM:
+            sim->vector.vxrm = value & 3;
+            break;
+        case CSR_VCSR:
+            sim->vector.vxsat = value & 1;
+            sim->vector.vxrm = (value >> 1) & 3;
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+bool csrAccess(sim_t *sim, uint16_t csr, uint8_t microOp, uint32_t operand, bool writes, uint32_t *oldValue) {
+    /* csr[9:8] is the lowest privilege allowed, csr[11:10] == 3 marks read only registers */
+    if (sim->csrs.privilege < ((csr >> 8) & 3)) {
+        return false;
+    }
+    if (!csrRead(sim, csr, oldValue)) {
+        return false;
+    }
+    if (!writes) {
+        return true;
+    }
+    if ((csr >> 10) == 3) {
+        return false;
+    }
+
+    switch (microOp) {
+        case OP_CSRRW:
+        case OP_CSRRWI:
+            return csrWrite(sim, csr, operand);
+        case OP_CSRRS:
+        case OP_CSRRSI:
+            return csrWrite(sim, csr, *oldValue | operand);
+        default:
+            return csrWrite(sim, csr, *oldValue & ~operand);
+    }
+}
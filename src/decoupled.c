@@ -0,0 +1,150 @@
+#include "decoupled.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "interpreter.h"
+#include "sim.h"
+
+/* Polls before giving the host CPU away while the other side catches up */
+#define RETIRE_SPINS 1024
+
+static void backOff(unsigned *spins) {
+    if (++*spins == RETIRE_SPINS) {
+        sched_yield();
+        *spins = 0;
+    }
+}
+
+/* Accounts the records of one run, returns once the run is done and every record is consumed */
+static void drainRun(sim_t *sim) {
+    retireQueue *queue = &sim->retire;
+    uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned spins = 0;
+
+    for (;;) {
+        /* done is read first, so the head read after it holds every record of the run */
+        bool done = atomic_load_explicit(&queue->done, memory_order_acquire);
+        uint64_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+        if (head == tail) {
+            if (done) {
+                return;
+            }
+            backOff(&spins);
+            continue;
+        }
+        spins = 0;
+
+        /* Hand space back to the interpreter once per batch */
+        if (head - tail > RETIRE_BATCH) {
+            head = tail + RETIRE_BATCH;
+        }
+        while (tail != head) {
+            timingAccount(&sim->timing, &queue->records[tail & (RETIRE_QUEUE_SIZE - 1)]);
+            tail++;
+        }
+        atomic_store_explicit(&queue->tail, tail, memory_order_release);
+    }
+}
+
+/* Sleeps on wake between runs rather than being created and joined for each one */
+static void *timingThreadMain(void *arg) {
+    sim_t *sim = (sim_t *)arg;
+    retireQueue *queue = &sim->retire;
+
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+        while (!queue->running && !queue->exiting) {
+            pthread_cond_wait(&queue->wake, &queue->lock);
+        }
+        if (!queue->running) {
+            break;
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        drainRun(sim);
+
+        pthread_mutex_lock(&queue->lock);
+        queue->running = false;
+        pthread_cond_broadcast(&queue->wake);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+/* The ring and the thread are set up by the first decoupled run, so other modes never pay for them */
+static bool decoupledStart(sim_t *sim) {
+    retireQueue *queue = &sim->retire;
+
+    queue->records = (retiredInstr *)malloc(RETIRE_QUEUE_SIZE * sizeof(retiredInstr));
+    if (queue->records == NULL) {
+        perror("Retire queue allocation failed");
+        return false;
+    }
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->wake, NULL);
+    queue->running = false;
+    queue->exiting = false;
+    if (pthread_create(&queue->thread, NULL, timingThreadMain, sim) != 0) {
+        perror("Timing thread creation failed");
+        pthread_mutex_destroy(&queue->lock);
+        pthread_cond_destroy(&queue->wake);
+        free(queue->records);
+        queue->records = NULL;
+        return false;
+    }
+    queue->started = true;
+    return true;
+}
+
+void retireWaitForSpace(retireQueue *queue) {
+    uint64_t head = queue->producerHead;
+    unsigned spins = 0;
+
+    atomic_store_explicit(&queue->head, head, memory_order_release);
+    while (head - (queue->producerTail = atomic_load_explicit(&queue->tail, memory_order_acquire)) ==
+           RETIRE_QUEUE_SIZE) {
+        backOff(&spins);
+    }
+}
+
+void runDecoupled(sim_t *sim, uint64_t n) {
+    retireQueue *queue = &sim->retire;
+
+    if (!queue->started && !decoupledStart(sim)) {
+        return;
+    }
+    queue->producerHead = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    queue->producerTail = queue->producerHead;
+    atomic_store_explicit(&queue->done, false, memory_order_relaxed);
+    pthread_mutex_lock(&queue->lock);
+    queue->running = true;
+    pthread_cond_broadcast(&queue->wake);
+    pthread_mutex_unlock(&queue->lock);
+
+    /* The core's interpreter loop pushes one record per retired instruction */
+    interpRun(sim, n, INTERP_RETIRE, NO_STOP_PC);
+
+    atomic_store_explicit(&queue->head, queue->producerHead, memory_order_release);
+    atomic_store_explicit(&queue->done, true, memory_order_release);
+    pthread_mutex_lock(&queue->lock);
+    while (queue->running) {
+        pthread_cond_wait(&queue->wake, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void decoupledCleanup(retireQueue *queue) {
+    if (queue->started) {
+        pthread_mutex_lock(&queue->lock);
+        queue->exiting = true;
+        pthread_cond_broadcast(&queue->wake);
+        pthread_mutex_unlock(&queue->lock);
+        pthread_join(queue->thread, NULL);
+        pthread_mutex_destroy(&queue->lock);
+        pthread_cond_destroy(&queue->wake);
+        queue->started = false;
+    }
+    free(queue->records);
+    queue->records = NULL;
+}
@@ -0,0 +1,108 @@
+#include "eventQueue.h"
+#include <stddef.h>
+
+#define SLOT(when) ((when) & (EVENT_WHEEL_SLOTS - 1))
+
+void eventQueueInit(eventQueue *queue) {
+    for (int i = 0; i < EVENT_WHEEL_SLOTS; i++) {
+        queue->wheel[i] = NULL;
+    }
+    queue->pending = 0;
+    queue->foregroundPending = 0;
+    queue->nextDue = NO_EVENT;
+}
+
+/* Events more than one rotation away share slots with closer ones, so the first slot that holds
+   an event inside the next rotation is the earliest. Only if there is none is every event checked */
+static void updateNextDue(eventQueue *queue, uint64_t from) {
+    uint64_t earliest = NO_EVENT;
+
+    if (queue->pending == 0) {
+        queue->nextDue = NO_EVENT;
+        return;
+    }
+    for (uint64_t when = from; when < from + EVENT_WHEEL_SLOTS; when++) {
+        for (simEvent *ev = queue->wheel[SLOT(when)]; ev != NULL; ev = ev->next) {
+            if (ev->when == when) {
+                queue->nextDue = when;
+                return;
+            }
+        }
+    }
+    for (int i = 0; i < EVENT_WHEEL_SLOTS; i++) {
+        for (simEvent *ev = queue->wheel[i]; ev != NULL; ev = ev->next) {
+            if (ev->when < earliest) {
+                earliest = ev->when;
+            }
+        }
+    }
+    queue->nextDue = earliest;
+}
+
+static void unlink(eventQueue *queue, simEvent *ev) {
+    simEvent **link = &queue->wheel[SLOT(ev->when)];
+    while (*link != ev) {
+        link = &(*link)->next;
+    }
+    *link = ev->next;
+    ev->next = NULL;
+    ev->scheduled = false;
+    queue->pending--;
+    queue->foregroundPending -= !ev->background;
+}
+
+void eventSchedule(eventQueue *queue, simEvent *ev, uint64_t when) {
+    if (ev->scheduled) {
+        eventCancel(queue, ev);
+    }
+    ev->when = when;
+    ev->scheduled = true;
+    ev->next = queue->wheel[SLOT(when)];
+    queue->wheel[SLOT(when)] = ev;
+    queue->pending++;
+    queue->foregroundPending += !ev->background;
+    if (when < queue->nextDue) {
+        queue->nextDue = when;
+    }
+}
+
+void eventCancel(eventQueue *queue, simEvent *ev) {
+    if (!ev->scheduled) {
+        return;
+    }
+    unlink(queue, ev);
+    if (ev->when == queue->nextDue) {
+        updateNextDue(queue, ev->when);
+    }
+}
+
+void eventRunDue(eventQueue *queue, uint64_t now) {
+    while (queue->pending != 0 && queue->nextDue <= now) {
+        uint64_t due = queue->nextDue;
+        simEvent *fired = NULL;
+        simEvent **link = &queue->wheel[SLOT(due)];
+
+        /* Detach everything due from this slot first, callbacks are free to reschedule */
+        while (*link != NULL) {
+            simEvent *ev = *link;
+            if (ev->when <= now) {
+                *link = ev->next;
+                ev->scheduled = false;
+                ev->next = fired;
+                fired = ev;
+                queue->pending--;
+                queue->foregroundPending -= !ev->background;
+            } else {
+                link = &ev->next;
+            }
+        }
+        updateNextDue(queue, due + 1);
+
+        while (fired != NULL) {
+            simEvent *ev = fired;
+            fired = ev->next;
+            ev->next = NULL;
+            ev->callback(ev->arg);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#include "fetch.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include "compressed.h"
+#include "sim.h"
+
+/* Expansion of every 16 bit parcel, 32 bit encodings are left as 0 and never looked up */
+static uint32_t expansionTable[1 << 16];
+static pthread_once_t expansionOnce = PTHREAD_ONCE_INIT;
+
+static void buildExpansionTable(void) {
+    for (uint32_t parcel = 0; parcel < (1u << 16); parcel++) {
+        if (IS_COMPRESSED(parcel)) {
+            expansionTable[parcel] = expandCompressed((uint16_t)parcel);
+        }
+    }
+}
+
+void fetchInit(void) {
+    pthread_once(&expansionOnce, buildExpansionTable);
+}
+
+uint32_t fetchParcel(sim_t *sim, uint32_t pc, uint8_t *length) {
+    mmuState *mmu = &sim->mmu;
+    uint32_t parcel = 0;
+
+    /* Aligned pcs read the whole word at once, it holds either one instruction or a compressed one */
+    if ((pc & 3) == 0) {
+        if (!mmuFetch(mmu, pc, 4, &parcel)) {
+            *length = 0;
+            return 0;
+        }
+    } else if (!mmuFetch(mmu, pc, 2, &parcel)) {
+        *length = 0;
+        return 0;
+    }
+
+    if (IS_COMPRESSED(parcel)) {
+        *length = 2;
+        return expansionTable[(uint16_t)parcel];
+    }
+
+    *length = 4;
+    if ((pc & 3) != 0 && !mmuFetch(mmu, pc, 4, &parcel)) {
+        *length = 0;
+        return 0;
+    }
+    return parcel;
+}
@@ -0,0 +1,461 @@
+#include "fpu.h"
+#include <fenv.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include "sim.h"
+
+/* The double block of micro ops repeats the single one, a double op minus this is its single twin */
+#define DOUBLE_OP_OFFSET (OP_FMADD_D - OP_FMADD_S)
+
+#define SIGN_S (1ull << 31)
+#define SIGN_D (1ull << 63)
+
+/* Operands are read from the register file and results written through out, this keeps the host
+   arithmetic between the rounding mode switch and the flag read-back */
+#define FP_BARRIER() __asm__ volatile("" ::: "memory")
+
+#if defined(__SSE_MATH__)
+#include <xmmintrin.h>
+
+/* Float math runs on SSE, so MXCSR is the whole host environment. Reading it directly is a single
+   instruction, fenv would also save and restore the x87 state on every call */
+#define HOST_NX _MM_EXCEPT_INEXACT
+#define HOST_UF _MM_EXCEPT_UNDERFLOW
+#define HOST_OF _MM_EXCEPT_OVERFLOW
+#define HOST_DZ _MM_EXCEPT_DIV_ZERO
+#define HOST_NV _MM_EXCEPT_INVALID
+
+/* Host rounding modes by rm, RMM has no host equivalent and goes through tiesAway instead */
+static const uint32_t hostRounding[RM_RUP + 1] = {
+    _MM_ROUND_NEAREST, _MM_ROUND_TOWARD_ZERO, _MM_ROUND_DOWN, _MM_ROUND_UP
+};
+
+static inline uint32_t hostGetFlags(void) { return _MM_GET_EXCEPTION_STATE(); }
+static inline void hostClearFlags(uint32_t flags) { _mm_setcsr(_mm_getcsr() & ~flags); }
+static inline uint32_t hostGetRounding(void) { return _MM_GET_ROUNDING_MODE(); }
+static inline void hostSetRounding(uint32_t mode) { _MM_SET_ROUNDING_MODE(mode); }
+#else
+#define HOST_NX FE_INEXACT
+#define HOST_UF FE_UNDERFLOW
+#define HOST_OF FE_OVERFLOW
+#define HOST_DZ FE_DIVBYZERO
+#define HOST_NV FE_INVALID
+
+/* Host rounding modes by rm, RMM has no host equivalent and goes through tiesAway instead */
+static const uint32_t hostRounding[RM_RUP + 1] = { FE_TONEAREST, FE_TOWARDZERO, FE_DOWNWARD, FE_UPWARD };
+
+static inline uint32_t hostGetFlags(void) { return (uint32_t)fetestexcept(FE_ALL_EXCEPT); }
+static inline void hostClearFlags(uint32_t flags) { feclearexcept((int)flags); }
+static inline uint32_t hostGetRounding(void) { return (uint32_t)fegetround(); }
+static inline void hostSetRounding(uint32_t mode) { fesetround((int)mode); }
+#endif
+
+static inline uint32_t toHostFlags(uint32_t fflags) {
+    return (fflags & FFLAG_NX ? HOST_NX : 0) | (fflags & FFLAG_UF ? HOST_UF : 0) | (fflags & FFLAG_OF ? HOST_OF : 0) |
+           (fflags & FFLAG_DZ ? HOST_DZ : 0) | (fflags & FFLAG_NV ? HOST_NV : 0);
+}
+
+static inline uint8_t toGuestFlags(uint32_t host) {
+    return (uint8_t)((host & HOST_NX ? FFLAG_NX : 0) | (host & HOST_UF ? FFLAG_UF : 0) | (host & HOST_OF ? FFLAG_OF : 0) |
+                     (host & HOST_DZ ? FFLAG_DZ : 0) | (host & HOST_NV ? FFLAG_NV : 0));
+}
+
+/*
+ * Host flags are left sticky, like fflags. One is only cleared when fflags does not hold it yet, so
+ * a stale flag never reaches the guest, and a run of round to nearest operations writes no host
+ * state at all. Returns the host rounding mode to put back.
+ */
+static inline uint32_t roundingEnter(uint32_t rm, uint32_t fflags) {
+    uint32_t stale = hostGetFlags() & ~toHostFlags(fflags);
+    uint32_t previous = hostGetRounding();
+    if (stale != 0) {
+        hostClearFlags(stale);
+    }
+    if (previous != hostRounding[rm]) {
+        hostSetRounding(hostRounding[rm]);
+    }
+    FP_BARRIER();
+    return previous;
+}
+
+static inline uint8_t roundingLeave(uint32_t rm, uint32_t previous) {
+    FP_BARRIER();
+    uint32_t raised = hostGetFlags();
+    if (previous != hostRounding[rm]) {
+        hostSetRounding(previous);
+    }
+    return toGuestFlags(raised);
+}
+
+void initFpRegFile(fpRegisterFile *fpRegFile) {
+    memset(fpRegFile->regs, 0, sizeof(fpRegFile->regs));
+    fpRegFile->fflags = 0;
+    fpRegFile->frm = RM_RNE;
+}
+
+//==========================================Register formats===============================================
+/* Low half of a valid NaN box, the canonical NaN otherwise */
+static inline uint32_t singleBits(uint64_t reg) {
+    return (reg & NAN_BOX) == NAN_BOX ? (uint32_t)reg : CANONICAL_NAN_S;
+}
+
+static inline float unboxSingle(uint64_t reg) {
+    uint32_t bits = singleBits(reg);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline double asDouble(uint64_t reg) {
+    double value;
+    memcpy(&value, &reg, sizeof(value));
+    return value;
+}
+
+static inline uint64_t boxSingle(float value) {
+    uint32_t bits = CANONICAL_NAN_S;
+    if (!isnan(value)) {
+        memcpy(&bits, &value, sizeof(bits));
+    }
+    return NAN_BOX | bits;
+}
+
+static inline uint64_t fromDouble(double value) {
+    uint64_t bits = CANONICAL_NAN_D;
+    if (!isnan(value)) {
+        memcpy(&bits, &value, sizeof(bits));
+    }
+    return bits;
+}
+
+static bool isSignalingNan(uint64_t reg, bool isDouble) {
+    if (isDouble) {
+        return (reg & 0x7FF8000000000000ull) == 0x7FF0000000000000ull && (reg & 0x000FFFFFFFFFFFFFull) != 0;
+    }
+    uint32_t bits = singleBits(reg);
+    return (bits & 0x7FC00000u) == 0x7F800000u && (bits & 0x003FFFFFu) != 0;
+}
+//=========================================================================================================
+
+/*
+ * RMM: the operation runs in long double towards zero, then tiesAway picks between the truncated
+ * result and its neighbour away from zero in the target format. Their midpoint needs one bit more
+ * than the target and long double has at least two more, so comparing the truncated wide result
+ * with it is exact, and a result that truncates to the midpoint was at or above it. Hosts whose long
+ * double is no wider than double treat RMM as reserved for the operations that round.
+ */
+#define WIDE_RMM (LDBL_MANT_DIG >= DBL_MANT_DIG + 2)
+
+/* Saves the host environment and truncates with no flags pending until it is put back. The long
+   double math may run on a different unit than float and double, fenv covers both */
+static inline void wideEnter(fenv_t *saved) {
+    fegetenv(saved);
+    feclearexcept(FE_ALL_EXCEPT);
+    fesetround(FE_TOWARDZERO);
+    FP_BARRIER();
+}
+
+/* Invalid and divide by zero from the wide operation, whether it truncated goes to inexact */
+static inline uint8_t wideFlags(bool *inexact) {
+    FP_BARRIER();
+    int raised = fetestexcept(FE_INVALID | FE_DIVBYZERO | FE_INEXACT);
+    *inexact = (raised & FE_INEXACT) != 0;
+    return (uint8_t)((raised & FE_INVALID ? FFLAG_NV : 0) | (raised & FE_DIVBYZERO ? FFLAG_DZ : 0));
+}
+
+/* Inexact, overflow and underflow (tiny after rounding) for a finite, nonzero wide result */
+static inline uint8_t tiesAwayFlags(bool inexact, bool overflow, bool tiny) {
+    if (!inexact) {
+        return 0;
+    }
+    return (uint8_t)(FFLAG_NX | (overflow ? FFLAG_OF : 0) | (tiny ? FFLAG_UF : 0));
+}
+
+/* Run with the host still truncating, so the casts give the neighbour towards zero */
+static uint64_t tiesAwaySingle(long double wide, bool inexact, uint8_t *flags) {
+    if (isnan(wide) || isinf(wide) || wide == 0.0L) {
+        return boxSingle((float)wide);
+    }
+    float low = (float)wide;
+    float high = nextafterf(low, copysignf(INFINITY, low));
+    long double mid = isinf(high) ? (long double)FLT_MAX + 0x1p103L : ((long double)low + high) / 2;
+    float rounded = fabsl(wide) >= fabsl(mid) ? high : low;
+    *flags |= tiesAwayFlags(inexact || (long double)low != wide, isinf(rounded),
+                            fabsl(wide) < (long double)FLT_MIN * (1.0L - 0x1p-25L));
+    return boxSingle(rounded);
+}
+
+static uint64_t tiesAwayDouble(long double wide, bool inexact, uint8_t *flags) {
+    if (isnan(wide) || isinf(wide) || wide == 0.0L) {
+        return fromDouble((double)wide);
+    }
+    double low = (double)wide;
+    double high = nextafter(low, copysign(INFINITY, low));
+    long double mid = isinf(high) ? (long double)DBL_MAX + 0x1p970L : ((long double)low + high) / 2;
+    double rounded = fabsl(wide) >= fabsl(mid) ? high : low;
+    *flags |= tiesAwayFlags(inexact || (long double)low != wide, isinf(rounded),
+                            fabsl(wide) < (long double)DBL_MIN * (1.0L - 0x1p-54L));
+    return fromDouble(rounded);
+}
+
+static void raiseIllegal(sim_t *sim, decoder_to_execute *out) {
+    out->exception = true;
+    out->cause = CAUSE_ILLEGAL_INSTRUCTION;
+    out->tval = sim->regFile.instructionRegister;
+    out->writesRd = false;
+    out->writesFd = false;
+}
+
+/* Every op with an rm field, including the ones that never round */
+static inline bool usesRounding(uint8_t op) {
+    return (op >= OP_FMADD_S && op <= OP_FSQRT_S) || op == OP_FCVT_W_S || op == OP_FCVT_WU_S ||
+           op == OP_FCVT_S_W || op == OP_FCVT_S_WU || op == OP_FCVT_S_D || op == OP_FCVT_D_S;
+}
+
+/* Conversion to a word, saturating with NV on NaN and out of range values */
+static uint32_t toInteger(double value, uint32_t rm, bool isUnsigned, uint8_t *flags) {
+    double rounded;
+
+    if (isnan(value)) {
+        *flags |= FFLAG_NV;
+        return isUnsigned ? UINT32_MAX : INT32_MAX;
+    }
+    switch (rm) {
+        case RM_RTZ: rounded = trunc(value); break;
+        case RM_RDN: rounded = floor(value); break;
+        case RM_RUP: rounded = ceil(value); break;
+        case RM_RMM: rounded = round(value); break;
+        default:     rounded = nearbyint(value); break;   /* Hosts run with round to nearest even */
+    }
+    if (isUnsigned ? (rounded < 0.0 || rounded > 4294967295.0) : (rounded < -2147483648.0 || rounded > 2147483647.0)) {
+        *flags |= FFLAG_NV;
+        if (isUnsigned) {
+            return value < 0.0 ? 0 : UINT32_MAX;
+        }
+        return value < 0.0 ? (uint32_t)INT32_MIN : (uint32_t)INT32_MAX;
+    }
+    if (rounded != value) {
+        *flags |= FFLAG_NX;
+    }
+    return isUnsigned ? (uint32_t)rounded : (uint32_t)(int32_t)rounded;
+}
+
+/* fmin/fmax on exactly widened values, returns the bits of the winner so -0.0 < +0.0 holds */
+static uint64_t minMax(bool max, double a, double b, uint64_t aBits, uint64_t bBits, uint64_t canonicalNan) {
+    if (isnan(a) && isnan(b)) {
+        return canonicalNan;
+    }
+    if (isnan(a)) {
+        return bBits;
+    }
+    if (isnan(b)) {
+        return aBits;
+    }
+    if (a == b) {
+        return (signbit(a) != 0) == max ? bBits : aBits;
+    }
+    return (a < b) != max ? aBits : bBits;
+}
+
+static uint32_t classify(int fpClass, bool negative, bool signaling) {
+    switch (fpClass) {
+        case FP_INFINITE:  return negative ? 1u << 0 : 1u << 7;
+        case FP_NORMAL:    return negative ? 1u << 1 : 1u << 6;
+        case FP_SUBNORMAL: return negative ? 1u << 2 : 1u << 5;
+        case FP_ZERO:      return negative ? 1u << 3 : 1u << 4;
+        default:           return signaling ? 1u << 8 : 1u << 9;
+    }
+}
+
+void floatExecute(sim_t *sim, const decodedFields *df, decoder_to_execute *out) {
+    fpRegisterFile *fp = &sim->fpRegFile;
+    const uint64_t *f = fp->regs;
+    const uint32_t *x = sim->regFile.generalRegisters;
+    uint8_t op = df->microOp;
+    uint8_t rs1 = df->instrFields.f_type.rs1;
+    uint8_t rs2 = df->instrFields.f_type.rs2;
+    uint8_t rs3 = df->instrFields.f_type.rs3;
+    bool isDouble = op >= OP_FMADD_D && op <= OP_FCVT_D_WU;
+    uint8_t generic = isDouble ? (uint8_t)(op - DOUBLE_OP_OFFSET) : op;
+    uint32_t rm = RM_RNE;
+    uint8_t flags = 0;
+
+    out->rd = df->instrFields.f_type.rd;
+    out->writesRd = false;
+
+    if (isFloatMemoryOp(op)) {
+        out->rs1 = rs1;
+        out->memAddress = x[rs1] + (uint32_t)SIGN_EXTEND(df->instrFields.f_type.imm12, 12);
+        if (op == OP_FSW || op == OP_FSD) {
+            out->fpResult = f[rs2];
+        } else {
+            out->writesFd = true;
+        }
+        return;
+    }
+    if (usesRounding(generic)) {
+        rm = df->instrFields.f_type.rm == RM_DYN ? fp->frm : df->instrFields.f_type.rm;
+        if (rm > RM_RMM || (rm == RM_RMM && !WIDE_RMM)) {
+            raiseIllegal(sim, out);
+            return;
+        }
+    }
+
+#define FS(reg) unboxSingle(f[reg])
+#define FD(reg) asDouble(f[reg])
+#define FL(reg) (isDouble ? (long double)FD(reg) : (long double)FS(reg))
+/* EXPR in the target format, WIDE the same operation in long double for RMM */
+#define TIES_AWAY(ROUND, WIDE) do { fenv_t env_; bool inexact_; wideEnter(&env_); \
+                                    volatile long double wide_ = (WIDE); flags |= wideFlags(&inexact_); \
+                                    out->fpResult = ROUND(wide_, inexact_, &flags); fesetenv(&env_); } while (0)
+#define ROUNDED_S(EXPR, WIDE) do { if (rm == RM_RMM) { TIES_AWAY(tiesAwaySingle, WIDE); } else { \
+                                   uint32_t host_ = roundingEnter(rm, fp->fflags); out->fpResult = boxSingle(EXPR); \
+                                   flags |= roundingLeave(rm, host_); } } while (0)
+#define ROUNDED_D(EXPR, WIDE) do { if (rm == RM_RMM) { TIES_AWAY(tiesAwayDouble, WIDE); } else { \
+                                   uint32_t host_ = roundingEnter(rm, fp->fflags); out->fpResult = fromDouble(EXPR); \
+                                   flags |= roundingLeave(rm, host_); } } while (0)
+#define ROUNDED(SINGLE, DOUBLE, WIDE) do { if (isDouble) ROUNDED_D(DOUBLE, WIDE); else ROUNDED_S(SINGLE, WIDE); } while (0)
+
+    out->writesFd = true;
+    switch (generic) {
+        case OP_FADD_S:   ROUNDED(FS(rs1) + FS(rs2), FD(rs1) + FD(rs2), FL(rs1) + FL(rs2)); break;
+        case OP_FSUB_S:   ROUNDED(FS(rs1) - FS(rs2), FD(rs1) - FD(rs2), FL(rs1) - FL(rs2)); break;
+        case OP_FMUL_S:   ROUNDED(FS(rs1) * FS(rs2), FD(rs1) * FD(rs2), FL(rs1) * FL(rs2)); break;
+        case OP_FDIV_S:   ROUNDED(FS(rs1) / FS(rs2), FD(rs1) / FD(rs2), FL(rs1) / FL(rs2)); break;
+        case OP_FSQRT_S:  ROUNDED(sqrtf(FS(rs1)), sqrt(FD(rs1)), sqrtl(FL(rs1))); break;
+
+        /* Negating a product or an addend is exact, so each of these is still a single rounding */
+        case OP_FMADD_S:
+        case OP_FMSUB_S:
+        case OP_FNMSUB_S:
+        case OP_FNMADD_S: {
+            bool negateProduct = generic == OP_FNMSUB_S || generic == OP_FNMADD_S;
+            bool negateAddend = generic == OP_FMSUB_S || generic == OP_FNMADD_S;
+            if (negateProduct && negateAddend) {
+                ROUNDED(fmaf(-FS(rs1), FS(rs2), -FS(rs3)), fma(-FD(rs1), FD(rs2), -FD(rs3)),
+                        fmal(-FL(rs1), FL(rs2), -FL(rs3)));
+            } else if (negateProduct) {
+                ROUNDED(fmaf(-FS(rs1), FS(rs2), FS(rs3)), fma(-FD(rs1), FD(rs2), FD(rs3)),
+                        fmal(-FL(rs1), FL(rs2), FL(rs3)));
+            } else if (negateAddend) {
+                ROUNDED(fmaf(FS(rs1), FS(rs2), -FS(rs3)), fma(FD(rs1), FD(rs2), -FD(rs3)),
+                        fmal(FL(rs1), FL(rs2), -FL(rs3)));
+            } else {
+                ROUNDED(fmaf(FS(rs1), FS(rs2), FS(rs3)), fma(FD(rs1), FD(rs2), FD(rs3)),
+                        fmal(FL(rs1), FL(rs2), FL(rs3)));
+            }
+            /* Infinity times zero is invalid even when the addend is a quiet NaN */
+            double a = isDouble ? FD(rs1) : FS(rs1);
+            double b = isDouble ? FD(rs2) : FS(rs2);
+            if ((isinf(a) && b == 0.0) || (a == 0.0 && isinf(b))) {
+                flags |= FFLAG_NV;
+            }
+            break;
+        }
+
+        case OP_FSGNJ_S:
+        case OP_FSGNJN_S:
+        case OP_FSGNJX_S: {
+            uint64_t signMask = isDouble ? SIGN_D : SIGN_S;
+            uint64_t a = isDouble ? f[rs1] : NAN_BOX | singleBits(f[rs1]);
+            uint64_t b = isDouble ? f[rs2] : NAN_BOX | singleBits(f[rs2]);
+            uint64_t sign = generic == OP_FSGNJ_S ? b : generic == OP_FSGNJN_S ? ~b : a ^ b;
+            out->fpResult = (a & ~signMask) | (sign & signMask);
+            break;
+        }
+
+        case OP_FMIN_S:
+        case OP_FMAX_S:
+            if (isDouble) {
+                out->fpResult = minMax(generic == OP_FMAX_S, FD(rs1), FD(rs2), f[rs1], f[rs2], CANONICAL_NAN_D);
+            } else {
+                out->fpResult = minMax(generic == OP_FMAX_S, FS(rs1), FS(rs2), NAN_BOX | singleBits(f[rs1]),
+                                       NAN_BOX | singleBits(f[rs2]), NAN_BOX | CANONICAL_NAN_S);
+            }
+            if (isSignalingNan(f[rs1], isDouble) || isSignalingNan(f[rs2], isDouble)) {
+                flags |= FFLAG_NV;
+            }
+            break;
+
+        case OP_FCVT_S_W:
+            out->rs1 = rs1;
+            ROUNDED((float)(int32_t)x[rs1], (double)(int32_t)x[rs1], (long double)(int32_t)x[rs1]);
+            break;
+        case OP_FCVT_S_WU:
+            out->rs1 = rs1;
+            ROUNDED((float)x[rs1], (double)x[rs1], (long double)x[rs1]);
+            break;
+        case OP_FCVT_S_D:
+            ROUNDED_S((float)FD(rs1), (long double)FD(rs1));
+            break;
+        case OP_FCVT_D_S:
+            ROUNDED_D((double)FS(rs1), (long double)FS(rs1));
+            break;
+        case OP_FMV_W_X:
+            out->rs1 = rs1;
+            out->fpResult = NAN_BOX | x[rs1];
+            break;
+
+        /* The rest write an integer register */
+        case OP_FCVT_W_S:
+        case OP_FCVT_WU_S:
+            out->writesFd = false;
+            out->writesRd = true;
+            out->result = toInteger(isDouble ? FD(rs1) : FS(rs1), rm, generic == OP_FCVT_WU_S, &flags);
+            break;
+
+        case OP_FEQ_S:
+        case OP_FLT_S:
+        case OP_FLE_S: {
+            double a = isDouble ? FD(rs1) : FS(rs1);
+            double b = isDouble ? FD(rs2) : FS(rs2);
+            out->writesFd = false;
+            out->writesRd = true;
+            if (generic == OP_FEQ_S) {
+                /* Quiet compare, only signaling NaNs are invalid */
+                out->result = a == b;
+                if (isSignalingNan(f[rs1], isDouble) || isSignalingNan(f[rs2], isDouble)) {
+                    flags |= FFLAG_NV;
+                }
+            } else {
+                out->result = generic == OP_FLT_S ? isless(a, b) : islessequal(a, b);
+                if (isnan(a) || isnan(b)) {
+                    flags |= FFLAG_NV;
+                }
+            }
+            break;
+        }
+
+        case OP_FCLASS_S:
+            out->writesFd = false;
+            out->writesRd = true;
+            if (isDouble) {
+                out->result = classify(fpclassify(FD(rs1)), signbit(FD(rs1)) != 0, isSignalingNan(f[rs1], true));
+            } else {
+                out->result = classify(fpclassify(FS(rs1)), signbit(FS(rs1)) != 0, isSignalingNan(f[rs1], false));
+            }
+            break;
+
+        case OP_FMV_X_W:
+            /* Raw bits, no NaN box check */
+            out->writesFd = false;
+            out->writesRd = true;
+            out->result = (uint32_t)f[rs1];
+            break;
+
+        default:
+            raiseIllegal(sim, out);
+            return;
+    }
+
+#undef FS
+#undef FD
+#undef FL
+#undef TIES_AWAY
+#undef ROUNDED_S
+#undef ROUNDED_D
+#undef ROUNDED
+
+    out->fpFlags = flags;
+}
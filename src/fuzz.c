@@ -0,0 +1,140 @@
+#include "fuzz.h"
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+#include "interpreter.h"
+#include "mmu.h"
+
+typedef enum {
+    STOP_MARKER,   /* Retired FUZZ_MARKER_INPUT, or FUZZ_MARKER_DONE once an input is running */
+    STOP_HALTED,
+    STOP_BUDGET
+} stopReason;
+
+/* The core's interpreter loop does the coverage and marker checks */
+static stopReason runUntilMarker(sim_t *sim, uint64_t n, bool inputRunning) {
+    uint64_t executed;
+
+    if (sim->halted) {
+        return STOP_HALTED;
+    }
+    sim->fuzz.inputRunning = inputRunning;
+    executed = interpRun(sim, n, INTERP_FUZZ, NO_STOP_PC);
+    if (sim->halted) {
+        return STOP_HALTED;
+    }
+    /* The register still holds the instruction that just retired */
+    if (executed != 0 && (sim->regFile.instructionRegister == FUZZ_MARKER_INPUT ||
+                          (inputRunning && sim->regFile.instructionRegister == FUZZ_MARKER_DONE))) {
+        return STOP_MARKER;
+    }
+    return STOP_BUDGET;
+}
+
+static void takeSnapshot(sim_t *sim) {
+    fuzzSnapshot *s = &sim->fuzz.snapshot;
+    s->pc = sim->regFile.programCounter;
+    memcpy(s->x, sim->regFile.generalRegisters, sizeof(s->x));
+    s->fp = sim->fpRegFile;
+    s->csrs = sim->csrs;
+    s->vector = sim->vector;
+    s->reservationAddress = sim->reservationAddress;
+    s->reservationValid = sim->reservationValid;
+    s->clint = sim->clint;
+    s->statsEvent = sim->stats.event;
+    s->events = sim->events;
+    s->clockNow = sim->clockNow;
+    s->instructionsRetired = sim->instructionsRetired;
+    s->wfiSkippedCycles = sim->wfiSkippedCycles;
+}
+
+/* The event wheel links the device events by address, restoring the queue and those events
+   together brings back the exact schedule */
+static void restoreSnapshot(sim_t *sim) {
+    const fuzzSnapshot *s = &sim->fuzz.snapshot;
+    ramRestore(&sim->mainMemory);
+    sim->regFile.programCounter = s->pc;
+    memcpy(sim->regFile.generalRegisters, s->x, sizeof(s->x));
+    sim->fpRegFile = s->fp;
+    sim->csrs = s->csrs;
+    sim->vector = s->vector;
+    sim->reservationAddress = s->reservationAddress;
+    sim->reservationValid = s->reservationValid;
+    sim->clint = s->clint;
+    sim->stats.event = s->statsEvent;
+    sim->events = s->events;
+    sim->clockNow = s->clockNow;
+    sim->instructionsRetired = s->instructionsRetired;
+    sim->wfiSkippedCycles = s->wfiSkippedCycles;
+    sim->halted = false;
+    sim->crashed = false;
+    sim->exitCode = 0;
+
+    /* Also re-arms dirty tracking, which only sees pages as they enter a store TLB */
+    mmuFlushAll(&sim->mmu);
+}
+
+/* Goes through the MMU like a guest store so the pages are tracked, stops at the first fault */
+static uint32_t copyToGuest(sim_t *sim, uint32_t address, const uint8_t *data, uint32_t bytes) {
+    uint32_t done = 0;
+    while (done < bytes) {
+        uint32_t chunk = PAGE_SIZE - ((address + done) & (PAGE_SIZE - 1));
+        if (chunk > bytes - done) {
+            chunk = bytes - done;
+        }
+        uint8_t *host = mmuHostSpan(&sim->mmu, address + done, chunk, ACCESS_STORE);
+        if (host != NULL) {
+            memcpy(host, data + done, chunk);
+            done += chunk;
+        } else if (mmuStore(&sim->mmu, address + done, 1, data[done])) {
+            done++;
+        } else {
+            break;
+        }
+    }
+    return done;
+}
+
+bool fuzzStart(sim_t *sim, uint8_t *coverage, uint64_t maxInstructions) {
+    fuzzState *fuzz = &sim->fuzz;
+
+    fuzz->coverage = NULL;
+    fuzz->ready = false;
+    if (sim->disk.ram != NULL) {
+        fprintf(stderr, "Fuzzing needs a machine without a block device, its writes cannot be rolled back\n");
+        return false;
+    }
+    if (runUntilMarker(sim, maxInstructions, false) != STOP_MARKER || !ramSnapshot(&sim->mainMemory)) {
+        return false;
+    }
+    takeSnapshot(sim);
+    mmuFlushAll(&sim->mmu);
+    fuzz->coverage = coverage;
+    fuzz->ready = true;
+    return true;
+}
+
+sim_fuzz_result fuzzRun(sim_t *sim, const void *input, size_t bytes, uint64_t maxInstructions) {
+    fuzzState *fuzz = &sim->fuzz;
+    uint32_t *x = sim->regFile.generalRegisters;
+
+    if (!fuzz->ready) {
+        return SIM_FUZZ_CRASH;
+    }
+    restoreSnapshot(sim);
+
+    /* Buffer in a0, capacity in a1, the length delivered goes back in a0 */
+    uint32_t length = bytes < x[11] ? (uint32_t)bytes : x[11];
+    x[10] = copyToGuest(sim, x[10], (const uint8_t *)input, length);
+    fuzz->prevLocation = 0;
+
+    stopReason reason = runUntilMarker(sim, maxInstructions, true);
+    if (sim->mainMemory.snapshotLost) {
+        fuzz->ready = false;
+        return SIM_FUZZ_ERROR;
+    }
+    if (sim->crashed) {
+        return SIM_FUZZ_CRASH;
+    }
+    return reason == STOP_BUDGET ? SIM_FUZZ_TIMEOUT : SIM_FUZZ_OK;
+}
@@ -0,0 +1,232 @@
+#include "interpreter.h"
+#include "memAccess.h"
+#include "writeBack.h"
+#include <stdio.h>
+#include "controlUnit.h"
+#include "sim.h"
+#include "fetch.h"
+#include "clock.h"
+#include "trap.h"
+#include "vector.h"
+#include "fpu.h"
+
+/* Linux syscall numbers used by newlib style guests */
+#define SYSCALL_WRITE 64
+#define SYSCALL_EXIT 93
+
+static void haltOnFault(sim_t *sim, uint32_t cause, uint32_t pc, uint32_t address) {
+    printf("Exception %u at pc %08X, address %08X\n", cause, pc, address);
+    sim->exitCode = -1;
+    sim->crashed = true;
+    sim->halted = true;
+}
+
+bool atomicAccess(sim_t *sim, decoder_to_execute *ex) {
+    mmuState *mmu = &sim->mmu;
+    uint32_t loaded;
+    uint32_t stored = ex->storeData;
+    bool ok = true;
+
+    switch (ex->microOp) {
+        case OP_LRW:
+            ok = mmuLoad(mmu, ex->memAddress, 4, false, &ex->result);
+            sim->reservationAddress = ex->memAddress;
+            sim->reservationValid = true;
+            return ok;
+        case OP_SCW:
+            if (sim->reservationValid && sim->reservationAddress == ex->memAddress) {
+                ok = mmuStore(mmu, ex->memAddress, 4, ex->storeData);
+                ex->result = 0;
+            } else {
+                ex->result = 1;
+            }
+            sim->reservationValid = false;
+            return ok;
+        default:
+            break;
+    }
+
+    if (!mmuLoad(mmu, ex->memAddress, 4, false, &loaded)) {
+        return false;
+    }
+    switch (ex->microOp) {
+        case OP_AMOADDW:  stored = alu_add(loaded, ex->storeData); break;
+        case OP_AMOANDW:  stored = alu_and(loaded, ex->storeData); break;
+        case OP_AMOORW:   stored = alu_or(loaded, ex->storeData); break;
+        case OP_AMOXORW:  stored = alu_xor(loaded, ex->storeData); break;
+        case OP_AMOMAXW:  stored = (int32_t)loaded > (int32_t)ex->storeData ? loaded : ex->storeData; break;
+        case OP_AMOMINW:  stored = (int32_t)loaded < (int32_t)ex->storeData ? loaded : ex->storeData; break;
+        case OP_AMOMAXUW: stored = loaded > ex->storeData ? loaded : ex->storeData; break;
+        case OP_AMOMINUW: stored = loaded < ex->storeData ? loaded : ex->storeData; break;
+        default: break;
+    }
+    ex->result = loaded;
+    return mmuStore(mmu, ex->memAddress, 4, stored);
+}
+
+/* Doubles move as two words, the low one first */
+bool floatAccess(mmuState *mmu, decoder_to_execute *ex) {
+    uint32_t loaded = 0;
+    uint32_t high = 0;
+    bool ok;
+
+    switch (ex->microOp) {
+        case OP_FLW:
+            ok = mmuLoad(mmu, ex->memAddress, 4, false, &loaded);
+            ex->fpResult = NAN_BOX | loaded;
+            return ok;
+        case OP_FLD:
+            ok = mmuAligned(mmu, ex->memAddress, 8, ACCESS_LOAD) && mmuLoad(mmu, ex->memAddress, 4, false, &loaded) &&
+                 mmuLoad(mmu, ex->memAddress + 4, 4, false, &high);
+            ex->fpResult = ((uint64_t)high << 32) | loaded;
+            return ok;
+        case OP_FSW:
+            return mmuStore(mmu, ex->memAddress, 4, (uint32_t)ex->fpResult);
+        default:
+            return mmuAligned(mmu, ex->memAddress, 8, ACCESS_STORE) &&
+                   mmuStore(mmu, ex->memAddress, 4, (uint32_t)ex->fpResult) &&
+                   mmuStore(mmu, ex->memAddress + 4, 4, (uint32_t)(ex->fpResult >> 32));
+    }
+}
+
+void memAccessStage(sim_t *sim, decoder_to_execute *ex) {
+    memAccessFor(sim, ex, ISA_ALL);
+}
+
+/* Minimal proxy for the syscalls a bare metal newlib program needs */
+static void handleEnvironmentCall(sim_t *sim) {
+    uint32_t *x = sim->regFile.generalRegisters;
+    uint32_t number = x[17]; /* a7 */
+
+    switch (number) {
+        case SYSCALL_EXIT:
+            sim->exitCode = (int32_t)x[10];
+            sim->halted = true;
+            break;
+        case SYSCALL_WRITE: {
+            FILE *stream = x[10] == 2 ? stderr : stdout;
+            uint32_t value;
+            for (uint32_t i = 0; i < x[12]; i++) {
+                if (!mmuLoad(&sim->mmu, x[11] + i, 1, false, &value)) {
+                    break;
+                }
+                fputc((int)value, stream);
+            }
+            x[10] = x[12];
+            break;
+        }
+        default:
+            printf("Unsupported ecall %u\n", number);
+            x[10] = (uint32_t)-38; /* ENOSYS */
+            break;
+    }
+}
+
+/* Traps to the guest handler if there is one, otherwise there is nobody to report to */
+static void raiseException(sim_t *sim, uint32_t cause, uint32_t tval, uint32_t pc) {
+    if (trapHandlerInstalled(sim)) {
+        takeTrap(sim, cause, tval, pc);
+        clockTick(sim);
+    } else {
+        haltOnFault(sim, cause, pc, tval);
+    }
+}
+
+void writeBackStage(sim_t *sim, const decoder_to_execute *ex) {
+    registerFile *regFile = &sim->regFile;
+    uint32_t nextPc = ex->nextPc;
+
+    if (sim->halted) {
+        return;
+    }
+    if (ex->exception) {
+        /* Only the second half of a fused pair can fault, the first one retires before the trap */
+        if (ex->firstLength != 0) {
+            if (ex->writesRd && ex->rd != 0) {
+                regFile->generalRegisters[ex->rd] = ex->result;
+            }
+            sim->instructionsRetired++;
+            clockTick(sim);
+            raiseException(sim, ex->cause, ex->tval, ex->pc + ex->firstLength);
+            return;
+        }
+        raiseException(sim, ex->cause, ex->tval, ex->pc);
+        return;
+    }
+
+    switch (ex->microOp) {
+        case OP_ECALL:
+            if (trapHandlerInstalled(sim)) {
+                raiseException(sim, CAUSE_ECALL_U + sim->csrs.privilege, 0, ex->pc);
+                return;
+            }
+            handleEnvironmentCall(sim);
+            break;
+        case OP_EBREAK:
+            if (trapHandlerInstalled(sim)) {
+                raiseException(sim, CAUSE_BREAKPOINT, ex->pc, ex->pc);
+                return;
+            }
+            sim->crashed = true;
+            sim->halted = true;
+            break;
+        case OP_ILLEGAL:
+            /* A zero length marks an instruction that could not be fetched */
+            if (ex->length == 0) {
+                raiseException(sim, sim->mmu.lastFault.cause, sim->mmu.lastFault.tval, ex->pc);
+            } else {
+                raiseException(sim, CAUSE_ILLEGAL_INSTRUCTION, regFile->instructionRegister, ex->pc);
+            }
+            return;
+        case OP_CSRRW:
+        case OP_CSRRS:
+        case OP_CSRRC:
+        case OP_CSRRWI:
+        case OP_CSRRSI:
+        case OP_CSRRCI: {
+            uint32_t old;
+            if (!csrAccess(sim, ex->csr, ex->microOp, ex->storeData, ex->csrWrites, &old)) {
+                raiseException(sim, CAUSE_ILLEGAL_INSTRUCTION, regFile->instructionRegister, ex->pc);
+                return;
+            }
+            if (ex->rd != 0) {
+                regFile->generalRegisters[ex->rd] = old;
+            }
+            break;
+        }
+        case OP_SFENCE_VMA:
+            mmuFlush(&sim->mmu);
+            break;
+        case OP_MRET:
+            if (sim->csrs.privilege != PRIV_M) {
+                raiseException(sim, CAUSE_ILLEGAL_INSTRUCTION, regFile->instructionRegister, ex->pc);
+                return;
+            }
+            nextPc = trapReturn(sim);
+            break;
+        case OP_WFI:
+            /* Retires first so mepc points past the WFI when the interrupt is taken */
+            regFile->programCounter = nextPc;
+            sim->instructionsRetired++;
+            opcodeMixCount(&sim->mix, ex->microOp);
+            clockTick(sim);
+            waitForInterrupt(sim);
+            return;
+        default:
+            if (ex->writesRd && ex->rd != 0) {
+                regFile->generalRegisters[ex->rd] = ex->result;
+            }
+            if (ex->writesFd) {
+                sim->fpRegFile.regs[ex->rd] = ex->fpResult;
+            }
+            sim->fpRegFile.fflags |= ex->fpFlags;
+            break;
+    }
+
+    retireInstruction(sim, ex, nextPc);
+}
+
+/* Runs on the interpreter core selected for the program's ISA, see isa.h */
+uint64_t interpRun(sim_t *sim, uint64_t n, interpMode mode, uint32_t stopPc) {
+    return sim->core->run(sim, n, mode, stopPc);
+}
@@ -0,0 +1,114 @@
+#include "isa.h"
+#include <ctype.h>
+#include <string.h>
+#include "sim.h"
+#include "decode.h"
+#include "execute.h"
+#include "memAccess.h"
+#include "writeBack.h"
+#include "fetch.h"
+#include "trap.h"
+#include "mmu.h"
+
+/* The interpreter cores, smallest first */
+#define CORE_NAME rv32i
+#define CORE_EXTENSIONS (ISA_I)
+#include "isaCoreTemplate.h"
+
+#define CORE_NAME rv32im
+#define CORE_EXTENSIONS (ISA_I | ISA_M)
+#include "isaCoreTemplate.h"
+
+#define CORE_NAME rv32imac
+#define CORE_EXTENSIONS (ISA_I | ISA_M | ISA_A | ISA_C)
+#include "isaCoreTemplate.h"
+
+#define CORE_NAME rv32imafc
+#define CORE_EXTENSIONS (ISA_I | ISA_M | ISA_A | ISA_F | ISA_C)
+#include "isaCoreTemplate.h"
+
+#define CORE_NAME rv32imafdc
+#define CORE_EXTENSIONS (ISA_I | ISA_M | ISA_A | ISA_F | ISA_D | ISA_C)
+#include "isaCoreTemplate.h"
+
+#define CORE_NAME rv32imafdcv
+#define CORE_EXTENSIONS ISA_ALL
+#include "isaCoreTemplate.h"
+
+static const isaCore *const cores[] = {
+    &core_rv32i,
+    &core_rv32im,
+    &core_rv32imac,
+    &core_rv32imafc,
+    &core_rv32imafdc,
+    &core_rv32imafdcv,
+};
+
+#define CORE_COUNT (sizeof(cores) / sizeof(cores[0]))
+
+/* Skips the version of an extension, "2p1" or "2" */
+static const char *skipVersion(const char *isa) {
+    while (isdigit((unsigned char)*isa)) {
+        isa++;
+    }
+    if (*isa == 'p' && isdigit((unsigned char)isa[1])) {
+        isa++;
+        while (isdigit((unsigned char)*isa)) {
+            isa++;
+        }
+    }
+    return isa;
+}
+
+bool isaParse(const char *isa, uint32_t *extensions) {
+    uint32_t found = 0;
+
+    if (strncmp(isa, "rv32", 4) != 0) {
+        return false;
+    }
+    isa += 4;
+    switch (*isa++) {
+        case 'i': found = ISA_I; break;
+        case 'g': found = ISA_I | ISA_M | ISA_A | ISA_F | ISA_D; break;
+        default: return false;   /* RV32E has no core */
+    }
+    isa = skipVersion(isa);
+
+    while (*isa != '\0') {
+        if (*isa == '_') {
+            isa++;
+            continue;
+        }
+        /* Multi-letter extensions run to the next underscore, only the vector subsets matter */
+        if (*isa == 'z' || *isa == 's' || *isa == 'x') {
+            if (strncmp(isa, "zve32", 5) == 0) {
+                found |= ISA_V;
+            }
+            while (*isa != '\0' && *isa != '_') {
+                isa++;
+            }
+            continue;
+        }
+        switch (*isa++) {
+            case 'm': found |= ISA_M; break;
+            case 'a': found |= ISA_A; break;
+            case 'f': found |= ISA_F; break;
+            case 'd': found |= ISA_F | ISA_D; break;
+            case 'c': found |= ISA_C; break;
+            case 'v': found |= ISA_V; break;
+            default: return false;
+        }
+        isa = skipVersion(isa);
+    }
+    *extensions = found;
+    return true;
+}
+
+const isaCore *isaSelectCore(uint32_t extensions) {
+    for (size_t i = 0; i < CORE_COUNT; i++) {
+        if ((cores[i]->extensions & extensions) == extensions) {
+            return cores[i];
+        }
+    }
+    return cores[CORE_COUNT - 1];
+}
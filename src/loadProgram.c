@@ -0,0 +1,182 @@
+#include "loadProgram.h"
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef SHT_RISCV_ATTRIBUTES
+#define SHT_RISCV_ATTRIBUTES 0x70000003
+#endif
+#define TAG_FILE 1
+#define TAG_RISCV_ARCH 5
+
+static bool validHeader(const Elf32_Ehdr *header) {
+    return memcmp(header->e_ident, ELFMAG, SELFMAG) == 0 &&
+           header->e_ident[EI_CLASS] == ELFCLASS32 &&
+           header->e_ident[EI_DATA] == ELFDATA2LSB &&
+           header->e_machine == EM_RISCV &&
+           header->e_phentsize == sizeof(Elf32_Phdr);
+}
+
+static bool loadSegment(FILE *file, const Elf32_Phdr *segment, ram_t *ram) {
+    uint8_t *dest;
+
+    if (segment->p_memsz == 0) {
+        return true;
+    }
+    if (segment->p_filesz > segment->p_memsz) {
+        return false;
+    }
+    dest = ramPointer(ram, segment->p_paddr, segment->p_memsz);
+    if (dest == NULL) {
+        printf("ELF segment at %08X (%u bytes) is outside of ram\n", segment->p_paddr, segment->p_memsz);
+        return false;
+    }
+    if (fseek(file, segment->p_offset, SEEK_SET) != 0 ||
+        fread(dest, 1, segment->p_filesz, file) != segment->p_filesz) {
+        return false;
+    }
+    memset(dest + segment->p_filesz, 0, segment->p_memsz - segment->p_filesz);
+    return true;
+}
+
+bool loadElf(const char *path, ram_t *ram, uint32_t *entry) {
+    Elf32_Ehdr header;
+    bool ok = true;
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL) {
+        perror("ELF file");
+        return false;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 || !validHeader(&header)) {
+        printf("%s is not a little-endian RV32 ELF\n", path);
+        fclose(file);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.e_phnum && ok; i++) {
+        Elf32_Phdr segment;
+        ok = fseek(file, header.e_phoff + i * sizeof(segment), SEEK_SET) == 0 &&
+             fread(&segment, sizeof(segment), 1, file) == 1;
+        if (ok && segment.p_type == PT_LOAD) {
+            ok = loadSegment(file, &segment, ram);
+        }
+    }
+    fclose(file);
+
+    if (!ok) {
+        printf("Failed to load %s\n", path);
+        return false;
+    }
+    *entry = header.e_entry;
+    return true;
+}
+
+static uint32_t readUleb(const uint8_t **cursor, const uint8_t *end) {
+    uint32_t value = 0;
+    for (int shift = 0; *cursor < end && shift < 32; shift += 7) {
+        uint8_t byte = *(*cursor)++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    return value;
+}
+
+static uint32_t readWord(const uint8_t *bytes) {
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+/*
+ * Attributes are 'A', then vendor subsections (length, name, tagged sub-subsections), then
+ * attributes of ULEB128 tags. Even tags carry a ULEB128 value and odd ones a string.
+ */
+static bool findArch(const uint8_t *data, size_t size, char *arch, size_t archSize) {
+    const uint8_t *cursor = data + 1;
+    const uint8_t *end = data + size;
+
+    if (size == 0 || data[0] != 'A') {
+        return false;
+    }
+    while (end - cursor >= 4) {
+        uint32_t length = readWord(cursor);
+        const uint8_t *vendorEnd = cursor + length;
+        if (length < 4 || length > (size_t)(end - cursor)) {
+            return false;
+        }
+        const uint8_t *name = cursor + 4;
+        const uint8_t *nameEnd = memchr(name, '\0', vendorEnd - name);
+        if (nameEnd == NULL) {
+            return false;
+        }
+        cursor = nameEnd + 1;
+        if (strcmp((const char *)name, "riscv") != 0) {
+            cursor = vendorEnd;
+            continue;
+        }
+        while (vendorEnd - cursor >= 5) {
+            uint8_t tag = *cursor;
+            uint32_t subLength = readWord(cursor + 1);
+            const uint8_t *subEnd = cursor + subLength;
+            if (subLength < 5 || subLength > (size_t)(vendorEnd - cursor)) {
+                return false;
+            }
+            cursor += 5;
+            while (tag == TAG_FILE && cursor < subEnd) {
+                uint32_t attribute = readUleb(&cursor, subEnd);
+                if (attribute % 2 == 0) {
+                    readUleb(&cursor, subEnd);
+                    continue;
+                }
+                const uint8_t *stringEnd = memchr(cursor, '\0', subEnd - cursor);
+                if (stringEnd == NULL) {
+                    return false;
+                }
+                if (attribute == TAG_RISCV_ARCH && (size_t)(stringEnd - cursor) < archSize) {
+                    memcpy(arch, cursor, stringEnd - cursor + 1);
+                    return true;
+                }
+                cursor = stringEnd + 1;
+            }
+            cursor = subEnd;
+        }
+        cursor = vendorEnd;
+    }
+    return false;
+}
+
+bool elfArchString(const char *path, char *arch, size_t size) {
+    Elf32_Ehdr header;
+    bool found = false;
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return false;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 || !validHeader(&header) ||
+        header.e_shentsize != sizeof(Elf32_Shdr)) {
+        fclose(file);
+        return false;
+    }
+    for (uint32_t i = 0; i < header.e_shnum && !found; i++) {
+        Elf32_Shdr section;
+        if (fseek(file, header.e_shoff + i * sizeof(section), SEEK_SET) != 0 ||
+            fread(&section, sizeof(section), 1, file) != 1) {
+            break;
+        }
+        if (section.sh_type != SHT_RISCV_ATTRIBUTES) {
+            continue;
+        }
+        uint8_t *data = (uint8_t *)malloc(section.sh_size);
+        if (data != NULL && fseek(file, section.sh_offset, SEEK_SET) == 0 &&
+            fread(data, 1, section.sh_size, file) == section.sh_size) {
+            found = findArch(data, section.sh_size, arch, size);
+        }
+        free(data);
+        break;
+    }
+    fclose(file);
+    return found;
+}
@@ -1,43 +1,151 @@
-#include "../inc/controlUnit.h"
-#include "../inc/ram.h"
-#include "../inc/registers.h"
+#include "../inc/riscvsim.h"
+#include "../inc/bus.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+static void usage(const char *name, const sim_config *defaults) {
+    printf("Usage: %s [options] program\n", name);
+    printf("  program     RV32 ELF, or a raw binary loaded at address 0\n");
+    printf("  -m mode     detailed (default), functional, sampled or decoupled\n");
+    printf("  -n count    stop after count instructions\n");
+    printf("  -b image    attach image as the block device at %08X\n", BLOCK_DEVICE_BASE);
+    printf("  -a policy   misaligned loads and stores: split (default) or trap\n");
+    printf("  -x isa      interpreter core for this ISA string, e.g. rv32imac (default: from the ELF attributes)\n");
+    printf("  -v vlen     vector register width in bits, 32 to 256 (default %u)\n", defaults->vlen);
+    printf("  -r hz       sleep the host in WFI at hz mtime ticks per second (default: skip idle time)\n");
+    printf("  -e name     publish live statistics in shared memory object name, watch with simtop\n");
+    printf("  -i cycles   simulated cycles between statistics updates (default %llu)\n", (unsigned long long)defaults->stats_interval);
+    printf("  -F          do not fuse instruction pairs into macro-ops\n");
+    printf("  -W count    instructions fetched per cycle (default %u)\n", defaults->fetch_width);
+    printf("  -Q count    fetch queue entries (default %u)\n", defaults->fetch_queue_depth);
+    printf("  -t layout   pipeline threads: stages (one per stage, default), split (frontend/backend) or one\n");
+    printf("  -c cpus     pin the pipeline threads to these host CPUs in order, e.g. 0,2\n");
+    printf("Out-of-order model:\n");
+    printf("  -o width    time the program on an out-of-order core issuing 1 to 4 per cycle (default: in order)\n");
+    printf("  -R count    reorder buffer entries (default %u)\n", defaults->rob_entries);
+    printf("  -S count    reservation station entries (default %u)\n", defaults->rs_entries);
+    printf("  -P count    integer physical registers (default %u)\n", defaults->phys_regs);
+    printf("Sampled mode:\n");
+    printf("  -f count    fast-forward count instructions before sampling\n");
+    printf("  -s pc       fast-forward until pc (hex) is reached\n");
+    printf("  -w count    warming instructions per sample (default %llu)\n", (unsigned long long)defaults->warmup);
+    printf("  -d count    detailed instructions per sample (default %llu)\n", (unsigned long long)defaults->detail);
+    printf("  -p count    sampling period in instructions (default %llu)\n", (unsigned long long)defaults->period);
+}
+
+/* Signal handler for SIGINT (Ctrl+C) */
+static void sigint_handler(int sig) {
+    (void)sig;
+    printf("SIGINT received. Exiting program.\n");
+    exit(0);
+}
+
+static bool isElf(const char *path) {
+    char magic[4] = {0};
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    size_t read = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    return read == sizeof(magic) && memcmp(magic, "\177ELF", sizeof(magic)) == 0;
+}
+
 /* Main function */
-int main() {
+int main(int argc, char **argv) {
+    sim_config config;
+    uint64_t maxInstructions = 0;
+    int opt;
+
+    sim_default_config(&config);
+    while ((opt = getopt(argc, argv, "m:n:b:a:x:v:r:e:i:FW:Q:t:c:o:R:S:P:f:s:w:d:p:h")) != -1) {
+        switch (opt) {
+            case 'm':
+                if (strcmp(optarg, "detailed") == 0) {
+                    config.mode = SIM_MODE_DETAILED;
+                } else if (strcmp(optarg, "functional") == 0) {
+                    config.mode = SIM_MODE_FUNCTIONAL;
+                } else if (strcmp(optarg, "sampled") == 0) {
+                    config.mode = SIM_MODE_SAMPLED;
+                } else if (strcmp(optarg, "decoupled") == 0) {
+                    config.mode = SIM_MODE_DECOUPLED;
+                } else {
+                    usage(argv[0], &config);
+                    return 1;
+                }
+                break;
+            case 'n': maxInstructions = strtoull(optarg, NULL, 0); break;
+            case 'b': config.disk_image = optarg; break;
+            case 'a':
+                if (strcmp(optarg, "split") == 0) {
+                    config.misaligned = SIM_MISALIGNED_SPLIT;
+                } else if (strcmp(optarg, "trap") == 0) {
+                    config.misaligned = SIM_MISALIGNED_TRAP;
+                } else {
+                    usage(argv[0], &config);
+                    return 1;
+                }
+                break;
+            case 'x': config.isa = optarg; break;
+            case 'v': config.vlen = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'r': config.wfi_sleep_hz = strtoull(optarg, NULL, 0); break;
+            case 'e': config.stats_name = optarg; break;
+            case 'i': config.stats_interval = strtoull(optarg, NULL, 0); break;
+            case 'F': config.fusion = false; break;
+            case 'W': config.fetch_width = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'Q': config.fetch_queue_depth = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 't':
+                if (strcmp(optarg, "stages") == 0) {
+                    config.pipeline_layout = SIM_PIPELINE_PER_STAGE;
+                } else if (strcmp(optarg, "split") == 0) {
+                    config.pipeline_layout = SIM_PIPELINE_SPLIT;
+                } else if (strcmp(optarg, "one") == 0) {
+                    config.pipeline_layout = SIM_PIPELINE_ONE_THREAD;
+                } else {
+                    usage(argv[0], &config);
+                    return 1;
+                }
+                break;
+            case 'c': config.pipeline_cpus = optarg; break;
+            case 'o': config.issue_width = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'R': config.rob_entries = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'S': config.rs_entries = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'P': config.phys_regs = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'f': config.fast_forward = strtoull(optarg, NULL, 0); break;
+            case 's': config.start_pc = (uint32_t)strtoul(optarg, NULL, 16); break;
+            case 'w': config.warmup = strtoull(optarg, NULL, 0); break;
+            case 'd': config.detail = strtoull(optarg, NULL, 0); break;
+            case 'p': config.period = strtoull(optarg, NULL, 0); break;
+            default:
+                usage(argv[0], &config);
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0], &config);
+        return 1;
+    }
+
     signal(SIGINT, sigint_handler);  // Register SIGINT handler
-    initRegFile(&regFile);
-    initializeSignal();
-    initialPipes();
-    initializeThreads();
-
-    ram_t *data_ram;
-    ram_t *instruction_ram;
-    initRam(data_ram, UINT32_MAX);
-    initRam(instruction_ram, UINT32_MAX);
-
-        pthread_kill(fetchThreadHandle, SIGUSR1);
-    for (;;) {
-        printf("\n\n\n");
-        /* Simulate signal delivery */
-        // pthread_kill(regWriteThreadHandle, SIGUSR1);
-        // usleep(100);
-        // pthread_kill(memAccessThreadHandle, SIGUSR1);
-        // usleep(100);
-        // pthread_kill(executeThreadHandle, SIGUSR1);
-        // usleep(100);
-        // pthread_kill(decodeThreadHandle, SIGUSR1);
-        // usleep(100);
-        sleep(5);  // Delay to simulate timing
-        
+
+    sim_t *sim = sim_create(&config);
+    if (sim == NULL) {
+        return 1;
+    }
+    bool loaded = isElf(argv[optind]) ? sim_load_elf(sim, argv[optind]) : sim_load_binary(sim, argv[optind]);
+    if (!loaded) {
+        sim_destroy(sim);
+        return 1;
     }
 
-    /* Join threads (optional) */
-    pthread_join(fetchThreadHandle, NULL);
-    pthread_join(decodeThreadHandle, NULL);
-    pthread_join(executeThreadHandle, NULL);
-    pthread_join(memAccessThreadHandle, NULL);
-    pthread_join(regWriteThreadHandle, NULL);
-
-    cleanRam(data_ram);
-    cleanRam(instruction_ram);
-    return 0;
-}
\ No newline at end of file
+    sim_run(sim, maxInstructions ? maxInstructions : UINT64_MAX);
+    sim_print_stats(sim);
+    printf("Exit code:             %d\n", sim_exit_code(sim));
+
+    int exitCode = sim_exit_code(sim);
+    sim_destroy(sim);
+    return exitCode;
+}
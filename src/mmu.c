@@ -0,0 +1,275 @@
+#include "mmu.h"
+#include "ram.h"
+
+/* Translation regimes, each keeps its own TLB so privilege changes never need a flush */
+#define REGIME_BARE 0
+#define REGIME_SUPERVISOR 1
+#define REGIME_USER 2
+
+#define SV32_LEVELS 2
+#define PTE_PPN_SHIFT 10
+
+static void flushSet(tlbSet *set) {
+    for (int i = 0; i < TLB_ENTRIES; i++) {
+        set->load[i].tag = TLB_INVALID;
+        set->store[i].tag = TLB_INVALID;
+        set->fetch[i].tag = TLB_INVALID;
+    }
+}
+
+void mmuInit(mmuState *mmu, const csrFile *csrs, busMap *bus) {
+    mmu->csrs = csrs;
+    mmu->bus = bus;
+    mmu->trapMisaligned = false;
+    flushSet(&mmu->tlbs[REGIME_BARE]);
+    mmuFlush(mmu);
+}
+
+void mmuFlush(mmuState *mmu) {
+    /* Identity mappings of the bare regime never go stale */
+    flushSet(&mmu->tlbs[REGIME_SUPERVISOR]);
+    flushSet(&mmu->tlbs[REGIME_USER]);
+    mmuUpdateMode(mmu);
+}
+
+void mmuFlushAll(mmuState *mmu) {
+    flushSet(&mmu->tlbs[REGIME_BARE]);
+    mmuFlush(mmu);
+}
+
+/* Loads and stores translate at MPP privilege while MPRV is set in M-mode */
+static uint8_t dataPrivilege(const csrFile *csrs) {
+    if (csrs->privilege == PRIV_M && (csrs->mstatus & MSTATUS_MPRV)) {
+        return (csrs->mstatus & MSTATUS_MPP) >> MSTATUS_MPP_SHIFT;
+    }
+    return csrs->privilege;
+}
+
+static tlbSet *regime(mmuState *mmu, uint8_t privilege) {
+    if (privilege == PRIV_M || !(mmu->csrs->satp & SATP_MODE_SV32)) {
+        return &mmu->tlbs[REGIME_BARE];
+    }
+    return &mmu->tlbs[privilege == PRIV_S ? REGIME_SUPERVISOR : REGIME_USER];
+}
+
+void mmuUpdateMode(mmuState *mmu) {
+    mmu->current = regime(mmu, mmu->csrs->privilege);
+    mmu->data = regime(mmu, dataPrivilege(mmu->csrs));
+}
+
+static bool fault(mmuState *mmu, uint32_t address, accessType type, bool pageFault) {
+    static const uint32_t pageFaultCause[] = { CAUSE_LOAD_PAGE_FAULT, CAUSE_STORE_PAGE_FAULT, CAUSE_FETCH_PAGE_FAULT };
+    static const uint32_t accessFaultCause[] = { CAUSE_LOAD_ACCESS, CAUSE_STORE_ACCESS, CAUSE_FETCH_ACCESS };
+    mmu->lastFault.cause = pageFault ? pageFaultCause[type] : accessFaultCause[type];
+    mmu->lastFault.tval = address;
+    return false;
+}
+
+bool mmuMisalignedFault(mmuState *mmu, uint32_t address, accessType type) {
+    mmu->lastFault.cause = type == ACCESS_STORE ? CAUSE_STORE_MISALIGNED : CAUSE_LOAD_MISALIGNED;
+    mmu->lastFault.tval = address;
+    return false;
+}
+
+static bool leafAllowed(const csrFile *csrs, uint8_t privilege, uint32_t pte, accessType type) {
+    if (pte & PTE_U) {
+        /* Supervisor never executes user pages and needs SUM to touch their data */
+        if (privilege == PRIV_S && (type == ACCESS_FETCH || !(csrs->mstatus & MSTATUS_SUM))) {
+            return false;
+        }
+    } else if (privilege == PRIV_U) {
+        return false;
+    }
+
+    switch (type) {
+        case ACCESS_LOAD:
+            return (pte & PTE_R) || ((csrs->mstatus & MSTATUS_MXR) && (pte & PTE_X));
+        case ACCESS_STORE:
+            return pte & PTE_W;
+        default:
+            return pte & PTE_X;
+    }
+}
+
+/* Sv32 page table walk, sets the accessed and dirty bits in hardware */
+static bool translate(mmuState *mmu, uint32_t address, accessType type, uint32_t *physical) {
+    uint8_t privilege = type == ACCESS_FETCH ? mmu->csrs->privilege : dataPrivilege(mmu->csrs);
+
+    if (regime(mmu, privilege) == &mmu->tlbs[REGIME_BARE]) {
+        *physical = address;
+        return true;
+    }
+
+    uint64_t table = (uint64_t)(mmu->csrs->satp & SATP_PPN_MASK) << PAGE_SHIFT;
+    for (int level = SV32_LEVELS - 1; level >= 0; level--) {
+        uint32_t vpn = (address >> (PAGE_SHIFT + 10 * level)) & 0x3FF;
+        uint64_t pteAddress = table + vpn * 4;
+        uint32_t pte;
+
+        /* Only the low 4 GiB of the 34 bit physical space exist */
+        if (pteAddress > UINT32_MAX || !busLoad(mmu->bus, (uint32_t)pteAddress, 4, false, &pte)) {
+            return fault(mmu, address, type, false);
+        }
+        if (!(pte & PTE_V) || (!(pte & PTE_R) && (pte & PTE_W))) {
+            return fault(mmu, address, type, true);
+        }
+
+        uint64_t ppn = pte >> PTE_PPN_SHIFT;
+        if (!(pte & (PTE_R | PTE_X))) {
+            table = ppn << PAGE_SHIFT;
+            continue;
+        }
+
+        /* Leaf */
+        if (!leafAllowed(mmu->csrs, privilege, pte, type)) {
+            return fault(mmu, address, type, true);
+        }
+        if (level == 1 && (ppn & 0x3FF) != 0) {
+            return fault(mmu, address, type, true); /* Misaligned superpage */
+        }
+        uint32_t updated = pte | PTE_A | (type == ACCESS_STORE ? PTE_D : 0);
+        if (updated != pte && !busStore(mmu->bus, (uint32_t)pteAddress, 4, updated)) {
+            return fault(mmu, address, type, false);
+        }
+
+        uint64_t result = level == 1
+            ? (ppn << PAGE_SHIFT) | (address & 0x3FFFFF)
+            : (ppn << PAGE_SHIFT) | (address & (PAGE_SIZE - 1));
+        if (result > UINT32_MAX) {
+            return fault(mmu, address, type, false);
+        }
+        *physical = (uint32_t)result;
+        return true;
+    }
+    return fault(mmu, address, type, true);
+}
+
+/*
+ * Finds where an access that stays inside one page lands. Ram pages are added to the TLB and
+ * returned as a host pointer, anything else returns NULL and the physical address for the bus.
+ */
+static bool resolve(mmuState *mmu, tlbEntry *tlb, uint32_t address, accessType type, uint8_t **host, uint32_t *physical) {
+    tlbEntry *entry = &tlb[(address >> PAGE_SHIFT) & (TLB_ENTRIES - 1)];
+    if (entry->tag == (address & PAGE_MASK)) {
+        *host = (uint8_t *)(address + entry->addend);
+        return true;
+    }
+
+    if (!translate(mmu, address, type, physical)) {
+        return false;
+    }
+    uint8_t *page = ramPointer(mmu->bus->ram, *physical & PAGE_MASK, PAGE_SIZE);
+    if (page == NULL) {
+        *host = NULL;
+        return true;
+    }
+    /* Stores that hit the TLB skip dirty tracking, so the page is marked when it is cached */
+    if (type == ACCESS_STORE) {
+        ramMarkDirty(mmu->bus->ram, *physical);
+    }
+    entry->tag = address & PAGE_MASK;
+    entry->addend = (uintptr_t)page - (address & PAGE_MASK);
+    *host = page + (address & (PAGE_SIZE - 1));
+    return true;
+}
+
+static inline bool crossesPage(uint32_t address, uint8_t bytes) {
+    return (address & (PAGE_SIZE - 1)) + bytes > PAGE_SIZE;
+}
+
+bool mmuLoadSlow(mmuState *mmu, uint32_t address, uint8_t bytes, bool isSigned, uint32_t *value) {
+    uint8_t *host;
+    uint32_t physical;
+    uint32_t raw = 0;
+
+    if (!mmuAligned(mmu, address, bytes, ACCESS_LOAD)) {
+        return false;
+    }
+    if (crossesPage(address, bytes)) {
+        for (uint8_t i = 0; i < bytes; i++) {
+            uint32_t byte;
+            if (!mmuLoadSlow(mmu, address + i, 1, false, &byte)) {
+                return false;
+            }
+            raw |= byte << (8 * i);
+        }
+        *value = extendLoad(raw, bytes, isSigned);
+        return true;
+    }
+
+    if (!resolve(mmu, mmu->data->load, address, ACCESS_LOAD, &host, &physical)) {
+        return false;
+    }
+    if (host == NULL) {
+        return busLoad(mmu->bus, physical, bytes, isSigned, value) || fault(mmu, address, ACCESS_LOAD, false);
+    }
+    memcpy(&raw, host, bytes);
+    *value = extendLoad(raw, bytes, isSigned);
+    return true;
+}
+
+bool mmuStoreSlow(mmuState *mmu, uint32_t address, uint8_t bytes, uint32_t value) {
+    uint8_t *host;
+    uint32_t physical;
+
+    if (!mmuAligned(mmu, address, bytes, ACCESS_STORE)) {
+        return false;
+    }
+    if (crossesPage(address, bytes)) {
+        for (uint8_t i = 0; i < bytes; i++) {
+            if (!mmuStoreSlow(mmu, address + i, 1, (value >> (8 * i)) & 0xFF)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (!resolve(mmu, mmu->data->store, address, ACCESS_STORE, &host, &physical)) {
+        return false;
+    }
+    if (host == NULL) {
+        return busStore(mmu->bus, physical, bytes, value) || fault(mmu, address, ACCESS_STORE, false);
+    }
+    memcpy(host, &value, bytes);
+    return true;
+}
+
+bool mmuFetchSlow(mmuState *mmu, uint32_t address, uint8_t bytes, uint32_t *value) {
+    uint8_t *host;
+    uint32_t physical;
+
+    /* A 32 bit instruction can straddle two pages, fetch it as two parcels */
+    if (crossesPage(address, bytes)) {
+        uint32_t low, high;
+        if (!mmuFetchSlow(mmu, address, 2, &low) || !mmuFetchSlow(mmu, address + 2, 2, &high)) {
+            return false;
+        }
+        *value = low | (high << 16);
+        return true;
+    }
+
+    if (!resolve(mmu, mmu->current->fetch, address, ACCESS_FETCH, &host, &physical)) {
+        return false;
+    }
+    if (host == NULL) {
+        /* Executing from MMIO is not supported */
+        return fault(mmu, address, ACCESS_FETCH, false);
+    }
+    *value = 0;
+    memcpy(value, host, bytes);
+    return true;
+}
+
+uint8_t *mmuHostSpan(mmuState *mmu, uint32_t address, uint32_t bytes, accessType type) {
+    tlbEntry *tlb = type == ACCESS_LOAD ? mmu->data->load : type == ACCESS_STORE ? mmu->data->store : mmu->current->fetch;
+    uint8_t *host;
+    uint32_t physical;
+
+    if (bytes == 0 || (address & (PAGE_SIZE - 1)) + bytes > PAGE_SIZE) {
+        return NULL;
+    }
+    if (!resolve(mmu, tlb, address, type, &host, &physical)) {
+        return NULL;
+    }
+    return host;
+}
@@ -0,0 +1,237 @@
+#include "ooo.h"
+#include <stdlib.h>
+#include <string.h>
+
+const oooConfig oooDefaults = {
+    .issueWidth = 3,
+    .robEntries = 64,
+    .rsEntries = 32,
+    .physRegs = 96,
+    .units = {
+        [FU_ALU] = 3,
+        [FU_MUL] = 1,
+        [FU_DIV] = 1,
+        [FU_MEM] = 2,
+        [FU_FP] = 2,
+        [FU_FP_DIV] = 1,
+    },
+};
+
+/* Pipelined units take a new instruction every cycle, the others are busy for the whole latency */
+static const bool unitPipelined[FU_CLASSES] = {
+    [FU_ALU] = true,
+    [FU_MUL] = true,
+    [FU_DIV] = false,
+    [FU_MEM] = true,
+    [FU_FP] = true,
+    [FU_FP_DIV] = false,
+};
+
+bool oooConfigValid(const oooConfig *cfg) {
+    if (cfg->issueWidth < 1 || cfg->issueWidth > OOO_MAX_WIDTH || cfg->robEntries == 0 ||
+        cfg->robEntries > OOO_MAX_ENTRIES || cfg->rsEntries == 0 || cfg->rsEntries > OOO_MAX_ENTRIES ||
+        cfg->physRegs <= 32 || cfg->physRegs > 32 + OOO_MAX_ENTRIES) {
+        return false;
+    }
+    for (int unit = 0; unit < FU_CLASSES; unit++) {
+        if (cfg->units[unit] < 1 || cfg->units[unit] > OOO_MAX_UNITS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool oooInit(oooModel *model, const oooConfig *cfg, uint32_t maxLatency) {
+    /* Only instructions still in the reservation station, which also hold a ROB entry, issue past the
+       current dispatch cycle. Each can wait on the one before it and on an issue slot */
+    uint32_t inFlight = cfg->rsEntries < cfg->robEntries ? cfg->rsEntries : cfg->robEntries;
+    uint64_t window = (uint64_t)inFlight * ((uint64_t)maxLatency + 1) + 2;
+    uint64_t slotCycles = 1;
+
+    while (slotCycles < window) {
+        slotCycles <<= 1;
+    }
+    memset(model, 0, sizeof(*model));
+    model->cfg = *cfg;
+    model->robCommit = (uint64_t*)calloc(cfg->robEntries, sizeof(uint64_t));
+    model->renameCommit = (uint64_t*)calloc(cfg->physRegs - 32, sizeof(uint64_t));
+    model->rsIssue = (uint64_t*)calloc(cfg->rsEntries, sizeof(uint64_t));
+    model->slots = (oooSlot*)calloc(slotCycles, sizeof(oooSlot));
+    model->slotMask = slotCycles - 1;
+    return model->robCommit != NULL && model->renameCommit != NULL && model->rsIssue != NULL &&
+           model->slots != NULL;
+}
+
+void oooCleanup(oooModel *model) {
+    free(model->robCommit);
+    free(model->renameCommit);
+    free(model->rsIssue);
+    free(model->slots);
+    model->robCommit = NULL;
+    model->renameCommit = NULL;
+    model->rsIssue = NULL;
+    model->slots = NULL;
+}
+
+static void rsPush(oooModel *model, uint64_t issue) {
+    uint64_t *heap = model->rsIssue;
+    uint32_t i = model->rsCount++;
+
+    while (i > 0 && heap[(i - 1) / 2] > issue) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = issue;
+}
+
+static void rsPop(oooModel *model) {
+    uint64_t *heap = model->rsIssue;
+    uint64_t last = heap[--model->rsCount];
+    uint32_t i = 0;
+
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= model->rsCount) {
+            break;
+        }
+        if (child + 1 < model->rsCount && heap[child + 1] < heap[child]) {
+            child++;
+        }
+        if (heap[child] >= last) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+}
+
+/* Entries leave the reservation station in the cycle they issue */
+static void rsRetire(oooModel *model, uint64_t cycle) {
+    while (model->rsCount != 0 && model->rsIssue[0] <= cycle) {
+        rsPop(model);
+    }
+}
+
+/* Slot of cycle, claimed from whatever older cycle last used its place in the ring */
+static oooSlot *slotAt(oooModel *model, uint64_t cycle) {
+    oooSlot *slot = &model->slots[cycle & model->slotMask];
+    if (slot->cycle != cycle) {
+        slot->cycle = cycle;
+        memset(slot->used, 0, sizeof(slot->used));
+    }
+    return slot;
+}
+
+void oooSchedule(oooModel *model, uint8_t rd, uint8_t rs1, uint8_t rs2, fuClass unit, uint32_t latency,
+                 bool serializing, uint64_t ready, oooStats *stats, oooTimes *times) {
+    const oooConfig *cfg = &model->cfg;
+    uint32_t renameRegs = cfg->physRegs - 32;
+    uint64_t dispatch = ready;
+    uint64_t issue;
+    uint64_t complete;
+    uint64_t commit;
+
+    /* Dispatch in order, serializing instructions wait for everything before them to commit */
+    if (dispatch < model->dispatchCycle) {
+        dispatch = model->dispatchCycle;
+    }
+    if (serializing && dispatch < model->commitCycle) {
+        dispatch = model->commitCycle;
+    }
+
+    /* A ROB entry frees when the instruction robEntries back commits */
+    if (model->instructions >= cfg->robEntries) {
+        uint64_t freed = model->robCommit[model->instructions % cfg->robEntries];
+        if (freed > dispatch) {
+            stats->robStalls += freed - dispatch;
+            dispatch = freed;
+        }
+    }
+    if (rd != 0 && model->writers >= renameRegs) {
+        uint64_t freed = model->renameCommit[model->writers % renameRegs];
+        if (freed > dispatch) {
+            stats->renameStalls += freed - dispatch;
+            dispatch = freed;
+        }
+    }
+    rsRetire(model, dispatch);
+    if (model->rsCount == cfg->rsEntries) {
+        stats->rsStalls += model->rsIssue[0] - dispatch;
+        dispatch = model->rsIssue[0];
+        rsRetire(model, dispatch);
+    }
+    if (dispatch == model->dispatchCycle && model->dispatchCount == cfg->issueWidth) {
+        dispatch++;
+    }
+    if (dispatch != model->dispatchCycle) {
+        model->dispatchCycle = dispatch;
+        model->dispatchCount = 0;
+    }
+    model->dispatchCount++;
+
+    /* Issue once the operands are ready, then wait for a free unit and issue slot */
+    issue = dispatch + 1;
+    if (rs1 != 0 && model->regReady[rs1] > issue) {
+        issue = model->regReady[rs1];
+    }
+    if (rs2 != 0 && model->regReady[rs2] > issue) {
+        issue = model->regReady[rs2];
+    }
+    uint64_t *unitFree = NULL;
+    if (!unitPipelined[unit]) {
+        unitFree = &model->unitFree[unit][0];
+        for (uint32_t i = 1; i < cfg->units[unit]; i++) {
+            if (model->unitFree[unit][i] < *unitFree) {
+                unitFree = &model->unitFree[unit][i];
+            }
+        }
+        if (*unitFree > issue) {
+            issue = *unitFree;
+        }
+    }
+    for (;; issue++) {
+        oooSlot *slot = slotAt(model, issue);
+        if (slot->used[FU_CLASSES] < cfg->issueWidth && slot->used[unit] < cfg->units[unit]) {
+            slot->used[FU_CLASSES]++;
+            slot->used[unit]++;
+            break;
+        }
+    }
+    if (unitFree != NULL) {
+        *unitFree = issue + latency;
+        stats->unitBusy[unit] += latency;
+    } else {
+        stats->unitBusy[unit]++;
+    }
+    rsPush(model, issue);
+
+    complete = issue + latency;
+    if (rd != 0) {
+        model->regReady[rd] = complete;
+    }
+
+    /* Commit in order */
+    commit = complete > model->commitCycle ? complete : model->commitCycle;
+    if (commit == model->commitCycle && model->commitCount == cfg->issueWidth) {
+        commit++;
+    }
+    if (commit != model->commitCycle) {
+        model->commitCycle = commit;
+        model->commitCount = 0;
+    }
+    model->commitCount++;
+
+    model->robCommit[model->instructions % cfg->robEntries] = commit;
+    model->instructions++;
+    if (rd != 0) {
+        model->renameCommit[model->writers % renameRegs] = commit;
+        model->writers++;
+    }
+    stats->robCycles += commit - dispatch;
+
+    times->dispatch = dispatch;
+    times->issue = issue;
+    times->complete = complete;
+    times->commit = commit;
+}
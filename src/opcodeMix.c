@@ -0,0 +1,83 @@
+#include "opcodeMix.h"
+#include <stdio.h>
+
+typedef enum {
+    MIX_ALU,
+    MIX_MUL_DIV,
+    MIX_LOAD,
+    MIX_STORE,
+    MIX_BRANCH,
+    MIX_JUMP,
+    MIX_SYSTEM,
+    MIX_ATOMIC,
+    MIX_VECTOR,
+    MIX_FLOAT,
+    MIX_FUSED,
+    MIX_CLASSES
+} mixClass;
+
+static const char *const mixNames[MIX_CLASSES] = {
+    "ALU", "Mul/div", "Load", "Store", "Branch", "Jump", "System", "Atomic", "Vector", "Float", "Fused pairs"
+};
+
+static const char *const fusedNames[] = { "lui+addi", "auipc+jalr", "auipc+lw", "slli+srli" };
+
+static mixClass classOf(uint8_t op) {
+    if (op >= OP_LB && op <= OP_LHU) {
+        return MIX_LOAD;
+    }
+    if (op >= OP_SB && op <= OP_SW) {
+        return MIX_STORE;
+    }
+    if (op >= OP_BEQ && op <= OP_BGEU) {
+        return MIX_BRANCH;
+    }
+    if (op == OP_JAL || op == OP_JALR) {
+        return MIX_JUMP;
+    }
+    if (op >= OP_ECALL && op <= OP_WFI) {
+        return MIX_SYSTEM;
+    }
+    if (op >= OP_MUL && op <= OP_REMU) {
+        return MIX_MUL_DIV;
+    }
+    if (op >= OP_LRW && op <= OP_AMOMINUW) {
+        return MIX_ATOMIC;
+    }
+    if (op >= OP_VSETVLI && op <= OP_VFIRST) {
+        return MIX_VECTOR;
+    }
+    if (op >= OP_FLW && op <= OP_FCVT_D_S) {
+        return MIX_FLOAT;
+    }
+    if (op >= OP_LUI_ADDI && op <= OP_SLLI_SRLI) {
+        return MIX_FUSED;
+    }
+    /* Register and immediate arithmetic, lui/auipc and the illegal ones */
+    return MIX_ALU;
+}
+
+void printOpcodeMix(const opcodeMix *mix) {
+    uint64_t classes[MIX_CLASSES] = {0};
+    uint64_t total = 0;
+
+    for (unsigned op = 0; op < OP_COUNT; op++) {
+        classes[classOf((uint8_t)op)] += mix->counts[op];
+        total += mix->counts[op];
+    }
+    if (total == 0) {
+        return;
+    }
+
+    printf("Opcode mix:            %llu macro-ops\n", (unsigned long long)total);
+    for (unsigned c = 0; c < MIX_CLASSES; c++) {
+        if (classes[c] != 0) {
+            printf("  %-20s %-11llu %.1f%%\n", mixNames[c], (unsigned long long)classes[c], 100.0 * (double)classes[c] / (double)total);
+        }
+    }
+    for (unsigned op = OP_LUI_ADDI; op <= OP_SLLI_SRLI; op++) {
+        if (mix->counts[op] != 0) {
+            printf("    %-18s %llu\n", fusedNames[op - OP_LUI_ADDI], (unsigned long long)mix->counts[op]);
+        }
+    }
+}
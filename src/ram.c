@@ -3,47 +3,122 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-//Allocate 0 block of memory of size. Size is number of indicies, not necessarily bytes.
-void initRam(ram_t *ram, size_t size){
-    ram = (ram_t*)malloc(sizeof(ram_t)); 
-    ram->data = (uint32_t*)calloc(size, sizeof(uint32_t));
-    ram->size = size;
+//Allocate a zeroed block of guest memory, bytes long
+bool initRam(ram_t *ram, size_t bytes){
+    ram->data = (uint8_t*)calloc(bytes, 1);
+    ram->size = ram->data != NULL ? bytes : 0;
+    ram->dirty = NULL;
+    ram->saved = NULL;
+    ram->dirtyList = NULL;
+    ram->dirtyCount = 0;
+    if (ram->data == NULL) {
+        perror("Ram allocation failed");
+        return false;
+    }
+    return true;
+}
+
+static size_t pageCount(const ram_t *ram){
+    return (ram->size + RAM_PAGE_SIZE - 1) >> RAM_PAGE_SHIFT;
 }
 
-// Free both the ram memory and the struct instance of the ram
+/* The last page is short when the ram size is not a multiple of the page size */
+static uint32_t pageBytes(const ram_t *ram, uint32_t page){
+    size_t left = ram->size - ((size_t)page << RAM_PAGE_SHIFT);
+    return left < RAM_PAGE_SIZE ? (uint32_t)left : RAM_PAGE_SIZE;
+}
+
+static void freeSnapshot(ram_t *ram){
+    if (ram->saved != NULL) {
+        for (size_t page = 0; page < pageCount(ram); page++) {
+            free(ram->saved[page]);
+        }
+    }
+    free(ram->saved);
+    free(ram->dirty);
+    free(ram->dirtyList);
+    ram->saved = NULL;
+    ram->dirty = NULL;
+    ram->dirtyList = NULL;
+    ram->dirtyCount = 0;
+}
+
+// Free the ram memory, the struct instance belongs to the caller
 void cleanRam(ram_t *ram){
+    freeSnapshot(ram);
     free(ram->data);
-    free(ram);
+    ram->data = NULL;
+    ram->size = 0;
 }
 
+bool ramSnapshot(ram_t *ram){
+    size_t pages = pageCount(ram);
+    freeSnapshot(ram);
+    ram->dirty = (uint8_t*)calloc(pages, 1);
+    ram->saved = (uint8_t**)calloc(pages, sizeof(uint8_t*));
+    ram->dirtyList = (uint32_t*)malloc(pages * sizeof(uint32_t));
+    if (ram->dirty == NULL || ram->saved == NULL || ram->dirtyList == NULL) {
+        freeSnapshot(ram);
+        return false;
+    }
+    ram->snapshotLost = false;
+    return true;
+}
 
-void populateRAM(char* ASMfile, ram_t *ram) {
-    FILE *asmFile = fopen(ASMfile,"rb"); //change file format later
-    if(asmFile == NULL) {
-        printf("ERROR, INSTRUCTION FILE UNAVALIABLE!!!!"); //TODO: Replace with try-catch block
-        return;
+/* Pages are only copied the first time they are written after the snapshot, a restore leaves
+   them equal to the copy so later rounds just mark them */
+void ramMarkDirtySlow(ram_t *ram, uint32_t page){
+    uint8_t *contents = ram->data + ((size_t)page << RAM_PAGE_SHIFT);
+    if (ram->saved[page] == NULL) {
+        ram->saved[page] = (uint8_t*)malloc(RAM_PAGE_SIZE);
+        if (ram->saved[page] == NULL) {
+            perror("Snapshot page allocation failed");
+            ram->snapshotLost = true;
+            return;
+        }
+        memcpy(ram->saved[page], contents, pageBytes(ram, page));
     }
+    ram->dirty[page] = 1;
+    ram->dirtyList[ram->dirtyCount++] = page;
+}
 
-    /*Creating variables to read into RAM array*/
-    uint32_t binaryInstruction[64]; //buffer
-    size_t instructionRead; //instuctions read at a time
-    size_t ttlRead = 0; //total number of instructions read
+void ramRestore(ram_t *ram){
+    for (uint32_t i = 0; i < ram->dirtyCount; i++) {
+        uint32_t page = ram->dirtyList[i];
+        memcpy(ram->data + ((size_t)page << RAM_PAGE_SHIFT), ram->saved[page], pageBytes(ram, page));
+        ram->dirty[page] = 0;
+    }
+    ram->dirtyCount = 0;
+}
 
-    /*Read binary file useing fread()*/
-    while (instructionRead = fread(binaryInstruction,sizeof(uint32_t),sizeof(binaryInstruction)/sizeof(uint32_t),asmFile) > 0);
-    {
-        for (size_t i = 0; i < instructionRead; i++)
-        {
-            ram->data[ttlRead++] = binaryInstruction[i];
-        }
-        
+
+bool populateRAM(const char* ASMfile, ram_t *ram) {
+    FILE *asmFile = fopen(ASMfile,"rb"); //change file format later
+    if(asmFile == NULL) {
+        printf("ERROR, INSTRUCTION FILE UNAVALIABLE!!!!\n");
+        return false;
     }
 
+    /*Read the binary straight into ram, whatever does not fit is dropped*/
+    size_t read = fread(ram->data, 1, ram->size, asmFile);
+    (void)read;
+
     /*Close file when done*/
     fclose(asmFile);
+    return true;
+}
 
+uint8_t *ramPointer(const ram_t *ram, uint32_t address, uint32_t bytes){
+    if (((uint64_t)address + bytes) > ram->size) {
+        return NULL;
+    }
+    return ram->data + address;
 }
 
-uint32_t fetchInstruction(int program){
-    return 5;
-}
\ No newline at end of file
+uint32_t fetchInstruction(ram_t *ram, uint32_t address){
+    uint32_t value = 0;
+    if (!loadMemory(ram, address, 4, false, &value)) {
+        printf("Instruction fetch outside of ram: %08X\n", address);
+    }
+    return value;
+}
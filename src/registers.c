@@ -2,14 +2,15 @@
 #include <stdlib.h>
 
 
-/* Create regFile object */
-registerFile regFile;
-
-    
 void initRegFile(registerFile *regFile){
     regFile->generalRegisters = (uint32_t*)calloc(32, sizeof(uint32_t));
 }
 
+void cleanRegFile(registerFile *regFile){
+    free(regFile->generalRegisters);
+    regFile->generalRegisters = NULL;
+}
+
 
 /**
  * void initRegFile(registerFile *regFile){
@@ -0,0 +1,266 @@
+#include "riscvsim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim.h"
+#include "clock.h"
+#include "fetch.h"
+#include "interpreter.h"
+#include "loadProgram.h"
+
+void sim_default_config(sim_config *config) {
+    memset(config, 0, sizeof(*config));
+    config->mode = SIM_MODE_DETAILED;
+    config->ram_bytes = RAM_SIZE_BYTES;
+    config->misaligned = SIM_MISALIGNED_SPLIT;
+    config->isa = NULL;
+    config->vlen = 128;
+    config->uart_fd = STDOUT_FILENO;
+    config->disk_image = NULL;
+    config->wfi_sleep_hz = 0;
+    config->stats_name = NULL;
+    config->stats_interval = 100000;
+    config->fusion = true;
+    config->fetch_width = timingDefaults.fetchWidth;
+    config->fetch_queue_depth = timingDefaults.fetchQueueDepth;
+    config->pipeline_layout = SIM_PIPELINE_PER_STAGE;
+    config->pipeline_cpus = NULL;
+    config->issue_width = 0;
+    config->rob_entries = oooDefaults.robEntries;
+    config->rs_entries = oooDefaults.rsEntries;
+    config->phys_regs = oooDefaults.physRegs;
+    config->fast_forward = samplerDefaults.fastForward;
+    config->start_pc = samplerDefaults.startPc;
+    config->warmup = samplerDefaults.warmup;
+    config->detail = samplerDefaults.detail;
+    config->period = samplerDefaults.period;
+}
+
+sim_t *sim_create(const sim_config *config) {
+    sim_config defaults;
+    timingConfig timingCfg = timingDefaults;
+    uint32_t extensions = ISA_ALL;
+    sim_t *sim;
+
+    if (config == NULL) {
+        sim_default_config(&defaults);
+        config = &defaults;
+    }
+    timingCfg.outOfOrder = config->issue_width != 0;
+    timingCfg.ooo = oooDefaults;
+    timingCfg.ooo.issueWidth = config->issue_width;
+    timingCfg.ooo.units[FU_ALU] = config->issue_width;
+    timingCfg.ooo.robEntries = config->rob_entries;
+    timingCfg.ooo.rsEntries = config->rs_entries;
+    timingCfg.ooo.physRegs = config->phys_regs;
+    if (timingCfg.outOfOrder && !oooConfigValid(&timingCfg.ooo)) {
+        fprintf(stderr, "Unsupported issue width %u, ROB %u, RS %u or %u physical registers, needs a width up to %d, "
+                "ROB and RS of 1 to %d entries and 33 to %d registers\n", config->issue_width, config->rob_entries,
+                config->rs_entries, config->phys_regs, OOO_MAX_WIDTH, OOO_MAX_ENTRIES, 32 + OOO_MAX_ENTRIES);
+        return NULL;
+    }
+    if (config->isa != NULL && !isaParse(config->isa, &extensions)) {
+        fprintf(stderr, "Unsupported ISA %s\n", config->isa);
+        return NULL;
+    }
+    if (config->fetch_width == 0 || config->fetch_queue_depth < config->fetch_width ||
+        config->fetch_queue_depth > FETCH_QUEUE_MAX) {
+        fprintf(stderr, "Unsupported fetch width %u and queue depth %u, needs 1 <= width <= depth <= %d\n",
+                config->fetch_width, config->fetch_queue_depth, FETCH_QUEUE_MAX);
+        return NULL;
+    }
+    sim = (sim_t *)calloc(1, sizeof(*sim));
+    if (sim == NULL) {
+        return NULL;
+    }
+    pipelineInit(sim);
+    fetchInit();
+    if (!pipelineConfigure(sim, config->pipeline_layout, config->pipeline_cpus)) {
+        fprintf(stderr, "Bad CPU list %s, needs up to %d comma separated CPU numbers\n", config->pipeline_cpus, STAGE_COUNT);
+        sim_destroy(sim);
+        return NULL;
+    }
+
+    sim->mode = config->mode;
+    sim->wfiSleepHz = config->wfi_sleep_hz;
+    sim->fusion = config->fusion;
+    sim->core = isaSelectCore(extensions);
+    sim->isaForced = config->isa != NULL;
+    sim->sampler = samplerDefaults;
+    sim->sampler.fastForward = config->fast_forward;
+    sim->sampler.startPc = config->start_pc;
+    sim->sampler.warmup = config->warmup;
+    sim->sampler.detail = config->detail;
+    sim->sampler.period = config->period;
+
+    initRegFile(&sim->regFile);
+    initFpRegFile(&sim->fpRegFile);
+    initCsrs(&sim->csrs);
+    timingCfg.fetchWidth = config->fetch_width;
+    timingCfg.fetchQueueDepth = config->fetch_queue_depth;
+    if (!timingInit(&sim->timing, &timingCfg)) {
+        fprintf(stderr, "Out of memory for the timing model\n");
+        sim_destroy(sim);
+        return NULL;
+    }
+    if (!vectorInit(&sim->vector, config->vlen)) {
+        fprintf(stderr, "Unsupported VLEN %u, needs a power of two from %d to %d\n", config->vlen, VLEN_MIN, VLEN_MAX);
+        sim_destroy(sim);
+        return NULL;
+    }
+    if (sim->regFile.generalRegisters == NULL || config->ram_bytes < sizeof(uint32_t) ||
+        !initRam(&sim->mainMemory, config->ram_bytes)) {
+        sim_destroy(sim);
+        return NULL;
+    }
+
+    /* Physical address map */
+    busInit(&sim->bus, &sim->mainMemory);
+    uartInit(&sim->uart, &sim->bus, UART_BASE, config->uart_fd);
+    clockInit(sim);
+    clintInit(sim, CLINT_BASE);
+    if (config->disk_image != NULL &&
+        !blockDeviceInit(&sim->disk, &sim->bus, BLOCK_DEVICE_BASE, config->disk_image)) {
+        sim_destroy(sim);
+        return NULL;
+    }
+    mmuInit(&sim->mmu, &sim->csrs, &sim->bus);
+    sim->mmu.trapMisaligned = config->misaligned == SIM_MISALIGNED_TRAP;
+    if (config->stats_name != NULL && !statsExportOpen(sim, config->stats_name, config->stats_interval)) {
+        sim_destroy(sim);
+        return NULL;
+    }
+
+    /* Stack grows down from the top of ram */
+    sim->regFile.programCounter = 0;
+    sim->regFile.generalRegisters[2] = (uint32_t)sim->mainMemory.size - 16;
+    return sim;
+}
+
+bool sim_load_elf(sim_t *sim, const char *path) {
+    uint32_t entry;
+    uint32_t extensions;
+    char arch[256];
+
+    if (!loadElf(path, &sim->mainMemory, &entry)) {
+        return false;
+    }
+    if (!sim->isaForced && elfArchString(path, arch, sizeof(arch))) {
+        if (isaParse(arch, &extensions)) {
+            sim->core = isaSelectCore(extensions);
+        } else {
+            fprintf(stderr, "Unsupported ISA %s, running on the %s core\n", arch, sim->core->name);
+        }
+    }
+    sim->regFile.programCounter = entry;
+    return true;
+}
+
+bool sim_load_binary(sim_t *sim, const char *path) {
+    return populateRAM(path, &sim->mainMemory);
+}
+
+uint64_t sim_run(sim_t *sim, uint64_t n_instructions) {
+    uint64_t start = sim->instructionsRetired;
+
+    statsPublish(sim, STATS_RUNNING);
+    switch (sim->mode) {
+        case SIM_MODE_FUNCTIONAL:
+            interpRun(sim, n_instructions, INTERP_FUNCTIONAL, NO_STOP_PC);
+            break;
+        case SIM_MODE_DETAILED:
+            pipelineRun(sim, n_instructions);
+            break;
+        case SIM_MODE_SAMPLED: {
+            /* Every call starts a new sampling schedule bounded by n_instructions */
+            samplerConfig cfg = sim->sampler;
+            cfg.maxInstructions = n_instructions > UINT64_MAX - start ? 0 : start + n_instructions;
+            runSampled(sim, &cfg, &sim->samplerResult);
+            break;
+        }
+        case SIM_MODE_DECOUPLED:
+            runDecoupled(sim, n_instructions);
+            break;
+    }
+    uartFlush(&sim->uart);
+    statsPublish(sim, sim->halted ? STATS_HALTED : STATS_PAUSED);
+    return sim->instructionsRetired - start;
+}
+
+uint32_t sim_read_reg(const sim_t *sim, unsigned reg) {
+    if (reg < 32) {
+        return sim->regFile.generalRegisters[reg];
+    }
+    return reg == SIM_REG_PC ? sim->regFile.programCounter : 0;
+}
+
+bool sim_read_mem(const sim_t *sim, uint32_t address, void *buffer, size_t bytes) {
+    const uint8_t *source = bytes <= UINT32_MAX ? ramPointer(&sim->mainMemory, address, (uint32_t)bytes) : NULL;
+    if (source == NULL) {
+        return false;
+    }
+    memcpy(buffer, source, bytes);
+    return true;
+}
+
+bool sim_halted(const sim_t *sim) {
+    return sim->halted;
+}
+
+int sim_exit_code(const sim_t *sim) {
+    return sim->exitCode;
+}
+
+uint64_t sim_instructions_retired(const sim_t *sim) {
+    return sim->instructionsRetired;
+}
+
+bool sim_fuzz_start(sim_t *sim, uint8_t *coverage, uint64_t max_instructions) {
+    return fuzzStart(sim, coverage, max_instructions);
+}
+
+sim_fuzz_result sim_fuzz_run(sim_t *sim, const void *input, size_t bytes, uint64_t max_instructions) {
+    return fuzzRun(sim, input, bytes, max_instructions);
+}
+
+void sim_print_stats(const sim_t *sim) {
+    switch (sim->mode) {
+        case SIM_MODE_FUNCTIONAL:
+            printf("Instructions:          %llu\n", (unsigned long long)sim->instructionsRetired);
+            break;
+        case SIM_MODE_DETAILED:
+        case SIM_MODE_DECOUPLED:
+            printTimingStats(&sim->timing.totals);
+            if (sim->timing.cfg.outOfOrder) {
+                printOutOfOrderStats(&sim->timing.cfg.ooo, &sim->timing.totals);
+            }
+            break;
+        case SIM_MODE_SAMPLED:
+            printSamplerResult(&sim->samplerResult);
+            printTimingStats(&sim->timing.totals);
+            if (sim->timing.cfg.outOfOrder) {
+                printOutOfOrderStats(&sim->timing.cfg.ooo, &sim->timing.totals);
+            }
+            break;
+    }
+    if (sim->wfiSkippedCycles != 0) {
+        printf("Idle cycles skipped:   %llu\n", (unsigned long long)sim->wfiSkippedCycles);
+    }
+    printOpcodeMix(&sim->mix);
+}
+
+void sim_destroy(sim_t *sim) {
+    if (sim == NULL) {
+        return;
+    }
+    cleanup(sim);
+    statsExportClose(sim);
+    uartFlush(&sim->uart);
+    decoupledCleanup(&sim->retire);
+    timingCleanup(&sim->timing);
+    blockDeviceCleanup(&sim->disk);
+    cleanRam(&sim->mainMemory);
+    cleanRegFile(&sim->regFile);
+    free(sim);
+}
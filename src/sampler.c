@@ -0,0 +1,122 @@
+#include "sampler.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "controlUnit.h"
+#include "interpreter.h"
+#include "sim.h"
+
+/* Two sided 95% Student t quantiles for 1 to 30 degrees of freedom */
+static const double tQuantiles[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+#define CONFIDENCE_Z 1.959964
+
+/* Past the table the Cornish-Fisher expansion around the normal quantile is exact to three decimals */
+static double tQuantile(uint64_t degrees) {
+    const double z = CONFIDENCE_Z;
+    double v = (double)degrees;
+
+    if (degrees <= sizeof(tQuantiles) / sizeof(tQuantiles[0])) {
+        return tQuantiles[degrees - 1];
+    }
+    return z + (z * z * z + z) / (4.0 * v) + (5.0 * pow(z, 5) + 16.0 * z * z * z + 3.0 * z) / (96.0 * v * v);
+}
+
+const samplerConfig samplerDefaults = {
+    .fastForward = 0,
+    .startPc = NO_STOP_PC,
+    .warmup = 10000,
+    .detail = 1000,
+    .period = 1000000,
+    .maxInstructions = 0,
+};
+
+/* How many more instructions may run before maxInstructions is reached */
+static uint64_t remaining(const sim_t *sim, const samplerConfig *cfg, uint64_t n) {
+    if (cfg->maxInstructions == 0) {
+        return n;
+    }
+    if (sim->instructionsRetired >= cfg->maxInstructions) {
+        return 0;
+    }
+    uint64_t left = cfg->maxInstructions - sim->instructionsRetired;
+    return n < left ? n : left;
+}
+
+void runSampled(sim_t *sim, const samplerConfig *cfg, samplerResult *result) {
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    uint64_t skip = 0;
+
+    memset(result, 0, sizeof(*result));
+
+    /* Fast-forward to the region of interest */
+    interpRun(sim, remaining(sim, cfg, cfg->fastForward), INTERP_FUNCTIONAL, NO_STOP_PC);
+    if (cfg->startPc != NO_STOP_PC) {
+        interpRun(sim, remaining(sim, cfg, UINT64_MAX), INTERP_FUNCTIONAL, cfg->startPc);
+    }
+
+    if (cfg->period > cfg->warmup + cfg->detail) {
+        skip = cfg->period - cfg->warmup - cfg->detail;
+    }
+
+    while (!sim->halted && remaining(sim, cfg, 1) > 0) {
+        interpRun(sim, remaining(sim, cfg, cfg->warmup), INTERP_WARM, NO_STOP_PC);
+
+        uint64_t cyclesBefore = sim->timing.totals.cycles;
+        uint64_t measured = pipelineRun(sim, remaining(sim, cfg, cfg->detail));
+        if (measured == 0) {
+            break;
+        }
+        double cpi = (double)(sim->timing.totals.cycles - cyclesBefore) / measured;
+        sum += cpi;
+        sumSquares += cpi * cpi;
+        result->samples++;
+        result->detailedInstructions += measured;
+
+        interpRun(sim, remaining(sim, cfg, skip), INTERP_FUNCTIONAL, NO_STOP_PC);
+    }
+
+    result->instructions = sim->instructionsRetired;
+    if (result->samples == 0) {
+        return;
+    }
+
+    /* Sample mean, and its confidence interval once there are two samples to estimate the spread from */
+    double n = (double)result->samples;
+    result->meanCpi = sum / n;
+    result->cpiLow = result->meanCpi;
+    result->cpiHigh = result->meanCpi;
+    result->estimatedCycles = result->meanCpi * result->instructions;
+    if (result->samples < 2) {
+        return;
+    }
+    double variance = (sumSquares - n * result->meanCpi * result->meanCpi) / (n - 1);
+    result->stddevCpi = variance > 0.0 ? sqrt(variance) : 0.0;
+    double margin = tQuantile(result->samples - 1) * result->stddevCpi / sqrt(n);
+    result->cpiLow = result->meanCpi - margin;
+    result->cpiHigh = result->meanCpi + margin;
+    result->hasInterval = true;
+}
+
+void printSamplerResult(const samplerResult *result) {
+    printf("Instructions:          %llu\n", (unsigned long long)result->instructions);
+    printf("Samples:               %llu (%llu detailed instructions)\n",
+           (unsigned long long)result->samples, (unsigned long long)result->detailedInstructions);
+    if (result->samples == 0) {
+        printf("No samples taken, the program is shorter than the fast-forward window\n");
+        return;
+    }
+    if (!result->hasInterval) {
+        printf("CPI:                   %.4f (one sample, no confidence interval)\n", result->meanCpi);
+        printf("Estimated cycles:      %.0f\n", result->estimatedCycles);
+        return;
+    }
+    printf("CPI:                   %.4f +/- %.4f (95%% CI %.4f .. %.4f)\n", result->meanCpi,
+           result->cpiHigh - result->meanCpi, result->cpiLow, result->cpiHigh);
+    printf("Estimated cycles:      %.0f (%.0f .. %.0f)\n", result->estimatedCycles,
+           result->cpiLow * result->instructions, result->cpiHigh * result->instructions);
+}
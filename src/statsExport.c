@@ -0,0 +1,152 @@
+#include "statsExport.h"
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "sim.h"
+
+/* Makes the sequence odd, the stores that follow are not visible to a reader that copied before */
+static uint32_t writeBegin(simStatsBlock *block) {
+    uint32_t sequence = atomic_load_explicit(&block->sequence, memory_order_relaxed);
+    atomic_store_explicit(&block->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return sequence;
+}
+
+static void writeEnd(simStatsBlock *block, uint32_t sequence) {
+    atomic_store_explicit(&block->sequence, sequence + 2, memory_order_release);
+}
+
+/* The counters that move while running. Cache, predictor and out-of-order totals wait for a pause */
+static void writeCounters(simStatsBlock *block, const sim_t *sim) {
+    const timingStats *totals = &sim->timing.totals;
+
+    block->pc = sim->regFile.programCounter;
+    block->clock = sim->clockNow;
+    block->instructions = sim->instructionsRetired;
+    block->idleCycles = sim->wfiSkippedCycles;
+    /* The timing thread owns the totals while a decoupled run is in progress */
+    if (sim->mode == SIM_MODE_DECOUPLED) {
+        return;
+    }
+    block->timing.cycles = totals->cycles;
+    block->timing.instructions = totals->instructions;
+    block->timing.icacheStalls = totals->icacheStalls;
+    block->timing.dcacheStalls = totals->dcacheStalls;
+    block->timing.branchStalls = totals->branchStalls;
+    block->timing.fetchStalls = totals->fetchStalls;
+    block->timing.loadUseStalls = totals->loadUseStalls;
+    block->timing.mulDivStalls = totals->mulDivStalls;
+}
+
+static void publishFired(void *arg) {
+    sim_t *sim = (sim_t *)arg;
+    simStatsBlock *block = sim->stats.block;
+    uint32_t sequence = writeBegin(block);
+    writeCounters(block, sim);
+    writeEnd(block, sequence);
+    eventSchedule(&sim->events, &sim->stats.event, sim->clockNow + sim->stats.interval);
+}
+
+bool statsExportOpen(sim_t *sim, const char *name, uint64_t interval) {
+    statsExport *stats = &sim->stats;
+    simStatsBlock *block;
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("shm_open");
+        return false;
+    }
+    if (ftruncate(fd, sizeof(simStatsBlock)) != 0) {
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+    block = (simStatsBlock *)mmap(NULL, sizeof(simStatsBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (block == MAP_FAILED) {
+        perror("mmap");
+        shm_unlink(name);
+        return false;
+    }
+
+    /* A stale object left by a crashed run is reused, readers see the magic go away meanwhile */
+    atomic_store_explicit(&block->magic, 0, memory_order_relaxed);
+    block->version = SIM_STATS_VERSION;
+    atomic_store_explicit(&block->sequence, 0, memory_order_relaxed);
+    block->pid = (uint32_t)getpid();
+    stats->block = block;
+    stats->name = strdup(name);
+    stats->interval = interval != 0 ? interval : 1;
+    statsPublish(sim, STATS_PAUSED);
+    atomic_store_explicit(&block->magic, SIM_STATS_MAGIC, memory_order_release);
+
+    stats->event.callback = publishFired;
+    stats->event.arg = sim;
+    stats->event.scheduled = false;
+    stats->event.background = true;
+    stats->event.next = NULL;
+    eventSchedule(&sim->events, &stats->event, sim->clockNow + stats->interval);
+    return true;
+}
+
+void statsPublish(sim_t *sim, statsState state) {
+    simStatsBlock *block = sim->stats.block;
+    if (block == NULL) {
+        return;
+    }
+    uint32_t sequence = writeBegin(block);
+
+    block->mode = (uint32_t)sim->mode;
+    block->state = (uint32_t)state;
+    block->exitCode = sim->exitCode;
+    if (state == STATS_RUNNING) {
+        writeCounters(block, sim);
+    } else {
+        block->pc = sim->regFile.programCounter;
+        block->clock = sim->clockNow;
+        block->instructions = sim->instructionsRetired;
+        block->idleCycles = sim->wfiSkippedCycles;
+        block->timing = sim->timing.totals;
+    }
+
+    writeEnd(block, sequence);
+}
+
+void statsExportClose(sim_t *sim) {
+    statsExport *stats = &sim->stats;
+    if (stats->block == NULL) {
+        return;
+    }
+    eventCancel(&sim->events, &stats->event);
+    statsPublish(sim, STATS_CLOSED);
+    munmap(stats->block, sizeof(simStatsBlock));
+    shm_unlink(stats->name);
+    free(stats->name);
+    stats->block = NULL;
+    stats->name = NULL;
+}
+
+void statsSnapshot(const simStatsBlock *block, simStatsBlock *out) {
+    simStatsBlock *shared = (simStatsBlock *)block;
+    uint32_t before;
+    uint32_t after;
+
+    for (;;) {
+        before = atomic_load_explicit(&shared->sequence, memory_order_acquire);
+        if (before & 1) {
+            sched_yield();
+            continue;
+        }
+        memcpy(out, block, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&shared->sequence, memory_order_relaxed);
+        if (before == after) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,426 @@
+#include "timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "controlUnit.h"
+#include "fpu.h"
+
+const timingConfig timingDefaults = {
+    .icache = { .sets = 64, .ways = 2, .lineBytes = 32 },
+    .dcache = { .sets = 64, .ways = 4, .lineBytes = 32 },
+    .predictorEntries = 1024,
+    .btbEntries = 256,
+    .fetchWidth = 4,
+    .fetchQueueDepth = 8,
+    .missPenalty = 20,
+    .mispredictPenalty = 2,
+    .loadUsePenalty = 1,
+    .mulLatency = 2,
+    .divLatency = 32,
+    .fpLatency = 4,
+    .fpDivLatency = 20,
+    .outOfOrder = false,
+};
+
+static uint32_t log2u(uint32_t value) {
+    uint32_t shift = 0;
+    while ((1u << shift) < value) {
+        shift++;
+    }
+    return shift;
+}
+
+static void initCache(cacheModel *cache, const cacheConfig *cfg) {
+    cache->cfg = *cfg;
+    cache->tags = (uint32_t*)calloc(cfg->sets * cfg->ways, sizeof(uint32_t));
+    cache->lastUse = (uint32_t*)calloc(cfg->sets * cfg->ways, sizeof(uint32_t));
+    cache->clock = 0;
+    cache->lineShift = log2u(cfg->lineBytes);
+}
+
+static void cleanCache(cacheModel *cache) {
+    free(cache->tags);
+    free(cache->lastUse);
+    cache->tags = NULL;
+    cache->lastUse = NULL;
+}
+
+/* Returns true on a hit, allocates the line over the LRU way on a miss */
+static bool cacheAccess(cacheModel *cache, uint32_t address) {
+    uint32_t line = address >> cache->lineShift;
+    uint32_t set = line & (cache->cfg.sets - 1);
+    uint32_t *tags = &cache->tags[set * cache->cfg.ways];
+    uint32_t *lastUse = &cache->lastUse[set * cache->cfg.ways];
+    uint32_t victim = 0;
+
+    cache->clock++;
+    for (uint32_t way = 0; way < cache->cfg.ways; way++) {
+        if (tags[way] == line + 1) {
+            lastUse[way] = cache->clock;
+            return true;
+        }
+        if (lastUse[way] < lastUse[victim]) {
+            victim = way;
+        }
+    }
+    tags[victim] = line + 1;
+    lastUse[victim] = cache->clock;
+    return false;
+}
+
+/* Longest result latency unitOf hands the out-of-order backend */
+static uint32_t longestLatency(const timingConfig *cfg) {
+    uint32_t latencies[] = {
+        1 + cfg->loadUsePenalty + cfg->missPenalty, cfg->mulLatency, cfg->divLatency, cfg->fpLatency,
+        cfg->fpDivLatency,
+    };
+    uint32_t longest = 1;
+
+    for (size_t i = 0; i < sizeof(latencies) / sizeof(latencies[0]); i++) {
+        if (latencies[i] > longest) {
+            longest = latencies[i];
+        }
+    }
+    return longest;
+}
+
+bool timingInit(timingModel *model, const timingConfig *cfg) {
+    model->cfg = *cfg;
+    initCache(&model->icache, &cfg->icache);
+    initCache(&model->dcache, &cfg->dcache);
+    model->predictor = (uint8_t*)malloc(cfg->predictorEntries);
+    if (model->predictor != NULL) {
+        memset(model->predictor, 1, cfg->predictorEntries); /* Weakly not taken */
+    }
+    model->btbTags = (uint32_t*)calloc(cfg->btbEntries, sizeof(uint32_t));
+    model->btbTargets = (uint32_t*)calloc(cfg->btbEntries, sizeof(uint32_t));
+    model->lastLoadRd = 0;
+    model->clock = 0;
+    model->fetchClock = 0;
+    model->blockReady = 0;
+    model->blockMiss = 0;
+    model->blockMispredict = false;
+    model->redirectMispredict = false;
+    model->blockLine = 0;
+    model->blockLeft = 0;
+    model->expectedPc = 0;
+    model->issued = (uint64_t*)calloc(cfg->fetchQueueDepth, sizeof(uint64_t));
+    model->sequence = 0;
+    memset(&model->ooo, 0, sizeof(model->ooo));
+    memset(&model->totals, 0, sizeof(model->totals));
+    if (cfg->outOfOrder && !oooInit(&model->ooo, &cfg->ooo, longestLatency(cfg))) {
+        return false;
+    }
+    return model->icache.tags != NULL && model->icache.lastUse != NULL && model->dcache.tags != NULL &&
+           model->dcache.lastUse != NULL && model->predictor != NULL && model->btbTags != NULL &&
+           model->btbTargets != NULL && model->issued != NULL;
+}
+
+void timingCleanup(timingModel *model) {
+    cleanCache(&model->icache);
+    cleanCache(&model->dcache);
+    free(model->predictor);
+    free(model->btbTags);
+    free(model->btbTargets);
+    free(model->issued);
+    model->issued = NULL;
+    oooCleanup(&model->ooo);
+    model->predictor = NULL;
+    model->btbTags = NULL;
+    model->btbTargets = NULL;
+}
+
+void makeRetiredInstr(const decoder_to_execute *ex, retiredInstr *rec) {
+    rec->pc = ex->pc;
+    rec->nextPc = ex->nextPc;
+    rec->memAddress = ex->memAddress;
+    rec->microOp = ex->microOp;
+    rec->rd = ex->writesRd ? ex->rd : 0;
+    rec->rs1 = ex->rs1;
+    rec->rs2 = ex->rs2;
+    rec->length = ex->length;
+    rec->branchTaken = ex->branchTaken;
+}
+
+static inline bool isLoad(uint8_t op) {
+    return (op >= OP_LB && op <= OP_LHU) || (op >= OP_LRW && op <= OP_AMOMINUW) || op == OP_AUIPC_LW;
+}
+
+static inline bool isStore(uint8_t op) {
+    return op >= OP_SB && op <= OP_SW;
+}
+
+static inline bool isVectorMemory(uint8_t op) {
+    return op >= OP_VLE && op <= OP_VSM;
+}
+
+static inline bool isMemory(uint8_t op) {
+    return isLoad(op) || isStore(op) || isVectorMemory(op) || isFloatMemoryOp(op);
+}
+
+/* Float ops that go through the pipelined FPU, sign injection, moves and compares are single cycle */
+static inline bool isFloatPipelined(uint8_t op) {
+    uint8_t single = op >= OP_FMADD_D && op <= OP_FCVT_D_WU ? (uint8_t)(op - (OP_FMADD_D - OP_FMADD_S)) : op;
+    return (single >= OP_FMADD_S && single <= OP_FMUL_S) || single == OP_FCVT_W_S || single == OP_FCVT_WU_S ||
+           single == OP_FCVT_S_W || single == OP_FCVT_S_WU || op == OP_FCVT_S_D || op == OP_FCVT_D_S;
+}
+
+static inline bool isControl(uint8_t op) {
+    return (op >= OP_BEQ && op <= OP_JALR) || op == OP_AUIPC_JALR;
+}
+
+/* Fetch waits for these to retire before it continues */
+static inline bool isSerializing(uint8_t op) {
+    return op >= OP_ECALL && op <= OP_WFI;
+}
+
+static inline bool isFloatDivide(uint8_t op) {
+    return op == OP_FDIV_S || op == OP_FSQRT_S || op == OP_FDIV_D || op == OP_FSQRT_D;
+}
+
+/* Unit class and result latency on the out-of-order backend, stores complete into a store buffer */
+static fuClass unitOf(const timingConfig *cfg, uint8_t op, bool dataMiss, uint32_t *latency) {
+    if (isMemory(op)) {
+        bool store = isStore(op) || op == OP_FSW || op == OP_FSD || (op >= OP_VSE && op <= OP_VSM);
+        *latency = store ? 1 : 1 + cfg->loadUsePenalty + (dataMiss ? cfg->missPenalty : 0);
+        return FU_MEM;
+    }
+    if (op >= OP_MUL && op <= OP_MULU) {
+        *latency = cfg->mulLatency;
+        return FU_MUL;
+    }
+    if (op >= OP_DIV && op <= OP_REMU) {
+        *latency = cfg->divLatency;
+        return FU_DIV;
+    }
+    if (isFloatDivide(op)) {
+        *latency = cfg->fpDivLatency;
+        return FU_FP_DIV;
+    }
+    if (isFloatOp(op)) {
+        *latency = isFloatPipelined(op) ? cfg->fpLatency : 1;
+        return FU_FP;
+    }
+    *latency = 1;
+    return FU_ALU;
+}
+
+uint32_t timingPredictNext(const timingModel *model, uint32_t pc, uint8_t length, bool conditional) {
+    uint32_t index = (pc >> 1) & (model->cfg.predictorEntries - 1);
+    uint32_t btbIndex = (pc >> 1) & (model->cfg.btbEntries - 1);
+    bool predictTaken = conditional ? model->predictor[index] >= 2 : true;
+
+    if (predictTaken && model->btbTags[btbIndex] == pc + 1) {
+        return model->btbTargets[btbIndex];
+    }
+    return pc + length;
+}
+
+/* Starts a fetch block at pc once the fetch unit is free and the queue has room for all of it */
+static void fetchBlock(timingModel *model, uint32_t pc, timingStats *stalls) {
+    const timingConfig *cfg = &model->cfg;
+    uint64_t start = model->fetchClock;
+    uint64_t end = model->sequence + cfg->fetchWidth;
+
+    if (end > cfg->fetchQueueDepth) {
+        uint64_t freed = model->issued[(end - cfg->fetchQueueDepth - 1) % cfg->fetchQueueDepth];
+        if (freed > start) {
+            start = freed;
+        }
+    }
+    model->blockMiss = 0;
+    if (!cacheAccess(&model->icache, pc)) {
+        stalls->icacheMisses++;
+        model->blockMiss = cfg->missPenalty;
+    }
+    model->blockReady = start + 1 + model->blockMiss;
+    model->fetchClock = model->blockReady;
+    model->blockLine = pc >> model->icache.lineShift;
+    model->blockLeft = cfg->fetchWidth;
+    model->blockMispredict = model->redirectMispredict;
+    model->redirectMispredict = false;
+}
+
+/* Shared by warming and accounting, fills the stall breakdown of this instruction
+   @return Cycles the model's clock advanced */
+static uint64_t simulate(timingModel *model, const retiredInstr *rec, timingStats *stalls) {
+    const timingConfig *cfg = &model->cfg;
+    uint8_t *predictor = model->predictor;
+    uint64_t before = cfg->outOfOrder ? model->ooo.commitCycle : model->clock;
+    uint64_t issue = model->clock;
+    uint64_t resolved;       /* Cycle a branch outcome is known */
+    uint64_t retired;        /* Cycle everything up to this instruction has retired */
+    bool dataMiss = false;
+
+    /* Frontend. Anything but the predicted path is a trap or a return from one, fetch restarts
+       once the previous instruction has retired */
+    if (rec->pc != model->expectedPc) {
+        model->fetchClock = model->clock;
+        model->blockLeft = 0;
+        model->redirectMispredict = false;
+    }
+    if (model->blockLeft == 0 || (rec->pc >> model->icache.lineShift) != model->blockLine) {
+        fetchBlock(model, rec->pc, stalls);
+    }
+    model->blockLeft--;
+
+    /* Decode waits on an empty queue, the miss is charged first and the rest to what emptied it */
+    if (model->blockReady > issue) {
+        uint64_t wait = model->blockReady - issue;
+        uint64_t miss = wait < model->blockMiss ? wait : model->blockMiss;
+
+        stalls->icacheStalls += miss;
+        if (model->blockMispredict) {
+            stalls->branchStalls += wait - miss;
+        } else {
+            stalls->fetchStalls += wait - miss;
+        }
+        issue = model->blockReady;
+    }
+
+    /* Data cache */
+    if (isMemory(rec->microOp) && !cacheAccess(&model->dcache, rec->memAddress)) {
+        stalls->dcacheMisses++;
+        dataMiss = true;
+    }
+
+    if (cfg->outOfOrder) {
+        /* The next instruction may dispatch in the same cycle, the backend enforces the width */
+        uint32_t latency;
+        fuClass unit = unitOf(cfg, rec->microOp, dataMiss, &latency);
+        oooTimes times;
+
+        oooSchedule(&model->ooo, rec->rd, rec->rs1, rec->rs2, unit, latency, isSerializing(rec->microOp),
+                    issue, &stalls->ooo, &times);
+        issue = times.dispatch;
+        model->clock = times.dispatch;
+        resolved = times.complete;
+        retired = times.commit;
+    } else {
+        /* Load-use hazard against the previous instruction */
+        if (model->lastLoadRd != 0 && (rec->rs1 == model->lastLoadRd || rec->rs2 == model->lastLoadRd)) {
+            stalls->loadUseStalls += cfg->loadUsePenalty;
+        }
+        model->lastLoadRd = isLoad(rec->microOp) ? rec->rd : 0;
+        if (dataMiss) {
+            stalls->dcacheStalls += cfg->missPenalty;
+        }
+
+        /* Multi-cycle execute */
+        if (rec->microOp >= OP_MUL && rec->microOp <= OP_MULU) {
+            stalls->mulDivStalls += cfg->mulLatency - 1;
+        } else if (rec->microOp >= OP_DIV && rec->microOp <= OP_REMU) {
+            stalls->mulDivStalls += cfg->divLatency - 1;
+        } else if (isFloatDivide(rec->microOp)) {
+            stalls->mulDivStalls += cfg->fpDivLatency - 1;
+        } else if (isFloatPipelined(rec->microOp)) {
+            stalls->mulDivStalls += cfg->fpLatency - 1;
+        }
+
+        model->clock = issue + 1 + stalls->dcacheStalls + stalls->loadUseStalls + stalls->mulDivStalls;
+        resolved = model->clock;
+        retired = model->clock;
+    }
+    model->issued[model->sequence % cfg->fetchQueueDepth] = issue;
+    model->sequence++;
+    model->expectedPc = rec->nextPc;
+
+    /* Branch prediction: bimodal direction plus BTB target. Fetch followed the prediction, so a
+       predicted taken branch ends the block and a mispredict refetches once the branch resolves,
+       mispredictPenalty cycles after it would have issued the next instruction */
+    if (isControl(rec->microOp)) {
+        uint32_t index = (rec->pc >> 1) & (cfg->predictorEntries - 1);
+        uint32_t btbIndex = (rec->pc >> 1) & (cfg->btbEntries - 1);
+        bool conditional = rec->microOp <= OP_BGEU;
+        uint32_t predictedPc = timingPredictNext(model, rec->pc, rec->length, conditional);
+
+        if (predictedPc != rec->nextPc) {
+            stalls->mispredicts++;
+            model->fetchClock = resolved - 1 + cfg->mispredictPenalty;
+            model->blockLeft = 0;
+            model->redirectMispredict = true;
+        } else if (rec->nextPc != rec->pc + rec->length) {
+            model->blockLeft = 0;
+        }
+
+        if (conditional) {
+            if (rec->branchTaken && predictor[index] < 3) {
+                predictor[index]++;
+            } else if (!rec->branchTaken && predictor[index] > 0) {
+                predictor[index]--;
+            }
+        }
+        if (rec->branchTaken) {
+            model->btbTags[btbIndex] = rec->pc + 1;
+            model->btbTargets[btbIndex] = rec->nextPc;
+        }
+    } else if (isSerializing(rec->microOp)) {
+        model->fetchClock = retired;
+        model->blockLeft = 0;
+    }
+    return (cfg->outOfOrder ? model->ooo.commitCycle : model->clock) - before;
+}
+
+void timingWarm(timingModel *model, const retiredInstr *rec) {
+    timingStats discard = {0};
+    simulate(model, rec, &discard);
+}
+
+uint32_t timingAccount(timingModel *model, const retiredInstr *rec) {
+    timingStats *totals = &model->totals;
+    timingStats delta = {0};
+    uint32_t cycles = (uint32_t)simulate(model, rec, &delta);
+
+    totals->cycles += cycles;
+    totals->instructions++;
+    totals->icacheMisses += delta.icacheMisses;
+    totals->dcacheMisses += delta.dcacheMisses;
+    totals->mispredicts += delta.mispredicts;
+    totals->icacheStalls += delta.icacheStalls;
+    totals->dcacheStalls += delta.dcacheStalls;
+    totals->branchStalls += delta.branchStalls;
+    totals->fetchStalls += delta.fetchStalls;
+    totals->loadUseStalls += delta.loadUseStalls;
+    totals->mulDivStalls += delta.mulDivStalls;
+    totals->ooo.robCycles += delta.ooo.robCycles;
+    totals->ooo.robStalls += delta.ooo.robStalls;
+    totals->ooo.rsStalls += delta.ooo.rsStalls;
+    totals->ooo.renameStalls += delta.ooo.renameStalls;
+    for (int unit = 0; unit < FU_CLASSES; unit++) {
+        totals->ooo.unitBusy[unit] += delta.ooo.unitBusy[unit];
+    }
+    return cycles;
+}
+
+void printTimingStats(const timingStats *stats) {
+    double cpi = stats->instructions ? (double)stats->cycles / stats->instructions : 0.0;
+    printf("Detailed instructions: %llu\n", (unsigned long long)stats->instructions);
+    printf("Detailed cycles:       %llu (CPI %.3f)\n", (unsigned long long)stats->cycles, cpi);
+    printf("I-cache misses:        %llu (%llu stall cycles)\n",
+           (unsigned long long)stats->icacheMisses, (unsigned long long)stats->icacheStalls);
+    printf("D-cache misses:        %llu (%llu stall cycles)\n",
+           (unsigned long long)stats->dcacheMisses, (unsigned long long)stats->dcacheStalls);
+    printf("Branch mispredicts:    %llu (%llu stall cycles)\n",
+           (unsigned long long)stats->mispredicts, (unsigned long long)stats->branchStalls);
+    printf("Frontend stalls:       %llu cycles (%llu refilling after traps and serializing)\n",
+           (unsigned long long)(stats->icacheStalls + stats->branchStalls + stats->fetchStalls),
+           (unsigned long long)stats->fetchStalls);
+    printf("Load-use stalls:       %llu cycles\n", (unsigned long long)stats->loadUseStalls);
+    printf("Mul/div stalls:        %llu cycles\n", (unsigned long long)stats->mulDivStalls);
+}
+
+void printOutOfOrderStats(const oooConfig *cfg, const timingStats *stats) {
+    static const char *unitNames[FU_CLASSES] = { "ALU", "Multiply", "Divide", "Load/store", "Float", "Float divide" };
+    double cycles = stats->cycles ? (double)stats->cycles : 1.0;
+
+    printf("IPC:                   %.3f (%u wide)\n", (double)stats->instructions / cycles, cfg->issueWidth);
+    printf("ROB occupancy:         %.1f of %u entries on average\n", (double)stats->ooo.robCycles / cycles, cfg->robEntries);
+    printf("Dispatch stalls:       %llu ROB full, %llu RS full, %llu out of registers\n",
+           (unsigned long long)stats->ooo.robStalls, (unsigned long long)stats->ooo.rsStalls,
+           (unsigned long long)stats->ooo.renameStalls);
+    printf("Unit utilisation       units       busy\n");
+    for (int unit = 0; unit < FU_CLASSES; unit++) {
+        printf("  %-20s %-11u %.1f%%\n", unitNames[unit], cfg->units[unit],
+               100.0 * (double)stats->ooo.unitBusy[unit] / (cycles * cfg->units[unit]));
+    }
+}
@@ -0,0 +1,107 @@
+#include "trap.h"
+#include <stdio.h>
+#include <time.h>
+#include "clock.h"
+
+void takeTrap(sim_t *sim, uint32_t cause, uint32_t tval, uint32_t pc) {
+    csrFile *csrs = &sim->csrs;
+    uint32_t status = csrs->mstatus;
+
+    csrs->mepc = pc;
+    csrs->mcause = cause;
+    csrs->mtval = tval;
+
+    /* Stack the interrupt enable and privilege */
+    status &= ~(MSTATUS_MPIE | MSTATUS_MPP);
+    if (status & MSTATUS_MIE) {
+        status |= MSTATUS_MPIE;
+    }
+    status &= ~MSTATUS_MIE;
+    status |= (uint32_t)csrs->privilege << MSTATUS_MPP_SHIFT;
+    csrs->mstatus = status;
+    csrs->privilege = PRIV_M;
+    mmuUpdateMode(&sim->mmu);
+
+    uint32_t base = csrs->mtvec & ~3u;
+    if ((csrs->mtvec & MTVEC_VECTORED) && (cause & MCAUSE_INTERRUPT)) {
+        base += 4 * (cause & ~MCAUSE_INTERRUPT);
+    }
+    sim->regFile.programCounter = base;
+}
+
+uint32_t trapReturn(sim_t *sim) {
+    csrFile *csrs = &sim->csrs;
+    uint32_t status = csrs->mstatus;
+
+    csrs->privilege = (status & MSTATUS_MPP) >> MSTATUS_MPP_SHIFT;
+    status &= ~(MSTATUS_MIE | MSTATUS_MPP);
+    if (status & MSTATUS_MPIE) {
+        status |= MSTATUS_MIE;
+    }
+    status |= MSTATUS_MPIE; /* MPP goes back to U */
+    if (csrs->privilege != PRIV_M) {
+        status &= ~MSTATUS_MPRV;
+    }
+    csrs->mstatus = status;
+    mmuUpdateMode(&sim->mmu);
+    return csrs->mepc;
+}
+
+bool takePendingInterrupt(sim_t *sim) {
+    const csrFile *csrs = &sim->csrs;
+    uint32_t pending = csrs->mip & csrs->mie;
+
+    /* Lower privileges can always be interrupted by M-mode */
+    if (pending == 0 || (csrs->privilege == PRIV_M && !(csrs->mstatus & MSTATUS_MIE))) {
+        return false;
+    }
+
+    uint32_t irq;
+    if (pending & MIP_MEIP) {
+        irq = IRQ_M_EXT;
+    } else if (pending & MIP_MSIP) {
+        irq = IRQ_M_SOFT;
+    } else {
+        irq = IRQ_M_TIMER;
+    }
+    takeTrap(sim, MCAUSE_INTERRUPT | irq, 0, sim->regFile.programCounter);
+    return true;
+}
+
+/* Longest host sleep of one WFI is a hundredth of a second */
+#define WFI_SLICES_PER_SECOND 100
+
+/* Whole seconds first, ticks * 1e9 would overflow for gaps past about 1.8e10 ticks */
+static void sleepHost(uint64_t ticks, uint64_t hz) {
+    struct timespec delay;
+    delay.tv_sec = (time_t)(ticks / hz);
+    delay.tv_nsec = (long)((unsigned __int128)(ticks % hz) * 1000000000u / hz);
+    nanosleep(&delay, NULL);
+}
+
+void waitForInterrupt(sim_t *sim) {
+    /* Single hart, so this hart waiting means every hart is idle */
+    while ((sim->csrs.mip & sim->csrs.mie) == 0 && !sim->halted) {
+        uint64_t due = sim->events.nextDue;
+        if (sim->events.foregroundPending == 0) {
+            printf("WFI with no pending events at pc %08X, halting\n", sim->regFile.programCounter);
+            sim->halted = true;
+            return;
+        }
+        uint64_t idle = due > sim->clockNow ? due - sim->clockNow : 0;
+        if (sim->wfiSleepHz != 0) {
+            /* WFI may wake without an interrupt, so a long wait returns to the run loop after each slice
+               and the caller of sim_run gets control back */
+            uint64_t slice = sim->wfiSleepHz / WFI_SLICES_PER_SECOND + 1;
+            if (idle > slice) {
+                sleepHost(slice, sim->wfiSleepHz);
+                sim->wfiSkippedCycles += slice;
+                clockSkipTo(sim, sim->clockNow + slice);
+                return;
+            }
+            sleepHost(idle, sim->wfiSleepHz);
+        }
+        sim->wfiSkippedCycles += idle;
+        clockSkipTo(sim, due);
+    }
+}
@@ -0,0 +1,53 @@
+#include "uart.h"
+#include <stdio.h>
+#include <unistd.h>
+
+void uartFlush(uartDevice *uart) {
+    uint32_t done = 0;
+
+    /* Keep ordering with anything the simulator itself printed */
+    fflush(stdout);
+    while (done < uart->used) {
+        ssize_t written = write(uart->hostFd, uart->buffer + done, uart->used - done);
+        if (written <= 0) {
+            break;
+        }
+        done += (uint32_t)written;
+    }
+    uart->used = 0;
+}
+
+static uint32_t uartRead(void *device, uint32_t offset, uint8_t bytes) {
+    (void)device;
+    (void)bytes;
+    /* Always ready to transmit, nothing is ever received */
+    return offset == UART_LSR ? UART_LSR_TX_IDLE : 0;
+}
+
+static void uartWrite(void *device, uint32_t offset, uint8_t bytes, uint32_t value) {
+    uartDevice *dev = (uartDevice *)device;
+    (void)bytes;
+    if (offset != UART_THR) {
+        return;
+    }
+    dev->buffer[dev->used++] = (char)value;
+    if (dev->used == UART_BUFFER_SIZE || (dev->lineBuffered && (char)value == '\n')) {
+        uartFlush(dev);
+    }
+}
+
+void uartInit(uartDevice *uart, busMap *bus, uint32_t base, int hostFd) {
+    uart->hostFd = hostFd;
+    uart->lineBuffered = isatty(hostFd);
+    uart->used = 0;
+
+    busRegion region = {
+        .name = "uart",
+        .base = base,
+        .size = UART_SIZE,
+        .device = uart,
+        .read = uartRead,
+        .write = uartWrite,
+    };
+    busAddRegion(bus, &region);
+}
@@ -0,0 +1,521 @@
+#include "vector.h"
+#include <string.h>
+#include "sim.h"
+
+/* Host vectors of HOST_VECTOR_BYTES, one per element width */
+typedef uint8_t hostU8 __attribute__((vector_size(HOST_VECTOR_BYTES)));
+typedef uint16_t hostU16 __attribute__((vector_size(HOST_VECTOR_BYTES)));
+typedef uint32_t hostU32 __attribute__((vector_size(HOST_VECTOR_BYTES)));
+typedef int8_t hostI8 __attribute__((vector_size(HOST_VECTOR_BYTES)));
+typedef int16_t hostI16 __attribute__((vector_size(HOST_VECTOR_BYTES)));
+typedef int32_t hostI32 __attribute__((vector_size(HOST_VECTOR_BYTES)));
+
+/* Largest register group, eight registers, plus room for reading a whole last chunk */
+#define GROUP_BYTES_MAX (8 * VLENB_MAX + HOST_VECTOR_BYTES)
+
+/*
+ * Computes one host vector per iteration: a is the vs2 chunk, b the vs1 chunk or the splatted
+ * scalar (bStep 0 keeps reading the same chunk), sa/sb their signed views.
+ */
+#define HOST_LOOP(UT, ST, EXPR)                                        \
+    for (uint32_t off = 0; off < bytes; off += HOST_VECTOR_BYTES) {    \
+        UT a, b, r;                                                    \
+        memcpy(&a, vs2 + off, sizeof(a));                              \
+        memcpy(&b, vs1 + (off & bStep), sizeof(b));                    \
+        ST sa = (ST)a;                                                 \
+        ST sb = (ST)b;                                                 \
+        (void)sa;                                                      \
+        (void)sb;                                                      \
+        r = (UT)(EXPR);                                                \
+        memcpy(out + off, &r, sizeof(r));                              \
+    }
+
+#define BY_SEW(EXPR)                                                   \
+    switch (sew) {                                                     \
+        case 8:  HOST_LOOP(hostU8, hostI8, EXPR); break;               \
+        case 16: HOST_LOOP(hostU16, hostI16, EXPR); break;             \
+        default: HOST_LOOP(hostU32, hostI32, EXPR); break;             \
+    }
+
+bool vectorInit(vectorUnit *vu, uint32_t vlen) {
+    if (vlen < VLEN_MIN || vlen > VLEN_MAX || (vlen & (vlen - 1)) != 0) {
+        return false;
+    }
+    memset(vu->regs, 0, sizeof(vu->regs));
+    vu->vlenb = vlen / 8;
+    vu->vl = 0;
+    vu->vtype = VTYPE_VILL;
+    vu->vstart = 0;
+    vu->vxsat = 0;
+    vu->vxrm = 0;
+    vu->sew = 8;
+    vu->lmulRegs = 1;
+    return true;
+}
+
+static inline uint8_t *vectorRegister(vectorUnit *vu, uint32_t reg) {
+    return &vu->regs[reg * vu->vlenb];
+}
+
+static inline uint32_t readElement(const uint8_t *base, uint32_t sew, uint32_t index) {
+    switch (sew) {
+        case 8: return base[index];
+        case 16: { uint16_t value; memcpy(&value, base + index * 2, 2); return value; }
+        default: { uint32_t value; memcpy(&value, base + index * 4, 4); return value; }
+    }
+}
+
+static inline void writeElement(uint8_t *base, uint32_t sew, uint32_t index, uint32_t value) {
+    switch (sew) {
+        case 8: base[index] = (uint8_t)value; break;
+        case 16: { uint16_t half = (uint16_t)value; memcpy(base + index * 2, &half, 2); break; }
+        default: memcpy(base + index * 4, &value, 4); break;
+    }
+}
+
+static inline int32_t signedElement(uint32_t value, uint32_t sew) {
+    return SIGN_EXTEND(value, sew);
+}
+
+static inline bool maskBit(const uint8_t *mask, uint32_t index) {
+    return (mask[index >> 3] >> (index & 7)) & 1;
+}
+
+static inline void setMaskBit(uint8_t *mask, uint32_t index, bool value) {
+    mask[index >> 3] = (uint8_t)((mask[index >> 3] & ~(1u << (index & 7))) | ((uint32_t)value << (index & 7)));
+}
+
+static void raiseIllegal(sim_t *sim, decoder_to_execute *out) {
+    out->exception = true;
+    out->cause = CAUSE_ILLEGAL_INSTRUCTION;
+    out->tval = sim->regFile.instructionRegister;
+    out->writesRd = false;
+}
+
+/* Register groups must start at a multiple of their size */
+static inline bool groupAligned(uint32_t reg, uint32_t regs) {
+    return (reg & (regs - 1)) == 0;
+}
+
+/*
+ * vsetvli/vsetivli/vsetvl. An unsupported vtype sets vill and vl = 0, later vector instructions
+ * then raise illegal instruction until a valid one is set.
+ */
+static uint32_t setVectorConfig(vectorUnit *vu, uint32_t vtype, uint32_t avl) {
+    uint32_t vsew = (vtype & VTYPE_VSEW) >> VTYPE_VSEW_SHIFT;
+    uint32_t vlmul = vtype & VTYPE_VLMUL;
+    uint32_t vlen = vu->vlenb * 8;
+    uint32_t sew = 8u << vsew;
+    uint32_t vlmax;
+
+    if ((vtype & ~(VTYPE_VLMUL | VTYPE_VSEW | VTYPE_VTA | VTYPE_VMA)) != 0 || sew > VECTOR_ELEN || vlmul == 4) {
+        vu->vtype = VTYPE_VILL;
+        vu->vl = 0;
+        vu->vstart = 0;
+        return 0;
+    }
+    /* vlmul 5-7 are 1/8, 1/4 and 1/2 */
+    vlmax = vlmul < 4 ? (vlen << vlmul) / sew : (vlen >> (8 - vlmul)) / sew;
+    if (vlmax == 0) {
+        vu->vtype = VTYPE_VILL;
+        vu->vl = 0;
+        vu->vstart = 0;
+        return 0;
+    }
+
+    vu->vtype = vtype;
+    vu->sew = sew;
+    vu->lmulRegs = vlmul < 4 ? 1u << vlmul : 1;
+    vu->vl = avl < vlmax ? avl : vlmax;
+    vu->vstart = 0;
+    return vu->vl;
+}
+
+/* Copies the active body elements of result into vd */
+static void commitElements(vectorUnit *vu, uint8_t *vd, const uint8_t *result, bool masked) {
+    uint32_t bytes = vu->sew / 8;
+    if (!masked) {
+        memcpy(vd, result, vu->vl * bytes);
+        return;
+    }
+    const uint8_t *mask = vectorRegister(vu, 0);
+    for (uint32_t i = 0; i < vu->vl; i++) {
+        if (maskBit(mask, i)) {
+            memcpy(vd + i * bytes, result + i * bytes, bytes);
+        }
+    }
+}
+
+/* Compares left all ones or zero in every result element, packs them into mask bits of vd */
+static void commitMask(vectorUnit *vu, uint8_t *vd, const uint8_t *result, bool masked) {
+    uint8_t mask[VLENB_MAX];
+    memcpy(mask, vectorRegister(vu, 0), vu->vlenb);
+    for (uint32_t i = 0; i < vu->vl; i++) {
+        if (!masked || maskBit(mask, i)) {
+            setMaskBit(vd, i, readElement(result, vu->sew, i) != 0);
+        }
+    }
+}
+
+static void computeElementwise(uint8_t op, uint32_t sew, uint8_t *out, const uint8_t *vs2, const uint8_t *vs1,
+                               uint32_t bStep, uint32_t bytes) {
+    /* A byte widens into every element type, a uint32_t scalar would not narrow */
+    const uint8_t shiftMask = (uint8_t)(sew - 1);
+
+    switch (op) {
+        case OP_VADD:   BY_SEW(a + b); break;
+        case OP_VSUB:   BY_SEW(a - b); break;
+        case OP_VRSUB:  BY_SEW(b - a); break;
+        case OP_VAND:   BY_SEW(a & b); break;
+        case OP_VOR:    BY_SEW(a | b); break;
+        case OP_VXOR:   BY_SEW(a ^ b); break;
+        case OP_VMUL:   BY_SEW(a * b); break;
+        case OP_VSLL:   BY_SEW(a << (b & shiftMask)); break;
+        case OP_VSRL:   BY_SEW(a >> (b & shiftMask)); break;
+        case OP_VSRA:   BY_SEW(sa >> (b & shiftMask)); break;
+        case OP_VMERGE: BY_SEW(b); break;
+        case OP_VMSEQ:  BY_SEW(a == b); break;
+        case OP_VMSNE:  BY_SEW(a != b); break;
+        case OP_VMSLTU: BY_SEW(a < b); break;
+        case OP_VMSLT:  BY_SEW(sa < sb); break;
+        case OP_VMSLEU: BY_SEW(a <= b); break;
+        case OP_VMSLE:  BY_SEW(sa <= sb); break;
+        case OP_VMSGTU: BY_SEW(a > b); break;
+        case OP_VMSGT:  BY_SEW(sa > sb); break;
+        default: break;
+    }
+}
+
+static inline bool isCompare(uint8_t op) {
+    return op >= OP_VMSEQ && op <= OP_VMSGT;
+}
+
+static uint32_t reduceStep(uint8_t op, uint32_t sew, uint32_t acc, uint32_t value) {
+    switch (op) {
+        case OP_VREDSUM:  return acc + value;
+        case OP_VREDAND:  return acc & value;
+        case OP_VREDOR:   return acc | value;
+        case OP_VREDXOR:  return acc ^ value;
+        case OP_VREDMINU: return value < acc ? value : acc;
+        case OP_VREDMAXU: return value > acc ? value : acc;
+        case OP_VREDMIN:  return signedElement(value, sew) < signedElement(acc, sew) ? value : acc;
+        default:          return signedElement(value, sew) > signedElement(acc, sew) ? value : acc;
+    }
+}
+
+/* Folds whole host vectors of vs2 together first for the lane-wise ops, the rest element by element */
+#define HOST_FOLD(UT, OPER)                                            \
+    {                                                                  \
+        UT fold, chunk;                                                \
+        memcpy(&fold, vs2, sizeof(fold));                              \
+        for (uint32_t off = HOST_VECTOR_BYTES; off < folded; off += HOST_VECTOR_BYTES) { \
+            memcpy(&chunk, vs2 + off, sizeof(chunk));                  \
+            fold = fold OPER chunk;                                    \
+        }                                                              \
+        memcpy(lanes, &fold, sizeof(fold));                            \
+    }
+
+#define FOLD_BY_SEW(OPER)                                              \
+    switch (sew) {                                                     \
+        case 8:  HOST_FOLD(hostU8, OPER); break;                       \
+        case 16: HOST_FOLD(hostU16, OPER); break;                      \
+        default: HOST_FOLD(hostU32, OPER); break;                      \
+    }
+
+static uint32_t reduce(vectorUnit *vu, uint8_t op, const uint8_t *vs2, uint32_t acc, bool masked) {
+    uint32_t sew = vu->sew;
+    uint32_t bytes = sew / 8;
+    uint32_t start = 0;
+
+    if (!masked && op <= OP_VREDXOR) {
+        uint8_t lanes[HOST_VECTOR_BYTES];
+        uint32_t folded = (vu->vl * bytes) & ~(HOST_VECTOR_BYTES - 1u);
+        if (folded != 0) {
+            switch (op) {
+                case OP_VREDSUM: FOLD_BY_SEW(+); break;
+                case OP_VREDAND: FOLD_BY_SEW(&); break;
+                case OP_VREDOR:  FOLD_BY_SEW(|); break;
+                default:         FOLD_BY_SEW(^); break;
+            }
+            for (uint32_t i = 0; i < HOST_VECTOR_BYTES / bytes; i++) {
+                acc = reduceStep(op, sew, acc, readElement(lanes, sew, i));
+            }
+            start = folded / bytes;
+        }
+    }
+
+    const uint8_t *mask = vectorRegister(vu, 0);
+    for (uint32_t i = start; i < vu->vl; i++) {
+        if (!masked || maskBit(mask, i)) {
+            acc = reduceStep(op, sew, acc, readElement(vs2, sew, i));
+        }
+    }
+    return acc;
+}
+
+/* Mask logical ops work on vl bits, the bits past vl are left undisturbed */
+static void maskLogical(vectorUnit *vu, uint8_t op, uint8_t *vd, const uint8_t *vs2, const uint8_t *vs1) {
+    uint32_t bytes = (vu->vl + 7) / 8;
+    uint8_t result[VLENB_MAX];
+
+    for (uint32_t i = 0; i < bytes; i++) {
+        uint8_t a = vs2[i];
+        uint8_t b = vs1[i];
+        switch (op) {
+            case OP_VMANDN: result[i] = a & ~b; break;
+            case OP_VMAND:  result[i] = a & b; break;
+            case OP_VMOR:   result[i] = a | b; break;
+            case OP_VMXOR:  result[i] = a ^ b; break;
+            case OP_VMORN:  result[i] = a | ~b; break;
+            case OP_VMNAND: result[i] = ~(a & b); break;
+            case OP_VMNOR:  result[i] = ~(a | b); break;
+            default:        result[i] = ~(a ^ b); break;
+        }
+    }
+    memcpy(vd, result, vu->vl / 8);
+    if (vu->vl & 7) {
+        uint8_t keep = (uint8_t)(0xFF << (vu->vl & 7));
+        vd[vu->vl / 8] = (vd[vu->vl / 8] & keep) | (result[vu->vl / 8] & ~keep);
+    }
+}
+
+static void prepareMemoryAccess(sim_t *sim, const decodedFields *df, decoder_to_execute *out) {
+    vectorUnit *vu = &sim->vector;
+    uint32_t *x = sim->regFile.generalRegisters;
+    uint8_t op = df->microOp;
+    uint32_t eew;
+    uint32_t emulRegs = 1;
+
+    switch (df->instrFields.v_type.funct3) {
+        case 0x0: eew = 8; break;
+        case 0x5: eew = 16; break;
+        default: eew = 32; break;
+    }
+    out->eew = (uint8_t)eew;
+    out->rs1 = df->instrFields.v_type.vs1;
+    out->memAddress = x[out->rs1];
+    if (op == OP_VLSE || op == OP_VSSE) {
+        out->rs2 = df->instrFields.v_type.vs2;
+        out->storeData = x[out->rs2];
+    }
+
+    if (op != OP_VLM && op != OP_VSM) {
+        /* EMUL = EEW / SEW * LMUL has to stay a legal LMUL */
+        uint32_t vlmul = vu->vtype & VTYPE_VLMUL;
+        int32_t emulLog2 = (vlmul < 4 ? (int32_t)vlmul : (int32_t)vlmul - 8) +
+                           __builtin_ctz(eew) - __builtin_ctz(vu->sew);
+        if (emulLog2 < -3 || emulLog2 > 3) {
+            raiseIllegal(sim, out);
+            return;
+        }
+        emulRegs = emulLog2 > 0 ? 1u << emulLog2 : 1;
+    }
+    if (!groupAligned(out->vd, emulRegs) || (!out->vm && out->vd == 0 && op <= OP_VLM)) {
+        raiseIllegal(sim, out);
+    }
+}
+
+void vectorExecute(sim_t *sim, const decodedFields *df, decoder_to_execute *out) {
+    vectorUnit *vu = &sim->vector;
+    uint32_t *x = sim->regFile.generalRegisters;
+    uint8_t op = df->microOp;
+    uint8_t vd = df->instrFields.v_type.vd;
+    uint8_t vs1 = df->instrFields.v_type.vs1;
+    uint8_t vs2 = df->instrFields.v_type.vs2;
+    uint8_t funct3 = df->instrFields.v_type.funct3;
+    bool masked = !df->instrFields.v_type.vm;
+
+    out->writesRd = false;
+    out->vd = vd;
+    out->vm = !masked;
+
+    /* Configuration, AVL is vlmax when rs1 = x0 and rd != x0, the current vl when both are x0 */
+    if (op == OP_VSETVLI || op == OP_VSETIVLI || op == OP_VSETVL) {
+        uint32_t vtype = op == OP_VSETVL ? x[vs2] : df->instrFields.v_type.zimm;
+        uint32_t avl;
+        if (op == OP_VSETIVLI) {
+            avl = vs1;
+        } else if (vs1 != 0) {
+            avl = x[vs1];
+            out->rs1 = vs1;
+        } else {
+            avl = vd != 0 ? UINT32_MAX : vu->vl;
+        }
+        out->rs2 = op == OP_VSETVL ? vs2 : 0;
+        out->rd = vd;
+        out->result = setVectorConfig(vu, vtype, avl);
+        out->writesRd = true;
+        return;
+    }
+
+    if (vu->vtype & VTYPE_VILL) {
+        raiseIllegal(sim, out);
+        return;
+    }
+    if (isVectorMemoryOp(op)) {
+        prepareMemoryAccess(sim, df, out);
+        return;
+    }
+    /* Arithmetic is only restarted from element 0 */
+    if (vu->vstart != 0) {
+        raiseIllegal(sim, out);
+        return;
+    }
+
+    uint32_t sew = vu->sew;
+    uint32_t regs = vu->lmulRegs;
+    uint8_t *dest = vectorRegister(vu, vd);
+    const uint8_t *src2 = vectorRegister(vu, vs2);
+
+    switch (op) {
+        case OP_VMV_X_S:
+            /* Ignores vl, element 0 is always there */
+            out->rd = vd;
+            out->result = (uint32_t)signedElement(readElement(src2, sew, 0), sew);
+            out->writesRd = true;
+            return;
+        case OP_VMV_S_X:
+            out->rs1 = vs1;
+            if (vu->vl != 0) {
+                writeElement(dest, sew, 0, x[vs1]);
+            }
+            return;
+        case OP_VCPOP:
+        case OP_VFIRST: {
+            const uint8_t *mask = vectorRegister(vu, 0);
+            uint32_t count = 0;
+            int32_t first = -1;
+            for (uint32_t i = 0; i < vu->vl; i++) {
+                if (maskBit(src2, i) && (!masked || maskBit(mask, i))) {
+                    if (first < 0) {
+                        first = (int32_t)i;
+                    }
+                    count++;
+                }
+            }
+            out->rd = vd;
+            out->result = op == OP_VCPOP ? count : (uint32_t)first;
+            out->writesRd = true;
+            return;
+        }
+        default:
+            break;
+    }
+
+    if (op >= OP_VMANDN && op <= OP_VMXNOR) {
+        if (masked) {
+            raiseIllegal(sim, out);
+            return;
+        }
+        maskLogical(vu, op, dest, src2, vectorRegister(vu, vs1));
+        return;
+    }
+
+    if (op >= OP_VREDSUM && op <= OP_VREDMAX) {
+        if (!groupAligned(vs2, regs)) {
+            raiseIllegal(sim, out);
+            return;
+        }
+        if (vu->vl != 0) {
+            uint32_t acc = reduce(vu, op, src2, readElement(vectorRegister(vu, vs1), sew, 0), masked);
+            writeElement(dest, sew, 0, acc);
+        }
+        return;
+    }
+
+    /* Element-wise ops, vs1 is a register group, x[rs1] or simm5 splatted over a host vector */
+    uint8_t splat[HOST_VECTOR_BYTES] __attribute__((aligned(32)));
+    const uint8_t *src1;
+    uint32_t bStep;
+    bool maskDest = isCompare(op);
+
+    if (funct3 == OPIVV || funct3 == OPMVV) {
+        src1 = vectorRegister(vu, vs1);
+        bStep = UINT32_MAX;
+        if (!groupAligned(vs1, regs)) {
+            raiseIllegal(sim, out);
+            return;
+        }
+    } else {
+        uint32_t scalar = (uint32_t)SIGN_EXTEND(vs1, 5);
+        if (funct3 != OPIVI) {
+            scalar = x[vs1];
+            out->rs1 = vs1;
+        }
+        for (uint32_t i = 0; i < HOST_VECTOR_BYTES / (sew / 8); i++) {
+            writeElement(splat, sew, i, scalar);
+        }
+        src1 = splat;
+        bStep = 0;
+    }
+    if (!groupAligned(vs2, regs) || (!maskDest && (!groupAligned(vd, regs) || (masked && vd == 0)))) {
+        raiseIllegal(sim, out);
+        return;
+    }
+
+    /* vmerge takes vs1/rs1/imm where v0 is set and vs2 elsewhere, vmv.v.* is its unmasked form */
+    if (op == OP_VMERGE && masked) {
+        const uint8_t *mask = vectorRegister(vu, 0);
+        uint32_t bytes = sew / 8;
+        for (uint32_t i = 0; i < vu->vl; i++) {
+            const uint8_t *from = maskBit(mask, i) ? src1 + ((i * bytes) & bStep) : src2 + i * bytes;
+            memcpy(dest + i * bytes, from, bytes);
+        }
+        return;
+    }
+
+    uint8_t result[GROUP_BYTES_MAX] __attribute__((aligned(32)));
+    uint32_t bytes = (vu->vl * (sew / 8) + HOST_VECTOR_BYTES - 1) & ~(HOST_VECTOR_BYTES - 1u);
+    computeElementwise(op, sew, result, src2, src1, bStep, bytes);
+    if (maskDest) {
+        commitMask(vu, dest, result, masked);
+    } else {
+        commitElements(vu, dest, result, masked);
+    }
+}
+
+bool vectorMemAccess(sim_t *sim, decoder_to_execute *ex) {
+    vectorUnit *vu = &sim->vector;
+    mmuState *mmu = &sim->mmu;
+    uint8_t op = ex->microOp;
+    bool load = op <= OP_VLM;
+    uint32_t sew = ex->eew;
+    uint32_t bytes = sew / 8;
+    uint32_t count = (op == OP_VLM || op == OP_VSM) ? (vu->vl + 7) / 8 : vu->vl;
+    uint32_t stride = (op == OP_VLSE || op == OP_VSSE) ? ex->storeData : bytes;
+    uint8_t *reg = vectorRegister(vu, ex->vd);
+    const uint8_t *mask = vectorRegister(vu, 0);
+
+    /* An unmasked, aligned unit-stride access inside one ram page is a single copy */
+    if (ex->vm && stride == bytes && vu->vstart == 0 && count != 0 && (ex->memAddress & (bytes - 1)) == 0) {
+        uint8_t *host = mmuHostSpan(mmu, ex->memAddress, count * bytes, load ? ACCESS_LOAD : ACCESS_STORE);
+        if (host != NULL) {
+            if (load) {
+                memcpy(reg, host, count * bytes);
+            } else {
+                memcpy(host, reg, count * bytes);
+            }
+            return true;
+        }
+    }
+
+    for (uint32_t i = vu->vstart; i < count; i++) {
+        uint32_t address = ex->memAddress + i * stride;
+        if (!ex->vm && !maskBit(mask, i)) {
+            continue;
+        }
+        if (load) {
+            uint32_t value;
+            if (!mmuLoad(mmu, address, (uint8_t)bytes, false, &value)) {
+                vu->vstart = i;
+                return false;
+            }
+            writeElement(reg, sew, i, value);
+        } else if (!mmuStore(mmu, address, (uint8_t)bytes, readElement(reg, sew, i))) {
+            vu->vstart = i;
+            return false;
+        }
+    }
+    vu->vstart = 0;
+    return true;
+}
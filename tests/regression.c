@@ -0,0 +1,682 @@
+/**
+ * Regression checks on top of the library API. Each case assembles a small raw program, runs it in
+ * the listed modes and checks the registers it leaves behind. Faulting cases install a handler at
+ * HANDLER that copies mepc, mcause and mtval to a2, a3 and a4, sets a5 and exits.
+ */
+#include <elf.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "riscvsim.h"
+
+#define RAM_BYTES (1u << 20)
+#define BUDGET 100000
+#define HANDLER 0x200
+#define DATA 0x300
+#define IMAGE_BYTES 0x400
+
+/* Registers by ABI name */
+enum { ZERO = 0, RA = 1, T0 = 5, T1 = 6, T2 = 7, A0 = 10, A1 = 11, A2 = 12, A3 = 13, A4 = 14, A5 = 15, A7 = 17 };
+
+/* CSRs and causes the cases use */
+#define FFLAGS 0x001
+#define SATP 0x180
+#define MSTATUS 0x300
+#define MISA 0x301
+#define MIE 0x304
+#define MTVEC 0x305
+#define MEPC 0x341
+#define MCAUSE 0x342
+#define MTVAL 0x343
+#define CYCLE 0xC00
+
+/* misa of the rv32im core, MXL 32 with S and U modes */
+#define MISA_RV32IM ((1u << 30) | (1u << 8) | (1u << 12) | (1u << 18) | (1u << 20))
+
+#define CAUSE_TIMER_INTERRUPT 0x80000007u
+#define CAUSE_FETCH_MISALIGNED 0
+#define CAUSE_ILLEGAL_INSTRUCTION 2
+#define CAUSE_LOAD_MISALIGNED 4
+#define CAUSE_LOAD_ACCESS 5
+#define CAUSE_FETCH_PAGE_FAULT 12
+#define CAUSE_LOAD_PAGE_FAULT 13
+
+static unsigned failures;
+static unsigned checks;
+
+//==================================== Encoding ========================================================
+
+static uint32_t rType(uint32_t opcode, uint32_t funct3, uint32_t funct7, uint32_t rd, uint32_t rs1, uint32_t rs2) {
+    return funct7 << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+}
+
+static uint32_t iType(uint32_t opcode, uint32_t funct3, uint32_t rd, uint32_t rs1, int32_t imm) {
+    return ((uint32_t)imm & 0xFFF) << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+}
+
+static uint32_t ADDI(uint32_t rd, uint32_t rs1, int32_t imm) { return iType(0x13, 0, rd, rs1, imm); }
+static uint32_t SLLI(uint32_t rd, uint32_t rs1, int32_t shamt) { return iType(0x13, 1, rd, rs1, shamt); }
+static uint32_t LW(uint32_t rd, uint32_t rs1, int32_t imm) { return iType(0x03, 2, rd, rs1, imm); }
+static uint32_t FLD(uint32_t rd, uint32_t rs1, int32_t imm) { return iType(0x07, 3, rd, rs1, imm); }
+static uint32_t JALR(uint32_t rd, uint32_t rs1, int32_t imm) { return iType(0x67, 0, rd, rs1, imm); }
+static uint32_t CSRRW(uint32_t rd, uint32_t csr, uint32_t rs1) { return iType(0x73, 1, rd, rs1, (int32_t)csr); }
+static uint32_t CSRRS(uint32_t rd, uint32_t csr, uint32_t rs1) { return iType(0x73, 2, rd, rs1, (int32_t)csr); }
+static uint32_t CSRRC(uint32_t rd, uint32_t csr, uint32_t rs1) { return iType(0x73, 3, rd, rs1, (int32_t)csr); }
+static uint32_t LUI(uint32_t rd, uint32_t imm20) { return imm20 << 12 | rd << 7 | 0x37; }
+static uint32_t AUIPC(uint32_t rd, uint32_t imm20) { return imm20 << 12 | rd << 7 | 0x17; }
+static uint32_t ADD(uint32_t rd, uint32_t rs1, uint32_t rs2) { return rType(0x33, 0, 0x00, rd, rs1, rs2); }
+static uint32_t SUB(uint32_t rd, uint32_t rs1, uint32_t rs2) { return rType(0x33, 0, 0x20, rd, rs1, rs2); }
+static uint32_t MUL(uint32_t rd, uint32_t rs1, uint32_t rs2) { return rType(0x33, 0, 0x01, rd, rs1, rs2); }
+static uint32_t FDIV_S(uint32_t rd, uint32_t rs1, uint32_t rs2) { return rType(0x53, 7, 0x0C, rd, rs1, rs2); }
+static uint32_t FADD_S(uint32_t rd, uint32_t rs1, uint32_t rs2) { return rType(0x53, 7, 0x00, rd, rs1, rs2); }
+static uint32_t FADD_D(uint32_t rd, uint32_t rs1, uint32_t rs2) { return rType(0x53, 7, 0x01, rd, rs1, rs2); }
+static uint32_t FCVT_S_W(uint32_t rd, uint32_t rs1) { return rType(0x53, 7, 0x68, rd, rs1, 0); }
+static uint32_t FMV_W_X(uint32_t rd, uint32_t rs1) { return rType(0x53, 0, 0x78, rd, rs1, 0); }
+static uint32_t FMV_X_W(uint32_t rd, uint32_t rs1) { return rType(0x53, 0, 0x70, rd, rs1, 0); }
+#define ECALL 0x00000073u
+
+/* Replaces the dynamic rounding mode of an FP op */
+#define RM_RMM 4
+static uint32_t withRm(uint32_t word, uint32_t rm) { return (word & ~(7u << 12)) | rm << 12; }
+#define MRET 0x30200073u
+#define WFI 0x10500073u
+
+static uint32_t SW(uint32_t rs2, uint32_t rs1, int32_t imm) {
+    uint32_t bits = (uint32_t)imm & 0xFFF;
+    return (bits >> 5) << 25 | rs2 << 20 | rs1 << 15 | 2u << 12 | (bits & 0x1F) << 7 | 0x23;
+}
+
+static uint32_t JAL(uint32_t rd, int32_t offset) {
+    uint32_t imm = (uint32_t)offset;
+    return ((imm >> 20) & 1) << 31 | ((imm >> 1) & 0x3FF) << 21 | ((imm >> 11) & 1) << 20 |
+           ((imm >> 12) & 0xFF) << 12 | rd << 7 | 0x6F;
+}
+
+typedef struct {
+    uint32_t words[IMAGE_BYTES / 4];
+    uint32_t at;   /* Next word */
+} program;
+
+static void emit(program *p, uint32_t word) {
+    p->words[p->at++] = word;
+}
+
+static void org(program *p, uint32_t address) {
+    p->at = address / 4;
+}
+
+/* Clears mtvec first so the exit ecall goes to the host rather than to the handler */
+static void emitExit(program *p) {
+    emit(p, CSRRW(ZERO, MTVEC, ZERO));
+    emit(p, ADDI(A7, ZERO, 93));
+    emit(p, ECALL);
+}
+
+/* Installs the handler at HANDLER and points mtvec at it, two instructions at the current address */
+static void emitHandler(program *p) {
+    uint32_t at = p->at;
+
+    emit(p, ADDI(T0, ZERO, HANDLER));
+    emit(p, CSRRW(ZERO, MTVEC, T0));
+    org(p, HANDLER);
+    emit(p, CSRRS(A2, MEPC, ZERO));
+    emit(p, CSRRS(A3, MCAUSE, ZERO));
+    emit(p, CSRRS(A4, MTVAL, ZERO));
+    emit(p, ADDI(A5, ZERO, 1));
+    emit(p, ADDI(A0, ZERO, 0));
+    emitExit(p);
+    p->at = at + 2;
+}
+
+//==================================== Running ========================================================
+
+typedef struct {
+    const char *name;
+    sim_mode mode;
+    uint32_t issueWidth;
+} modeCase;
+
+static const modeCase modes[] = {
+    { "functional", SIM_MODE_FUNCTIONAL, 0 },
+    { "detailed", SIM_MODE_DETAILED, 0 },
+    { "out-of-order", SIM_MODE_DETAILED, 2 },
+    { "decoupled", SIM_MODE_DECOUPLED, 0 },
+};
+
+#define MODE_COUNT (sizeof(modes) / sizeof(modes[0]))
+
+static void check(bool ok, const char *format, ...) {
+    va_list args;
+
+    checks++;
+    if (ok) {
+        return;
+    }
+    failures++;
+    printf("FAIL ");
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+static void baseConfig(sim_config *config, const modeCase *mode) {
+    sim_default_config(config);
+    config->ram_bytes = RAM_BYTES;
+    config->mode = mode->mode;
+    config->issue_width = mode->issueWidth;
+}
+
+static bool writeFile(char *path, const void *data, size_t bytes) {
+    int fd = mkstemp(path);
+    bool ok;
+
+    if (fd < 0) {
+        perror("mkstemp");
+        return false;
+    }
+    ok = write(fd, data, bytes) == (ssize_t)bytes;
+    close(fd);
+    return ok;
+}
+
+/* Creates a simulator with p loaded as a raw binary, NULL if it could not be set up */
+static sim_t *loadProgram(const program *p, const sim_config *config) {
+    char path[] = "/tmp/riscvsim-testXXXXXX";
+    sim_t *sim = sim_create(config);
+    bool loaded;
+
+    if (sim == NULL || !writeFile(path, p->words, sizeof(p->words))) {
+        sim_destroy(sim);
+        return NULL;
+    }
+    loaded = sim_load_binary(sim, path);
+    unlink(path);
+    if (!loaded) {
+        sim_destroy(sim);
+        return NULL;
+    }
+    return sim;
+}
+
+static void runToHalt(sim_t *sim) {
+    while (!sim_halted(sim) && sim_run(sim, BUDGET) != 0) {
+    }
+}
+
+static sim_t *runProgram(const program *p, const sim_config *config) {
+    sim_t *sim = loadProgram(p, config);
+    if (sim != NULL) {
+        runToHalt(sim);
+    }
+    return sim;
+}
+
+//==================================== Cases ========================================================
+
+/* A call and a tail call through auipc+jalr, fused or not */
+static void testAuipcJalr(void) {
+    program p = {0};
+
+    emit(&p, AUIPC(RA, 0));          /*  0 */
+    emit(&p, JALR(RA, RA, 16));      /*  4: call 16, ra = 8 */
+    emit(&p, AUIPC(T1, 0));          /*  8 */
+    emit(&p, JALR(ZERO, T1, 16));    /* 12: tail call 24, t1 keeps 8 */
+    emit(&p, ADDI(A0, RA, 0));       /* 16 */
+    emit(&p, JALR(ZERO, RA, 0));     /* 20: return to 8 */
+    emit(&p, ADD(A0, A0, T1));       /* 24 */
+    emit(&p, SLLI(A0, A0, 1));
+    emitExit(&p);
+
+    for (size_t m = 0; m < MODE_COUNT; m++) {
+        for (int fusion = 0; fusion <= 1; fusion++) {
+            sim_config config;
+            baseConfig(&config, &modes[m]);
+            config.fusion = fusion;
+            sim_t *sim = runProgram(&p, &config);
+            check(sim != NULL, "auipc+jalr %s: could not run", modes[m].name);
+            if (sim == NULL) {
+                continue;
+            }
+            check(sim_exit_code(sim) == 32 && sim_read_reg(sim, RA) == 8 && sim_read_reg(sim, T1) == 8,
+                  "auipc+jalr %s fusion %d: exit %d, ra %08X, t1 %08X", modes[m].name, fusion,
+                  sim_exit_code(sim), sim_read_reg(sim, RA), sim_read_reg(sim, T1));
+            sim_destroy(sim);
+        }
+    }
+}
+
+/* A load fault in the second half of auipc+lw retires the auipc and traps at the lw */
+static void testAuipcLwFault(void) {
+    program p = {0};
+
+    emitHandler(&p);                 /*  0 */
+    emit(&p, AUIPC(A1, 0x30000));    /*  8: a1 = 0x30000008, past ram and below the devices */
+    emit(&p, LW(A1, A1, 0));         /* 12 */
+    emit(&p, ADDI(A0, ZERO, 1));
+    emitExit(&p);
+
+    for (size_t m = 0; m < MODE_COUNT; m++) {
+        for (int fusion = 0; fusion <= 1; fusion++) {
+            sim_config config;
+            baseConfig(&config, &modes[m]);
+            config.fusion = fusion;
+            sim_t *sim = runProgram(&p, &config);
+            check(sim != NULL, "auipc+lw %s: could not run", modes[m].name);
+            if (sim == NULL) {
+                continue;
+            }
+            check(sim_read_reg(sim, A5) == 1 && sim_read_reg(sim, A1) == 0x30000008 &&
+                  sim_read_reg(sim, A2) == 12 && sim_read_reg(sim, A3) == CAUSE_LOAD_ACCESS &&
+                  sim_read_reg(sim, A4) == 0x30000008,
+                  "auipc+lw fault %s fusion %d: a1 %08X, mepc %08X, mcause %u, mtval %08X", modes[m].name,
+                  fusion, sim_read_reg(sim, A1), sim_read_reg(sim, A2), sim_read_reg(sim, A3),
+                  sim_read_reg(sim, A4));
+            sim_destroy(sim);
+        }
+    }
+}
+
+/* A misaligned load is split by default and traps with the trap policy */
+static void testMisalignedPolicy(void) {
+    program p = {0};
+
+    emitHandler(&p);                 /*  0 */
+    emit(&p, ADDI(T1, ZERO, DATA + 1));
+    emit(&p, LW(A0, T1, 0));         /* 12 */
+    emitExit(&p);
+    p.words[DATA / 4] = 0x44332211;
+    p.words[DATA / 4 + 1] = 0x88776655;
+
+    for (size_t m = 0; m < MODE_COUNT; m++) {
+        sim_config config;
+        baseConfig(&config, &modes[m]);
+        sim_t *sim = runProgram(&p, &config);
+        check(sim != NULL && sim_read_reg(sim, A5) == 0 && sim_read_reg(sim, A0) == 0x55443322,
+              "misaligned split %s: a0 %08X", modes[m].name, sim != NULL ? sim_read_reg(sim, A0) : 0);
+        sim_destroy(sim);
+
+        config.misaligned = SIM_MISALIGNED_TRAP;
+        sim = runProgram(&p, &config);
+        check(sim != NULL && sim_read_reg(sim, A5) == 1 && sim_read_reg(sim, A2) == 12 &&
+              sim_read_reg(sim, A3) == CAUSE_LOAD_MISALIGNED && sim_read_reg(sim, A4) == DATA + 1,
+              "misaligned trap %s: mepc %08X, mcause %u, mtval %08X", modes[m].name,
+              sim != NULL ? sim_read_reg(sim, A2) : 0, sim != NULL ? sim_read_reg(sim, A3) : 0,
+              sim != NULL ? sim_read_reg(sim, A4) : 0);
+        sim_destroy(sim);
+    }
+}
+
+/* Without C a jump to a halfword boundary faults on the jump */
+static void testMisalignedJump(void) {
+    program p = {0};
+
+    emitHandler(&p);                 /*  0 */
+    emit(&p, JAL(ZERO, 6));          /*  8: to 14 */
+    emit(&p, ADDI(A0, ZERO, 42));    /* 12 */
+    emitExit(&p);
+
+    for (size_t m = 0; m < MODE_COUNT; m++) {
+        sim_config config;
+        baseConfig(&config, &modes[m]);
+        config.isa = "rv32i";
+        sim_t *sim = runProgram(&p, &config);
+        check(sim != NULL && sim_read_reg(sim, A5) == 1 && sim_read_reg(sim, A2) == 8 &&
+              sim_read_reg(sim, A3) == CAUSE_FETCH_MISALIGNED && sim_read_reg(sim, A4) == 14,
+              "misaligned jump rv32i %s: trapped %u, mepc %08X, mcause %u, mtval %08X", modes[m].name,
+              sim != NULL ? sim_read_reg(sim, A5) : 0, sim != NULL ? sim_read_reg(sim, A2) : 0,
+              sim != NULL ? sim_read_reg(sim, A3) : 0, sim != NULL ? sim_read_reg(sim, A4) : 0);
+        sim_destroy(sim);
+
+        /* With C the target is a valid parcel boundary */
+        config.isa = NULL;
+        sim = runProgram(&p, &config);
+        check(sim != NULL && !(sim_read_reg(sim, A5) == 1 && sim_read_reg(sim, A3) == CAUSE_FETCH_MISALIGNED),
+              "misaligned jump rv32imafdcv %s: trapped", modes[m].name);
+        sim_destroy(sim);
+    }
+}
+
+/* An empty Sv32 root table makes the first user mode fetch a page fault */
+static void testSv32Fault(void) {
+    program p = {0};
+
+    emitHandler(&p);                       /*  0 */
+    emit(&p, LUI(T1, 0x80000));
+    emit(&p, ADDI(T1, T1, 0x10));          /* Sv32, root table at 0x10000 */
+    emit(&p, CSRRW(ZERO, SATP, T1));
+    emit(&p, ADDI(T2, ZERO, 0x100));
+    emit(&p, CSRRW(ZERO, MEPC, T2));
+    emit(&p, LUI(T2, 0x2));
+    emit(&p, ADDI(T2, T2, -0x800));        /* mstatus.MPP */
+    emit(&p, CSRRC(ZERO, MSTATUS, T2));
+    emit(&p, MRET);                        /* To user mode at 0x100 */
+
+    for (size_t m = 0; m < MODE_COUNT; m++) {
+        sim_config config;
+        baseConfig(&config, &modes[m]);
+        sim_t *sim = runProgram(&p, &config);
+        check(sim != NULL && sim_read_reg(sim, A5) == 1 && sim_read_reg(sim, A2) == 0x100 &&
+              sim_read_reg(sim, A3) == CAUSE_FETCH_PAGE_FAULT && sim_read_reg(sim, A4) == 0x100,
+              "Sv32 fetch fault %s: mepc %08X, mcause %u, mtval %08X", modes[m].name,
+              sim != NULL ? sim_read_reg(sim, A2) : 0, sim != NULL ? sim_read_reg(sim, A3) : 0,
+              sim != NULL ? sim_read_reg(sim, A4) : 0);
+        sim_destroy(sim);
+    }
+}
+
+/* With MPRV set, M-mode loads translate at MPP privilege. The root table is empty, so the load faults */
+static void testMprvLoad(void) {
+    program p = {0};
+
+    emitHandler(&p);                       /*  0 */
+    emit(&p, LUI(T1, 0x80000));
+    emit(&p, ADDI(T1, T1, 0x10));          /* Sv32, root table at 0x10000 */
+    emit(&p, CSRRW(ZERO, SATP, T1));
+    emit(&p, LUI(T2, 0x20));               /* mstatus.MPRV, MPP is still U */
+    emit(&p, CSRRS(ZERO, MSTATUS, T2));
+    emit(&p, LW(A1, ZERO, DATA));          /* 28 */
+    emitExit(&p);
+
+    for (size_t m = 0; m < MODE_COUNT; m++) {
+        sim_config config;
+        baseConfig(&config, &modes[m]);
+        sim_t *sim = runProgram(&p, &config);
+        check(sim != NULL && sim_read_reg(sim, A5) == 1 && sim_read_reg(sim, A2) == 28 &&
+              sim_read_reg(sim, A3) == CAUSE_LOAD_PAGE_FAULT && sim_read_reg(sim, A4) == DATA,
+              "MPRV load %s: mepc %08X, mcause %u, mtval %08X", modes[m].name,
+              sim != NULL ? sim_read_reg(sim, A2) : 0, sim != NULL ? sim_read_reg(sim, A3) : 0,
+              sim != NULL ? sim_read_reg(sim, A4) : 0);
+        sim_destroy(sim);
+    }
+}
+
+/* Divide by zero sets DZ, and a single read from a register that is not NaN-boxed is the canonical NaN */
+static void testFloat(void) {
+    program p = {0};
+
+    emit(&p, LUI(T0, 0x3F800));            /* 1.0f */
+    emit(&p, FMV_W_X(1, T0));
+    emit(&p, FMV_W_X(2, ZERO));
+    emit(&p, FDIV_S(3, 1, 2));
+    emit(&p, CSRRS(A1, FFLAGS, ZERO));
+    emit(&p, FLD(4, ZERO, DATA));          /* 1.0f without the box */
+    emit(&p, FADD_S(5, 4, 4));
+    emit(&p, FMV_X_W(A2, 5));
+    emit(&p, FMV_X_W(A3, 4));
+    emit(&p, CSRRS(A4, FFLAGS, ZERO));
+    emit(&p, ADDI(A0, ZERO, 0));
+    emitExit(&p);
+    p.words[DATA / 4] = 0x3F800000;
+    p.words[DATA / 4 + 1] = 0;
+
+    for (size_t m = 0; m < MODE_COUNT; m++) {
+        sim_config config;
+        baseConfig(&config, &modes[m]);
+        sim_t *sim = runProgram(&p, &config);
+        check(sim != NULL && sim_read_reg(sim, A1) == 0x08 && sim_read_reg(sim, A2) == 0x7FC00000 &&
+              sim_read_reg(sim, A3) == 0x3F800000 && sim_read_reg(sim, A4) == 0x08,
+              "float %s: fflags %02X then %02X, unboxed add %08X, raw %08X", modes[m].name,
+              sim != NULL ? sim_read_reg(sim, A1) : 0, sim != NULL ? sim_read_reg(sim, A4) : 0,
+              sim != NULL ? sim_read_reg(sim, A2) : 0, sim != NULL ? sim_read_reg(sim, A3) : 0);
+        sim_destroy(sim);
+    }
+}
+
+/* RMM rounds exact ties away from zero in arithmetic and conversions, single and double */
+static void testRoundTiesAway(void) {
+    program p = {0};
+
+    emit(&p, LUI(T0, 0x3F800));            /* 1.0f */
+    emit(&p, FMV_W_X(1, T0));
+    emit(&p, LUI(T0, 0x33800));            /* 2^-24, half an ulp of 1.0f */
+    emit(&p, FMV_W_X(2, T0));
+    emit(&p, withRm(FADD_S(3, 1, 2), RM_RMM));
+    emit(&p, FMV_X_W(A1, 3));
+    emit(&p, LUI(T0, 0x01000));
+    emit(&p, ADDI(T0, T0, 1));             /* 2^24 + 1, halfway between two singles */
+    emit(&p, withRm(FCVT_S_W(4, T0), RM_RMM));
+    emit(&p, FMV_X_W(A2, 4));
+    emit(&p, FLD(5, ZERO, DATA));
+    emit(&p, FLD(6, ZERO, DATA + 8));
+    emit(&p, withRm(FADD_D(7, 5, 6), RM_RMM));
+    emit(&p, FMV_X_W(A3, 7));              /* Low word of the double */
+    emit(&p, CSRRS(A4, FFLAGS, ZERO));
+    emit(&p, ADDI(A0, ZERO, 0));
+    emitExit(&p);
+    p.words[DATA / 4] = 0;                 /* 1.0 */
+    p.words[DATA / 4 + 1] = 0x3FF00000;
+    p.words[DATA / 4 + 2] = 0;             /* 2^-53 */
+    p.words[DATA / 4 + 3] = 0x3CA00000;
+
+    for (size_t m = 0; m < MODE_COUNT; m++) {
+        sim_config config;
+        baseConfig(&config, &modes[m]);
+        sim_t *sim = runProgram(&p, &config);
+        check(sim != NULL && sim_read_reg(sim, A1) == 0x3F800001 && sim_read_reg(sim, A2) == 0x4B800001 &&
+              sim_read_reg(sim, A3) == 1 && sim_read_reg(sim, A4) == 0x01,
+              "RMM %s: fadd.s %08X, fcvt.s.w %08X, fadd.d low %08X, fflags %02X", modes[m].name,
+              sim != NULL ? sim_read_reg(sim, A1) : 0, sim != NULL ? sim_read_reg(sim, A2) : 0,
+              sim != NULL ? sim_read_reg(sim, A3) : 0, sim != NULL ? sim_read_reg(sim, A4) : 0);
+        sim_destroy(sim);
+    }
+}
+
+/* cycle advances in every mode, including the ones where the timing model does not run */
+static void testCycleCounter(void) {
+    program p = {0};
+
+    emit(&p, CSRRS(A1, CYCLE, ZERO));
+    for (int i = 0; i < 8; i++) {
+        emit(&p, ADDI(T1, T1, 1));
+    }
+    emit(&p, CSRRS(A2, CYCLE, ZERO));
+    emit(&p, SUB(A0, A2, A1));
+    emitExit(&p);
+
+    for (size_t m = 0; m <= MODE_COUNT; m++) {
+        const modeCase sampled = { "sampled", SIM_MODE_SAMPLED, 0 };
+        const modeCase *mode = m < MODE_COUNT ? &modes[m] : &sampled;
+        sim_config config;
+        baseConfig(&config, mode);
+        sim_t *sim = runProgram(&p, &config);
+        check(sim != NULL && sim_exit_code(sim) >= 9, "cycle %s: advanced %d over 9 instructions", mode->name,
+              sim != NULL ? sim_exit_code(sim) : 0);
+        sim_destroy(sim);
+    }
+}
+
+/* An executable with one segment loaded at 0 and a .riscv.attributes section */
+typedef struct {
+    Elf32_Ehdr header;
+    Elf32_Phdr segment;
+    uint8_t pad[IMAGE_BYTES - sizeof(Elf32_Ehdr) - sizeof(Elf32_Phdr)];
+    uint32_t image[IMAGE_BYTES / 4];
+    uint8_t attributes[64];
+    Elf32_Shdr sections[2];
+} elfFile;
+
+/* Writes p as an ELF whose attributes name arch */
+static bool writeElf(char *path, const program *p, const char *arch) {
+    elfFile file;
+    uint32_t archBytes = (uint32_t)strlen(arch) + 1;
+    uint32_t fileLength = 1 + 4 + 1 + archBytes;   /* Tag_file, its length, then Tag_RISCV_arch and the string */
+    uint32_t vendorLength = 4 + 6 + fileLength;    /* Its length, "riscv" and the file subsection */
+    uint8_t *a = file.attributes;
+
+    if (archBytes + 32 > sizeof(file.attributes)) {
+        return false;
+    }
+    memset(&file, 0, sizeof(file));
+    memcpy(file.header.e_ident, ELFMAG, SELFMAG);
+    file.header.e_ident[EI_CLASS] = ELFCLASS32;
+    file.header.e_ident[EI_DATA] = ELFDATA2LSB;
+    file.header.e_ident[EI_VERSION] = EV_CURRENT;
+    file.header.e_type = ET_EXEC;
+    file.header.e_machine = EM_RISCV;
+    file.header.e_version = EV_CURRENT;
+    file.header.e_entry = 0;
+    file.header.e_phoff = offsetof(elfFile, segment);
+    file.header.e_shoff = offsetof(elfFile, sections);
+    file.header.e_ehsize = sizeof(Elf32_Ehdr);
+    file.header.e_phentsize = sizeof(Elf32_Phdr);
+    file.header.e_phnum = 1;
+    file.header.e_shentsize = sizeof(Elf32_Shdr);
+    file.header.e_shnum = 2;
+    file.segment.p_type = PT_LOAD;
+    file.segment.p_offset = offsetof(elfFile, image);
+    file.segment.p_filesz = IMAGE_BYTES;
+    file.segment.p_memsz = IMAGE_BYTES;
+    file.segment.p_flags = PF_R | PF_X;
+    memcpy(file.image, p->words, IMAGE_BYTES);
+
+    *a++ = 'A';
+    memcpy(a, &vendorLength, 4);
+    a += 4;
+    memcpy(a, "riscv", 6);
+    a += 6;
+    *a++ = 1;                      /* Tag_file */
+    memcpy(a, &fileLength, 4);
+    a += 4;
+    *a++ = 5;                      /* Tag_RISCV_arch */
+    memcpy(a, arch, archBytes);
+    file.sections[1].sh_type = 0x70000003;   /* SHT_RISCV_ATTRIBUTES */
+    file.sections[1].sh_offset = offsetof(elfFile, attributes);
+    file.sections[1].sh_size = 1 + vendorLength;
+
+    return writeFile(path, &file, sizeof(file));
+}
+
+/* An mtimecmp of all ones is a real deadline, a WFI skips to it and takes the timer interrupt */
+static void testWfiLastTick(void) {
+    program p = {0};
+
+    emitHandler(&p);
+    emit(&p, LUI(T1, 0xF2004));            /* CLINT mtimecmp */
+    emit(&p, ADDI(T2, ZERO, -1));
+    emit(&p, SW(T2, T1, 0));
+    emit(&p, SW(T2, T1, 4));
+    emit(&p, ADDI(T2, ZERO, 0x80));        /* mie.MTIE */
+    emit(&p, CSRRW(ZERO, MIE, T2));
+    emit(&p, ADDI(T2, ZERO, 8));           /* mstatus.MIE */
+    emit(&p, CSRRS(ZERO, MSTATUS, T2));
+    emit(&p, WFI);
+    emitExit(&p);
+
+    sim_config config;
+    baseConfig(&config, &modes[0]);
+    sim_t *sim = runProgram(&p, &config);
+    check(sim != NULL && sim_read_reg(sim, A5) == 1 && sim_read_reg(sim, A3) == CAUSE_TIMER_INTERRUPT,
+          "WFI until mtimecmp of all ones: mcause %08X", sim != NULL ? sim_read_reg(sim, A3) : 0);
+    sim_destroy(sim);
+}
+
+/* The core follows -x or the ELF attributes, misa reports it and it rejects other extensions */
+static void testIsaCores(void) {
+    program p = {0};
+    sim_config config;
+    sim_t *sim;
+
+    emitHandler(&p);
+    emit(&p, CSRRS(A1, MISA, ZERO));
+    emit(&p, ADDI(T1, ZERO, 6));
+    emit(&p, MUL(A0, T1, T1));               /* 16 */
+    emitExit(&p);
+
+    baseConfig(&config, &modes[0]);
+    config.isa = "rv32i2p1_m2p0";
+    sim = runProgram(&p, &config);
+    check(sim != NULL && sim_exit_code(sim) == 36 && sim_read_reg(sim, A1) == MISA_RV32IM,
+          "isa rv32im: exit %d, misa %08X", sim != NULL ? sim_exit_code(sim) : 0, sim != NULL ? sim_read_reg(sim, A1) : 0);
+    sim_destroy(sim);
+
+    /* fflags only exists with F */
+    program f = {0};
+    emitHandler(&f);
+    emit(&f, CSRRS(A1, FFLAGS, ZERO));       /* 8 */
+    emitExit(&f);
+    sim = runProgram(&f, &config);
+    check(sim != NULL && sim_read_reg(sim, A5) == 1 && sim_read_reg(sim, A3) == CAUSE_ILLEGAL_INSTRUCTION &&
+          sim_read_reg(sim, A2) == 8, "isa rv32im: fflags did not trap, mcause %u", sim != NULL ? sim_read_reg(sim, A3) : 0);
+    sim_destroy(sim);
+
+    config.isa = "rv32q";
+    sim = sim_create(&config);
+    check(sim == NULL, "isa rv32q: accepted");
+    sim_destroy(sim);
+
+    /* Picked from the ELF attributes, mul is illegal on rv32i */
+    const char *arches[] = { "rv32i2p1", "rv32i2p1_m2p0_zicsr2p0" };
+    for (int i = 0; i < 2; i++) {
+        char path[] = "/tmp/riscvsim-testXXXXXX";
+        config.isa = NULL;
+        sim = sim_create(&config);
+        bool ok = sim != NULL && writeElf(path, &p, arches[i]) && sim_load_elf(sim, path);
+        unlink(path);
+        check(ok, "ELF %s: could not load", arches[i]);
+        if (!ok) {
+            sim_destroy(sim);
+            continue;
+        }
+        runToHalt(sim);
+        if (i == 0) {
+            check(sim_read_reg(sim, A5) == 1 && sim_read_reg(sim, A3) == CAUSE_ILLEGAL_INSTRUCTION &&
+                  sim_read_reg(sim, A2) == 16, "ELF %s: mul did not trap, mcause %u", arches[i], sim_read_reg(sim, A3));
+        } else {
+            check(sim_exit_code(sim) == 36 && sim_read_reg(sim, A1) == MISA_RV32IM, "ELF %s: exit %d, misa %08X",
+                  arches[i], sim_exit_code(sim), sim_read_reg(sim, A1));
+        }
+        sim_destroy(sim);
+    }
+}
+
+/* The fuzz snapshot cannot roll back a disk image, so fuzzing refuses one */
+static void testFuzzRefusesDisk(void) {
+    static uint8_t coverage[SIM_FUZZ_MAP_SIZE];
+    char path[] = "/tmp/riscvsim-testXXXXXX";
+    uint8_t sector[512] = {0};
+    program p = {0};
+    sim_config config;
+    sim_t *sim;
+
+    emit(&p, ADDI(A0, ZERO, DATA));
+    emit(&p, ADDI(A1, ZERO, 16));
+    emit(&p, ADDI(ZERO, ZERO, 1));           /* Input marker */
+    emitExit(&p);
+    baseConfig(&config, &modes[0]);
+    sim = loadProgram(&p, &config);
+    check(sim != NULL && sim_fuzz_start(sim, coverage, BUDGET), "fuzz without a disk: did not start");
+    sim_destroy(sim);
+
+    if (!writeFile(path, sector, sizeof(sector))) {
+        check(false, "fuzz: could not write the disk image");
+        return;
+    }
+    config.disk_image = path;
+    sim = loadProgram(&p, &config);
+    check(sim != NULL && !sim_fuzz_start(sim, coverage, BUDGET), "fuzz with a disk: started");
+    sim_destroy(sim);
+    unlink(path);
+}
+
+int main(void) {
+    testAuipcJalr();
+    testAuipcLwFault();
+    testMisalignedPolicy();
+    testMisalignedJump();
+    testSv32Fault();
+    testMprvLoad();
+    testFloat();
+    testRoundTiesAway();
+    testCycleCounter();
+    testWfiLastTick();
+    testIsaCores();
+    testFuzzRefusesDisk();
+
+    printf("%u checks, %u failed\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+/**
+ * simfuzz: fuzzing front end. Runs the program to its input marker once, then runs every input from
+ * that snapshot (see inc/fuzz.h).
+ *
+ * Under afl-fuzz it talks the fork server protocol in persistent mode: the fork server process
+ * holds the snapshot, each child runs up to -l inputs and stops itself between them. Without AFL
+ * it replays the given inputs and reports speed, coverage and crashes:
+ *
+ *   afl-fuzz -i seeds -o findings -- simfuzz program.elf @@
+ *   simfuzz program.elf seeds/a seeds/b
+ */
+#include "riscvsim.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* AFL's fork server file descriptors */
+#define FORKSRV_FD 198
+#define MAX_INPUT_BYTES (1u << 20)
+
+/* afl-fuzz looks for these in the binary, the first one enables persistent mode */
+__attribute__((used)) static const char persistentSignature[] = "##SIG_AFL_PERSISTENT##";
+__attribute__((used)) static const char shmSignature[] = "__AFL_SHM_ID";
+
+static uint8_t localCoverage[SIM_FUZZ_MAP_SIZE];
+static uint8_t input[MAX_INPUT_BYTES];
+
+static void usage(const char *name) {
+    printf("Usage: %s [options] program input...\n", name);
+    printf("  program     RV32 ELF, or a raw binary loaded at address 0\n");
+    printf("  input       input files, \"-\" reads stdin. afl-fuzz passes one, usually @@\n");
+    printf("  -n count    instructions per input before it counts as a hang (default 1000000)\n");
+    printf("  -s count    instructions allowed to reach the input marker (default 100000000)\n");
+    printf("  -l count    inputs per child under afl-fuzz before it is restarted (default 10000)\n");
+    printf("  -o          keep the guest's console output instead of discarding it\n");
+}
+
+static bool isElf(const char *path) {
+    char magic[4] = {0};
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    size_t read = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    return read == sizeof(magic) && memcmp(magic, "\177ELF", sizeof(magic)) == 0;
+}
+
+/* afl-fuzz rewrites the same file (or stdin) for every input, so it is read again each time */
+static ssize_t readInput(const char *path) {
+    int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    ssize_t total = 0;
+    ssize_t got;
+
+    if (fd < 0) {
+        return -1;
+    }
+    if (fd == STDIN_FILENO) {
+        lseek(fd, 0, SEEK_SET);
+    }
+    while (total < (ssize_t)sizeof(input) && (got = read(fd, input + total, sizeof(input) - total)) > 0) {
+        total += got;
+    }
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    return total;
+}
+
+/* Child of the fork server: a crash has to kill it with a signal for afl-fuzz to notice */
+static void persistentChild(sim_t *sim, const char *path, uint64_t budget, unsigned long iterations) {
+    for (unsigned long i = 0; i < iterations; i++) {
+        ssize_t bytes = readInput(path);
+        sim_fuzz_result result = bytes >= 0 ? sim_fuzz_run(sim, input, (size_t)bytes, budget) : SIM_FUZZ_OK;
+        if (result == SIM_FUZZ_CRASH) {
+            abort();
+        }
+        if (result == SIM_FUZZ_ERROR) {
+            _exit(1);
+        }
+        if (i + 1 < iterations) {
+            raise(SIGSTOP);
+        }
+    }
+    _exit(0);
+}
+
+/* Returns only if there is no afl-fuzz on the other end */
+static void forkServer(sim_t *sim, const char *path, uint64_t budget, unsigned long iterations) {
+    uint32_t message = 0;
+    pid_t child = -1;
+    bool childStopped = false;
+
+    if (write(FORKSRV_FD + 1, &message, sizeof(message)) != sizeof(message)) {
+        return;
+    }
+    for (;;) {
+        uint32_t wasKilled;
+        int status;
+
+        if (read(FORKSRV_FD, &wasKilled, sizeof(wasKilled)) != sizeof(wasKilled)) {
+            exit(0);
+        }
+        /* afl-fuzz killed a stopped child after a timeout, reap it and start a fresh one */
+        if (childStopped && wasKilled) {
+            waitpid(child, &status, 0);
+            childStopped = false;
+        }
+        if (!childStopped) {
+            child = fork();
+            if (child < 0) {
+                exit(1);
+            }
+            if (child == 0) {
+                close(FORKSRV_FD);
+                close(FORKSRV_FD + 1);
+                persistentChild(sim, path, budget, iterations);
+            }
+        } else {
+            kill(child, SIGCONT);
+            childStopped = false;
+        }
+
+        if (write(FORKSRV_FD + 1, &child, sizeof(child)) != sizeof(child) || waitpid(child, &status, WUNTRACED) < 0) {
+            exit(1);
+        }
+        childStopped = WIFSTOPPED(status);
+        if (write(FORKSRV_FD + 1, &status, sizeof(status)) != sizeof(status)) {
+            exit(1);
+        }
+    }
+}
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/* Standalone mode: every input once from the snapshot */
+static int replay(sim_t *sim, const uint8_t *coverage, char **paths, int count, uint64_t budget) {
+    unsigned long crashes = 0, timeouts = 0;
+    double start = seconds();
+
+    for (int i = 0; i < count; i++) {
+        ssize_t bytes = readInput(paths[i]);
+        if (bytes < 0) {
+            perror(paths[i]);
+            continue;
+        }
+        switch (sim_fuzz_run(sim, input, (size_t)bytes, budget)) {
+            case SIM_FUZZ_CRASH:
+                printf("Crash:                 %s (pc %08X)\n", paths[i], sim_read_reg(sim, SIM_REG_PC));
+                crashes++;
+                break;
+            case SIM_FUZZ_TIMEOUT:
+                printf("Hang:                  %s\n", paths[i]);
+                timeouts++;
+                break;
+            case SIM_FUZZ_OK:
+                break;
+            case SIM_FUZZ_ERROR:
+                fprintf(stderr, "Out of memory for the snapshot at %s\n", paths[i]);
+                return 1;
+        }
+    }
+
+    double elapsed = seconds() - start;
+    unsigned edges = 0;
+    for (unsigned i = 0; i < SIM_FUZZ_MAP_SIZE; i++) {
+        edges += coverage[i] != 0;
+    }
+    printf("Inputs:                %d\n", count);
+    printf("Execs per second:      %.0f\n", elapsed > 0.0 ? count / elapsed : 0.0);
+    printf("Edges covered:         %u\n", edges);
+    printf("Crashes:               %lu\n", crashes);
+    printf("Hangs:                 %lu\n", timeouts);
+    return crashes != 0 ? 2 : 0;
+}
+
+int main(int argc, char **argv) {
+    sim_config config;
+    uint64_t budget = 1000000;
+    uint64_t startBudget = 100000000;
+    unsigned long iterations = 10000;
+    bool keepOutput = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:l:oh")) != -1) {
+        switch (opt) {
+            case 'n': budget = strtoull(optarg, NULL, 0); break;
+            case 's': startBudget = strtoull(optarg, NULL, 0); break;
+            case 'l': iterations = strtoul(optarg, NULL, 0); break;
+            case 'o': keepOutput = true; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind + 1 >= argc || iterations == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    uint8_t *coverage = localCoverage;
+    const char *shmId = getenv(shmSignature);
+    if (shmId != NULL) {
+        coverage = (uint8_t *)shmat(atoi(shmId), NULL, 0);
+        if (coverage == (uint8_t *)-1) {
+            perror("shmat");
+            return 1;
+        }
+    }
+
+    sim_default_config(&config);
+    config.mode = SIM_MODE_FUNCTIONAL;
+    if (!keepOutput) {
+        config.uart_fd = open("/dev/null", O_WRONLY);
+    }
+    sim_t *sim = sim_create(&config);
+    if (sim == NULL) {
+        return 1;
+    }
+    const char *program = argv[optind];
+    if (!(isElf(program) ? sim_load_elf(sim, program) : sim_load_binary(sim, program))) {
+        sim_destroy(sim);
+        return 1;
+    }
+    if (!sim_fuzz_start(sim, coverage, startBudget)) {
+        fprintf(stderr, "%s never reached the input marker (addi x0, x0, 1)\n", program);
+        sim_destroy(sim);
+        return 1;
+    }
+
+    forkServer(sim, argv[optind + 1], budget, iterations);
+    int result = replay(sim, coverage, argv + optind + 1, argc - optind - 1, budget);
+    sim_destroy(sim);
+    return result;
+}
@@ -0,0 +1,151 @@
+/**
+ * simtop: attaches to the statistics a simulator started with -e name publishes and redraws them
+ * periodically. Only reads the shared memory object, so watching never slows the simulator down.
+ */
+#include "statsExport.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+static void usage(const char *name) {
+    printf("Usage: %s [-i ms] [-1] name\n", name);
+    printf("  name        shared memory object the simulator was given with -e\n");
+    printf("  -i ms       refresh interval in milliseconds (default 1000)\n");
+    printf("  -1          print one snapshot and exit\n");
+}
+
+static const char *modeName(uint32_t mode) {
+    switch (mode) {
+        case SIM_MODE_DETAILED: return "detailed";
+        case SIM_MODE_FUNCTIONAL: return "functional";
+        case SIM_MODE_SAMPLED: return "sampled";
+        case SIM_MODE_DECOUPLED: return "decoupled";
+        default: return "unknown";
+    }
+}
+
+static const char *stateName(uint32_t state) {
+    switch (state) {
+        case STATS_RUNNING: return "running";
+        case STATS_PAUSED: return "paused";
+        case STATS_HALTED: return "halted";
+        case STATS_CLOSED: return "closed";
+        default: return "unknown";
+    }
+}
+
+/* The simulator does not timestamp its updates, MIPS is measured against the refresh interval */
+static double hostSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole != 0 ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+/* prev is the snapshot of the last refresh, seconds ago, NULL on the first one */
+static void show(const simStatsBlock *now, const simStatsBlock *prev, double seconds) {
+    const timingStats *t = &now->timing;
+
+    printf("pid %u   %s   %s\n\n", now->pid, modeName(now->mode), stateName(now->state));
+    printf("PC:                    %08X\n", now->pc);
+    printf("Instructions:          %llu\n", (unsigned long long)now->instructions);
+    if (prev != NULL && seconds > 0.0) {
+        printf("MIPS:                  %.2f\n", (double)(now->instructions - prev->instructions) / seconds / 1e6);
+    } else {
+        printf("MIPS:                  -\n");
+    }
+    printf("Simulated clock:       %llu\n", (unsigned long long)now->clock);
+    printf("Idle cycles skipped:   %llu\n", (unsigned long long)now->idleCycles);
+    if (now->state == STATS_HALTED || now->state == STATS_CLOSED) {
+        printf("Exit code:             %d\n", now->exitCode);
+    }
+    if (t->instructions == 0) {
+        return;
+    }
+
+    /* Timing totals only cover detailed instructions, all of them in detailed mode */
+    printf("\nCycles:                %llu\n", (unsigned long long)t->cycles);
+    printf("CPI:                   %.3f\n", (double)t->cycles / (double)t->instructions);
+    if (t->ooo.robCycles != 0) {
+        printf("IPC:                   %.3f\n", (double)t->instructions / (double)t->cycles);
+        printf("ROB occupancy:         %.1f\n", (double)t->ooo.robCycles / (double)t->cycles);
+    }
+    printf("I-cache misses:        %llu\n", (unsigned long long)t->icacheMisses);
+    printf("D-cache misses:        %llu\n", (unsigned long long)t->dcacheMisses);
+    printf("Mispredicts:           %llu\n", (unsigned long long)t->mispredicts);
+    printf("Stalls                 cycles      %% of cycles\n");
+    printf("  I-cache              %-11llu %.1f\n", (unsigned long long)t->icacheStalls, percent(t->icacheStalls, t->cycles));
+    printf("  D-cache              %-11llu %.1f\n", (unsigned long long)t->dcacheStalls, percent(t->dcacheStalls, t->cycles));
+    printf("  Branch               %-11llu %.1f\n", (unsigned long long)t->branchStalls, percent(t->branchStalls, t->cycles));
+    printf("  Fetch refill         %-11llu %.1f\n", (unsigned long long)t->fetchStalls, percent(t->fetchStalls, t->cycles));
+    printf("  Load-use             %-11llu %.1f\n", (unsigned long long)t->loadUseStalls, percent(t->loadUseStalls, t->cycles));
+    printf("  Mul/div              %-11llu %.1f\n", (unsigned long long)t->mulDivStalls, percent(t->mulDivStalls, t->cycles));
+}
+
+int main(int argc, char **argv) {
+    long intervalMs = 1000;
+    bool once = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:1h")) != -1) {
+        switch (opt) {
+            case 'i': intervalMs = strtol(optarg, NULL, 0); break;
+            case '1': once = true; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc || intervalMs <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int fd = shm_open(argv[optind], O_RDONLY, 0);
+    if (fd < 0) {
+        perror("shm_open");
+        return 1;
+    }
+    const simStatsBlock *block = (const simStatsBlock *)mmap(NULL, sizeof(simStatsBlock), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (block == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    if (atomic_load_explicit((_Atomic uint32_t *)&block->magic, memory_order_acquire) != SIM_STATS_MAGIC ||
+        block->version != SIM_STATS_VERSION) {
+        fprintf(stderr, "%s is not a version %d simulator statistics block\n", argv[optind], SIM_STATS_VERSION);
+        return 1;
+    }
+
+    simStatsBlock now;
+    simStatsBlock prev;
+    bool havePrev = false;
+    double prevSeconds = 0.0;
+    struct timespec delay = { .tv_sec = intervalMs / 1000, .tv_nsec = (intervalMs % 1000) * 1000000 };
+    for (;;) {
+        statsSnapshot(block, &now);
+        double seconds = hostSeconds();
+        if (!once) {
+            printf("\033[H\033[2J");
+        }
+        show(&now, havePrev ? &prev : NULL, seconds - prevSeconds);
+        fflush(stdout);
+        if (once || now.state == STATS_CLOSED) {
+            break;
+        }
+        prev = now;
+        prevSeconds = seconds;
+        havePrev = true;
+        nanosleep(&delay, NULL);
+    }
+    munmap((void *)block, sizeof(simStatsBlock));
+    return 0;
+}